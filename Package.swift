@@ -15,5 +15,8 @@ let package = Package(
         .target(
             name: "ParXModelCompiler",
             dependencies: []),
+        .testTarget(
+            name: "ParXModelCompilerTests",
+            dependencies: ["ParXModelCompiler"]),
     ]
 )
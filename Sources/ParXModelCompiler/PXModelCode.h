@@ -24,6 +24,21 @@
 
 #import "prx_def.h"
 
+/** Kind of derivatives, in the order of the derivative sections */
+typedef NS_ENUM(int, PXDerivativeKind) {
+    PXDerivativeVar = 0, /* to variables */
+    PXDerivativeAux = 1, /* to auxiliary variables */
+    PXDerivativePar = 2  /* to parameters */
+};
+
+/** Generation of the derivatives of a kind */
+typedef NS_ENUM(int, PXDerivativeMode) {
+    PXDerivativeAutomatic = -1, /* compiler option: chosen per model */
+    PXDerivativeForward = 0,    /* one pass per column */
+    PXDerivativeReverse = 1,    /* one backward sweep per residual */
+    PXDerivativeVector = 2      /* one pass for all columns */
+};
+
 @interface PXModelCode : NSObject
 
 @property(nonnull) NSString *fileName;
@@ -66,6 +81,9 @@
 - (void)addOperator:(OPR)operator;
 - (void)addType:(TYP)type;
 - (void)addIndex:(int)index;
+- (void)addCell:(CODE)cell;
+- (void)copyInterfaceFrom:(nonnull PXModelCode *)source;
+- (void)addSourceLine:(int)line;
 
 - (void)addVarName:(nonnull NSString *)name
         withAbsTol:(nonnull NSNumber *)abstol
@@ -97,12 +115,37 @@
 
 - (void)addNumber:(double)number;
 
+- (void)addPatternColumnForKind:(PXDerivativeKind)kind
+                           rows:(nonnull const int *)rows
+                          count:(int)count;
+
+- (void)setMode:(PXDerivativeMode)mode forKind:(PXDerivativeKind)kind;
+
 - (nullable CODE *)getModelCode;
 - (int)getLengthCode;
+- (int)getStackDepth;
+
+- (int)getLengthSource;
+- (nullable const int *)getSourceOffsets;
+- (nullable const int *)getSourceLines;
+- (int)getSourceLineAtOffset:(int)offset;
+- (int)getSectionAtOffset:(int)offset column:(nullable int *)column;
+- (nonnull NSDictionary<NSString *, id> *)getCodeStatistics;
 
 - (nullable double *)getModelNumbers;
 - (int)getLengthNumbers;
 
+- (PXDerivativeMode)getModeForKind:(PXDerivativeKind)kind;
+- (int)getColumnsForKind:(PXDerivativeKind)kind;
+- (int)getNonzerosForKind:(PXDerivativeKind)kind;
+- (nullable const int *)getColumnStartsForKind:(PXDerivativeKind)kind;
+- (nullable const int *)getRowIndicesForKind:(PXDerivativeKind)kind;
+- (nullable const int *)getRowStartsForKind:(PXDerivativeKind)kind;
+- (nullable const int *)getColumnIndicesForKind:(PXDerivativeKind)kind;
+
+- (nullable PXModelCode *)specializedCodeForCon:(nonnull const double *)c
+                                           flag:(nonnull const double *)f;
+
 - (void)print;
 
 @end
@@ -21,11 +21,14 @@
 
 #import <Foundation/Foundation.h>
 #import "PXModelCode.h"
+#import "pev_def.h"
+#import "egr_def.h"
 
 @interface PXModelCode ()
 
 - (void)extendCodeArrayByOne;
 - (void)extendNumberArrayByOne;
+- (void)compressRowsForKind:(PXDerivativeKind)kind;
 
 @end
 
@@ -42,6 +45,24 @@
     double *lastNumber;
     int lengthNumbers;
     int lengthNumbersBlock;
+
+    /* source map: code from an offset on belongs to a model file line */
+    int *sourceOffsets;
+    int *sourceLines;
+    int lengthSource;
+    int lengthSourceBlock;
+
+    PXDerivativeMode modes[3]; /* generation per kind of derivatives */
+
+    /* structural nonzeros of the Jacobians, per kind of derivatives */
+    int nColumns[3];
+    int *columnStarts[3]; /* compressed sparse columns */
+    int *rowIndices[3];
+    int *rowStarts[3]; /* compressed sparse rows, made on first use */
+    int *columnIndices[3];
+
+    /* specialized codes, by the values of the constants and flags */
+    NSMutableDictionary<NSData *, PXModelCode *> *specializations;
 }
 
 - (PXModelCode *)init {
@@ -88,6 +109,22 @@
         lastNumber = NULL;
         lengthNumbers = 0;
         lengthNumbersBlock = 0;
+
+        sourceOffsets = NULL;
+        sourceLines = NULL;
+        lengthSource = 0;
+        lengthSourceBlock = 0;
+
+        for (int k = 0; k < 3; k++) {
+            modes[k] = PXDerivativeForward;
+            nColumns[k] = 0;
+            columnStarts[k] = (int *)calloc(1, sizeof(int));
+            rowIndices[k] = NULL;
+            rowStarts[k] = NULL;
+            columnIndices[k] = NULL;
+        }
+
+        specializations = [[NSMutableDictionary alloc] init];
     }
     return self;
 }
@@ -100,6 +137,15 @@
     return lengthCode;
 }
 
+/**
+ @brief Maximum depth of the operand stack in an evaluation of the code
+
+ @return number of operands, -1 for code that is not valid
+ */
+- (int)getStackDepth {
+    return pev_depth(modelCode, lengthCode);
+}
+
 - (double *)getModelNumbers {
     return modelNumbers;
 }
@@ -152,6 +198,14 @@
 - (void)dealloc {
     free(modelCode);
     free(modelNumbers);
+    free(sourceOffsets);
+    free(sourceLines);
+    for (int k = 0; k < 3; k++) {
+        free(columnStarts[k]);
+        free(rowIndices[k]);
+        free(rowStarts[k]);
+        free(columnIndices[k]);
+    }
 }
 
 - (void)addOperator:(OPR)operator{
@@ -169,6 +223,268 @@
     lastCode->i = index;
 }
 
+- (void)addCell:(CODE)cell {
+    [self extendCodeArrayByOne];
+    *lastCode = cell;
+}
+
+/**
+ @brief Attribute the code that follows to a line of the model file
+
+ @discussion    The entry holds until the next one. An entry without code
+ since the previous one replaces it, and an entry for the line of the
+ previous one is left out.
+
+ @param line line number, 0 for code that belongs to no single statement
+ */
+- (void)addSourceLine:(int)line {
+    int *new;
+
+    if (lengthSource > 0 && sourceOffsets[lengthSource - 1] == lengthCode) {
+        lengthSource--;
+    }
+    if (lengthSource > 0 && sourceLines[lengthSource - 1] == line) {
+        return;
+    }
+    if (lengthSource == lengthSourceBlock) {
+        lengthSourceBlock += ALLOC_BLOCKSIZE;
+        new = (int *)realloc(sourceOffsets, lengthSourceBlock * sizeof(int));
+        if (new == NULL) {
+            exit(1);
+        }
+        sourceOffsets = new;
+        new = (int *)realloc(sourceLines, lengthSourceBlock * sizeof(int));
+        if (new == NULL) {
+            exit(1);
+        }
+        sourceLines = new;
+    }
+    sourceOffsets[lengthSource] = lengthCode;
+    sourceLines[lengthSource++] = line;
+}
+
+- (int)getLengthSource {
+    return lengthSource;
+}
+
+- (const int *)getSourceOffsets {
+    return sourceOffsets;
+}
+
+- (const int *)getSourceLines {
+    return sourceLines;
+}
+
+/**
+ @brief Line of the model file of the code at an offset
+
+ @param offset offset in the code
+ @return line number, 0 when unknown
+ */
+- (int)getSourceLineAtOffset:(int)offset {
+    int lo = 0, hi = lengthSource; /* first entry after the offset */
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (sourceOffsets[mid] <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo > 0) ? sourceLines[lo - 1] : 0;
+}
+
+/**
+ @brief Section of the code at an offset
+
+ @discussion    The column is the variable, auxiliary or parameter of a
+ derivative in forward mode, the residual of a sweep in reverse mode and
+ 0 in vector mode.
+
+ @param offset offset in the code
+ @param column column in the section, output, may be NULL
+ @return kind of derivatives, -1 for the function code
+ */
+- (int)getSectionAtOffset:(int)offset column:(int *)column {
+    int kind = -1, col = 0;
+
+    for (int i = 0; i < lengthCode && i < offset;
+         i += pev_length(modelCode[i].o)) {
+        if (modelCode[i].o == SOK) {
+            kind++;
+            col = 0;
+        } else if (modelCode[i].o == EOD) {
+            col++;
+        } else if (modelCode[i].o == STOP) {
+            break;
+        }
+    }
+    if (column) {
+        *column = (kind < 0) ? 0 : col;
+    }
+    return kind;
+}
+
+/**
+ @brief Estimated cost of an operator, in units of an addition
+
+ @param opr operator
+ @param nGrad length of a gradient, for GADD
+ @return cost, 0 for loads, stores and control
+ */
+static double flopCost(OPR opr, int nGrad) {
+    if (opr == GADD) {
+        return 2 * nGrad; /* multiply and add per column */
+    }
+    return (opr > INVAL && opr < RET) ? egr_cost(opr) : 0;
+}
+
+/**
+ @brief Statistics of the code
+
+ @discussion    The function code includes the parameter stage and the
+ shared subexpressions of the derivatives. The costs
+ are estimated per operator as in the simplification of the derivatives,
+ in units of an addition. The cost of a residual is that of its assignment
+ and of all assignments to the temporaries on which it depends, counted
+ once, both branches of a conditional included. The cost of a derivative
+ is that of its column in forward mode, of the sweep of a residual in
+ reverse mode and of the single pass in vector mode.
+
+ @return "stageLength", "functionLength", "varLength", "auxLength" and
+ "parLength": cells per section, "functionOperators", "varOperators",
+ "auxOperators" and "parOperators": number of each operator (index as
+ OPR), "residualCost": cost per residual, "varCost", "auxCost" and
+ "parCost": cost per derivative
+ */
+- (NSDictionary<NSString *, id> *)getCodeStatistics {
+    NSString *name[4] = {@"function", @"var", @"aux", @"par"};
+    int nTmp = self.numberOfTemp;
+    int nRes = (int)[self.resName count];
+    int nCol[3] = {(int)[self.varName count], (int)[self.auxName count],
+                   (int)[self.parName count]};
+    NSMutableDictionary *stats = [[NSMutableDictionary alloc] init];
+    NSMutableArray *hist, *cost[3];
+    NSMutableArray<NSMutableIndexSet *> *reads; /* temporaries read by
+                                                 * a temporary or residual */
+    NSMutableIndexSet *now = [NSMutableIndexSet indexSet];
+    long count[4][STOP + 1] = {{0}};
+    int length[4] = {0};
+    int stage = 0;        /* cells of the parameter stage */
+    int kind = -1;        /* section, -1 for the function code */
+    double e = 0, c = 0;  /* cost of the statement, of the derivative */
+    double *tmpCost, *resCost;
+    int *mark, *list, n; /* temporaries visited, to visit */
+    OPR opr;
+    TYP typ;
+    int ind;
+
+    tmpCost = (double *)calloc(nTmp + 1, sizeof(double));
+    resCost = (double *)calloc(nRes + 1, sizeof(double));
+    reads = [NSMutableArray arrayWithCapacity:nTmp + nRes];
+    for (int i = 0; i < nTmp + nRes; i++) {
+        [reads addObject:[NSMutableIndexSet indexSet]];
+    }
+    for (int k = 0; k < 3; k++) {
+        cost[k] = [[NSMutableArray alloc] init];
+    }
+
+    for (int i = 0; i < lengthCode; i += pev_length(opr)) {
+        opr = modelCode[i].o;
+        if (opr == STOP) {
+            break;
+        }
+        if (opr == SOK && kind < 2) {
+            kind++;
+            c = 0;
+        }
+        count[kind + 1][opr]++;
+        length[kind + 1] += pev_length(opr);
+        if (kind >= 0) {
+            c += flopCost(opr, nCol[kind]);
+            if (opr == EOD) {
+                [cost[kind] addObject:@(c)];
+                c = 0;
+            }
+            continue;
+        }
+
+        /* function code: statements by their target */
+        e += flopCost(opr, 0);
+        if (opr == OPD) {
+            if (modelCode[i + 1].t == TMP && modelCode[i + 2].i < nTmp) {
+                [now addIndex:modelCode[i + 2].i];
+            }
+        } else if (opr == ASS || opr == NASS) {
+            typ = modelCode[i + 1].t;
+            ind = modelCode[i + 2].i;
+            if (typ == TMP && ind < nTmp) {
+                tmpCost[ind] += e;
+                [reads[ind] addIndexes:now];
+            } else if (typ == RES && ind < nRes) {
+                resCost[ind] += e;
+                [reads[nTmp + ind] addIndexes:now];
+            }
+            e = 0;
+            [now removeAllIndexes];
+        } else if ((opr >= RET && opr < OPD) || opr > LDF) {
+            if (opr == SOP) {
+                stage = i;
+            }
+            e = 0; /* conditions, checks and control */
+            [now removeAllIndexes];
+        }
+    }
+
+    /* residuals: the temporaries on which they depend, once each */
+    hist = [[NSMutableArray alloc] init];
+    mark = (int *)calloc(nTmp + 1, sizeof(int));
+    list = (int *)malloc((nTmp + 1) * sizeof(int));
+    for (int r = 0; r < nRes; r++) {
+        NSIndexSet *set = reads[nTmp + r];
+        double sum = resCost[r];
+
+        n = 0;
+        for (;;) {
+            for (NSUInteger k = [set firstIndex]; k != NSNotFound;
+                 k = [set indexGreaterThanIndex:k]) {
+                if (mark[k] != r + 1) {
+                    mark[k] = r + 1;
+                    list[n++] = (int)k;
+                }
+            }
+            if (n == 0) {
+                break;
+            }
+            ind = list[--n];
+            sum += tmpCost[ind];
+            set = reads[ind];
+        }
+        [hist addObject:@(sum)];
+    }
+    stats[@"residualCost"] = hist;
+    free(mark);
+    free(list);
+    free(tmpCost);
+    free(resCost);
+
+    stats[@"stageLength"] = @(stage);
+    for (int k = 0; k < 4; k++) {
+        hist = [[NSMutableArray alloc] initWithCapacity:STOP + 1];
+        for (int o = 0; o <= STOP; o++) {
+            [hist addObject:@(count[k][o])];
+        }
+        stats[[name[k] stringByAppendingString:@"Length"]] = @(length[k]);
+        stats[[name[k] stringByAppendingString:@"Operators"]] = hist;
+        if (k > 0) {
+            stats[[name[k] stringByAppendingString:@"Cost"]] = cost[k - 1];
+        }
+    }
+
+    return stats;
+}
+
 - (void)addVarName:(NSString *)name
         withAbsTol:(NSNumber *)abstol
     withLowerLimit:(NSNumber *)lowerLimit
@@ -229,6 +545,262 @@
     *lastNumber = number;
 }
 
+/**
+ @brief Record how the derivatives of a kind are generated
+
+ @discussion    The derivative section of a kind in reverse mode holds one
+ sweep per residual, instead of one pass per column, and its derivatives
+ are stored with the operand type DJAC. A kind in vector mode has a single
+ pass, in which GCLR clears the gradient of a temporary or residual and
+ GADD adds a multiple of a gradient, or of a unit vector, to it.
+
+ @param mode forward, reverse or vector
+ @param kind kind of derivatives
+ */
+- (void)setMode:(PXDerivativeMode)mode forKind:(PXDerivativeKind)kind {
+    modes[kind] = mode;
+}
+
+- (PXDerivativeMode)getModeForKind:(PXDerivativeKind)kind {
+    return modes[kind];
+}
+
+/**
+ @brief Append a column to the Jacobian pattern
+
+ @param kind kind of derivatives
+ @param rows residuals of which the derivative is not structurally zero,
+ in increasing order
+ @param count number of rows
+ */
+- (void)addPatternColumnForKind:(PXDerivativeKind)kind
+                           rows:(const int *)rows
+                          count:(int)count {
+    int nnz = columnStarts[kind][nColumns[kind]];
+    int *new;
+
+    new = (int *)realloc(columnStarts[kind],
+                         (nColumns[kind] + 2) * sizeof(int));
+    if (new == NULL) {
+        exit(1);
+    }
+    columnStarts[kind] = new;
+    new = (int *)realloc(rowIndices[kind], (nnz + count + 1) * sizeof(int));
+    if (new == NULL) {
+        exit(1);
+    }
+    rowIndices[kind] = new;
+
+    for (int i = 0; i < count; i++) {
+        rowIndices[kind][nnz + i] = rows[i];
+    }
+    columnStarts[kind][++nColumns[kind]] = nnz + count;
+
+    free(rowStarts[kind]); /* compressed rows are out of date */
+    free(columnIndices[kind]);
+    rowStarts[kind] = NULL;
+    columnIndices[kind] = NULL;
+}
+
+- (int)getColumnsForKind:(PXDerivativeKind)kind {
+    return nColumns[kind];
+}
+
+- (int)getNonzerosForKind:(PXDerivativeKind)kind {
+    return columnStarts[kind][nColumns[kind]];
+}
+
+- (const int *)getColumnStartsForKind:(PXDerivativeKind)kind {
+    return columnStarts[kind];
+}
+
+- (const int *)getRowIndicesForKind:(PXDerivativeKind)kind {
+    return rowIndices[kind];
+}
+
+/**
+ @brief Compressed rows of a Jacobian pattern, by transposition
+
+ @discussion    Within a row the columns are in increasing order.
+
+ @param kind kind of derivatives
+ */
+- (void)compressRowsForKind:(PXDerivativeKind)kind {
+    int nRow = (int)[self.resName count];
+    int nnz = columnStarts[kind][nColumns[kind]];
+    int *start = (int *)calloc(nRow + 1, sizeof(int));
+    int *index = (int *)calloc(nnz + 1, sizeof(int));
+    int *next = (int *)calloc(nRow + 1, sizeof(int));
+
+    for (int k = 0; k < nnz; k++) {
+        start[rowIndices[kind][k] + 1]++;
+    }
+    for (int i = 0; i < nRow; i++) {
+        start[i + 1] += start[i];
+        next[i] = start[i];
+    }
+    for (int j = 0; j < nColumns[kind]; j++) {
+        for (int k = columnStarts[kind][j]; k < columnStarts[kind][j + 1];
+             k++) {
+            index[next[rowIndices[kind][k]]++] = j;
+        }
+    }
+    free(next);
+
+    rowStarts[kind] = start;
+    columnIndices[kind] = index;
+}
+
+- (const int *)getRowStartsForKind:(PXDerivativeKind)kind {
+    @synchronized(self) {
+        if (!rowStarts[kind]) {
+            [self compressRowsForKind:kind];
+        }
+    }
+    return rowStarts[kind];
+}
+
+- (const int *)getColumnIndicesForKind:(PXDerivativeKind)kind {
+    @synchronized(self) {
+        if (!rowStarts[kind]) {
+            [self compressRowsForKind:kind];
+        }
+    }
+    return columnIndices[kind];
+}
+
+/**
+ @brief Copy of the names, values and Jacobian pattern of another model code
+
+ @param source model code
+ */
+- (void)copyInterfaceFrom:(PXModelCode *)source {
+
+    self.fileName = source.fileName;
+    self.model = source.model;
+    self.author = source.author;
+    self.date = source.date;
+    self.version = source.version;
+    self.ident = source.ident;
+
+    self.varName = [source.varName mutableCopy];
+    self.varAbsTol = [source.varAbsTol mutableCopy];
+    self.varLowerLimit = [source.varLowerLimit mutableCopy];
+    self.varUpperLimit = [source.varUpperLimit mutableCopy];
+    self.varUnit = [source.varUnit mutableCopy];
+
+    self.auxName = [source.auxName mutableCopy];
+    self.auxAbsTol = [source.auxAbsTol mutableCopy];
+    self.auxLowerLimit = [source.auxLowerLimit mutableCopy];
+    self.auxUpperLimit = [source.auxUpperLimit mutableCopy];
+
+    self.parName = [source.parName mutableCopy];
+    self.parDefaultValue = [source.parDefaultValue mutableCopy];
+    self.parLowerBound = [source.parLowerBound mutableCopy];
+    self.parUpperBound = [source.parUpperBound mutableCopy];
+    self.parLowerLimit = [source.parLowerLimit mutableCopy];
+    self.parUpperLimit = [source.parUpperLimit mutableCopy];
+    self.parUnit = [source.parUnit mutableCopy];
+
+    self.conName = [source.conName mutableCopy];
+    self.conDefaultValue = [source.conDefaultValue mutableCopy];
+    self.conUnit = [source.conUnit mutableCopy];
+
+    self.flgName = [source.flgName mutableCopy];
+    self.flgDefaultValue = [source.flgDefaultValue mutableCopy];
+
+    self.resName = [source.resName mutableCopy];
+
+    self.numberOfTemp = source.numberOfTemp;
+
+    for (int k = 0; k < 3; k++) {
+        const int *start = [source getColumnStartsForKind:k];
+        const int *row = [source getRowIndicesForKind:k];
+
+        modes[k] = [source getModeForKind:k];
+        for (int j = 0; j < [source getColumnsForKind:k]; j++) {
+            [self addPatternColumnForKind:k
+                                     rows:row + start[j]
+                                    count:start[j + 1] - start[j]];
+        }
+    }
+}
+
+/**
+ @brief Model code specialized for fixed constants and flags
+
+ @discussion    The constants and flags in the code are replaced by their
+ values, operations on known values are folded, and of a conditional with
+ a known condition only the branch that is taken is kept, together with
+ its derivatives. The specialized code has the same interface, Jacobian
+ pattern and modes as this code, and is evaluated with the same arguments.
+ Its constants and flags are not used. Its source map is that of this
+ code, moved to the offsets of the specialized code, so that its profile
+ is attributed to the lines of the model file. <br>
+ Specializations are kept per set of values, and are shared by the
+ callers that ask for the same values. A flag has the value of its test,
+ 0 or 1.
+
+ @param c constants
+ @param f flags
+ @return specialized code, nil on error
+ */
+- (PXModelCode *)specializedCodeForCon:(const double *)c
+                                  flag:(const double *)f {
+    int nCon = (int)[self.conName count];
+    int nFlg = (int)[self.flgName count];
+    double *values;
+    NSData *key;
+    PXModelCode *code;
+    struct PEV_CODE in, out;
+
+    values = (double *)malloc((nCon + nFlg + 1) * sizeof(double));
+    for (int i = 0; i < nCon; i++) {
+        values[i] = c[i];
+    }
+    for (int i = 0; i < nFlg; i++) {
+        values[nCon + i] = f[i] > 0.5 ? 1 : 0;
+    }
+    key = [NSData dataWithBytes:values
+                         length:(nCon + nFlg) * sizeof(double)];
+
+    @synchronized(self) {
+        code = specializations[key];
+        if (code || modelCode == NULL) {
+            free(values);
+            return code;
+        }
+
+        in.code = modelCode;
+        in.nCode = lengthCode;
+        in.num = modelNumbers;
+        in.nNum = lengthNumbers;
+        in.map = NULL;
+        if (!pev_specialize(&in, nCon, nFlg, self.numberOfTemp, values,
+                            values + nCon, &out)) {
+            free(values);
+            return nil;
+        }
+        free(values);
+
+        code = [[PXModelCode alloc] init];
+        [code copyInterfaceFrom:self];
+        for (int i = 0, s = 0; i < out.nCode; i++) {
+            while (s < lengthSource && out.map[sourceOffsets[s]] <= i) {
+                [code addSourceLine:sourceLines[s++]];
+            }
+            [code addCell:out.code[i]];
+        }
+        for (int i = 0; i < out.nNum; i++) {
+            [code addNumber:out.num[i]];
+        }
+        pev_free(&out);
+
+        specializations[key] = code;
+    }
+    return code;
+}
+
 - (void)print {
 
     char *oprName[128]; /* operator names */
@@ -237,7 +809,9 @@
     TYP type;
     int index;
     int nSok, nEod;
+    BOOL rev; /* reverse mode section, pd is the residual */
     NSString *pe, *pd;
+    NSArray<NSString *> *col[4];
 
     varTyp[VAR] = "var";
     varTyp[AUX] = "aux";
@@ -248,6 +822,12 @@
     varTyp[TMP] = "tmp";
     varTyp[DTMP] = "dTmp";
     varTyp[DRES] = "dRes";
+    varTyp[DJAC] = "dJac";
+
+    col[0] = nil;
+    col[1] = self.varName;
+    col[2] = self.auxName;
+    col[3] = self.parName;
 
     oprName[AND] = "&";
     oprName[OR] = "|";
@@ -274,6 +854,8 @@
     oprName[FI] = "fi";
     oprName[EOD] = "eod";
     oprName[SOK] = "sok";
+    oprName[SOP] = "sop";
+    oprName[SOD] = "sod";
     oprName[SIN] = "sin";
     oprName[COS] = "cos";
     oprName[TAN] = "tan";
@@ -299,12 +881,15 @@
     oprName[ASS] = "+->";
     oprName[NASS] = "-->";
     oprName[CLR] = "0->";
+    oprName[GCLR] = "0=>";
+    oprName[GADD] = "+=>";
     oprName[CHKL] = "<?:ret";
     oprName[CHKG] = ">?:ret";
     oprName[127] = ">126";
     oprName[INVAL] = "INVALID";
 
     nSok = nEod = 0;
+    rev = NO;
     pd = self.varName[0];
 
     fprintf(stderr, "model code:\n\n");
@@ -389,7 +974,15 @@
                 fprintf(stderr, "d_%s/d_%s ", [pe UTF8String], [pd UTF8String]);
                 break;
             case DTMP:
-                fprintf(stderr, "d_tmp[%d]/d_%s ", index, [pd UTF8String]);
+                if (rev) {
+                    fprintf(stderr, "d_%s/d_tmp[%d] ", [pd UTF8String], index);
+                } else {
+                    fprintf(stderr, "d_tmp[%d]/d_%s ", index, [pd UTF8String]);
+                }
+                break;
+            case DJAC:
+                pe = index < [col[nSok] count] ? col[nSok][index] : @"?";
+                fprintf(stderr, "d_%s/d_%s ", [pd UTF8String], [pe UTF8String]);
                 break;
             default:
                 break;
@@ -439,13 +1032,55 @@
                         [pd UTF8String]);
                 break;
             case DTMP:
-                fprintf(stderr, "%s d_tmp[%d]/d_%s\n", oprName[opr], index,
-                        [pd UTF8String]);
+                if (rev) {
+                    fprintf(stderr, "%s d_%s/d_tmp[%d]\n", oprName[opr],
+                            [pd UTF8String], index);
+                } else {
+                    fprintf(stderr, "%s d_tmp[%d]/d_%s\n", oprName[opr], index,
+                            [pd UTF8String]);
+                }
+                break;
+            case DJAC:
+                pe = index < [col[nSok] count] ? col[nSok][index] : @"?";
+                fprintf(stderr, "%s d_%s/d_%s\n", oprName[opr], [pd UTF8String],
+                        [pe UTF8String]);
                 break;
             default:
                 break;
             }
             break;
+        case GCLR:
+        case GADD:
+            fprintf(stderr, "%s", oprName[opr]);
+            for (int k = (opr == GADD) ? 2 : 1; k > 0; k--) {
+                type = modelCode[++i].t;
+                index = modelCode[++i].i;
+                switch (type) {
+                case VAR:
+                    pe = self.varName[index];
+                    fprintf(stderr, " e_%s", [pe UTF8String]);
+                    break;
+                case AUX:
+                    pe = self.auxName[index];
+                    fprintf(stderr, " e_%s", [pe UTF8String]);
+                    break;
+                case PAR:
+                    pe = self.parName[index];
+                    fprintf(stderr, " e_%s", [pe UTF8String]);
+                    break;
+                case DRES:
+                    pe = self.resName[index];
+                    fprintf(stderr, " grad_%s", [pe UTF8String]);
+                    break;
+                case DTMP:
+                    fprintf(stderr, " grad_tmp[%d]", index);
+                    break;
+                default:
+                    break;
+                }
+            }
+            fprintf(stderr, "\n");
+            break;
         case CHKG:
         case CHKL:
             fprintf(stderr, "%s\n", oprName[opr]);
@@ -468,7 +1103,18 @@
                                                  : [NSString new];
                 break;
             }
-
+            if (rev) {
+                pd = nEod < [self.resName count] ? self.resName[nEod]
+                                                 : [NSString new];
+            }
+            break;
+        case SOP:
+            fprintf(stderr, "%s__________________________________point\n\n",
+                    oprName[opr]);
+            break;
+        case SOD:
+            fprintf(stderr, "%s_________________________________shared\n\n",
+                    oprName[opr]);
             break;
         case SOK:
             nSok++;
@@ -493,6 +1139,11 @@
                         oprName[opr]);
                 break;
             }
+            rev = (nSok <= 3) && (modes[nSok - 1] == PXDerivativeReverse);
+            if (rev) {
+                pd = nEod < [self.resName count] ? self.resName[nEod]
+                                                 : [NSString new];
+            }
             break;
         case IF:
         case ELSE:
@@ -22,25 +22,61 @@
 #ifndef _PXModelCompiler_h
 #define _PXModelCompiler_h
 
-@class PXModelCode;
+#import "PXModelCode.h"
+
+/* budget of the simplification of a derivative by equality saturation */
+typedef struct {
+    int maxNodes;      /* expressions held, 0 - no equality saturation */
+    int maxIterations; /* rounds of rewriting */
+    double maxSeconds; /* processor time of the thread, 0 - no limit */
+} PXSimplifyBudget;
 
 @interface PXModelCompiler : NSObject
 
 - (nullable PXModelCompiler *)initWithPath:(nonnull NSString *)mdlFileName
                                    error:(NSError *_Nullable *_Nullable)error;
 
+- (nullable PXModelCompiler *)
+    initWithPath:(nonnull NSString *)mdlFileName
+           modes:(nullable const PXDerivativeMode *)modes
+           error:(NSError *_Nullable *_Nullable)error;
+
+- (nullable PXModelCompiler *)
+    initWithPath:(nonnull NSString *)mdlFileName
+           modes:(nullable const PXDerivativeMode *)modes
+          budget:(nullable const PXSimplifyBudget *)budget
+           error:(NSError *_Nullable *_Nullable)error;
+
+- (nullable PXModelCompiler *)
+    initWithPath:(nonnull NSString *)mdlFileName
+           modes:(nullable const PXDerivativeMode *)modes
+          budget:(nullable const PXSimplifyBudget *)budget
+            lazy:(BOOL)lazy
+           error:(NSError *_Nullable *_Nullable)error;
+
 - (nullable PXModelCode *)getModelCode;
 
+- (nullable PXModelCode *)getModelCodeForVarColumns:(nullable const int *)xc
+                                           varCount:(int)nxc
+                                         parColumns:(nullable const int *)pc
+                                           parCount:(int)npc;
+
 - (nonnull NSMutableArray *)getSymbolsNotAssigned;
 
 - (nonnull NSMutableArray *)getSymbolsNotUsed;
 
+- (nonnull NSDictionary<NSString *, NSNumber *> *)getRewriteCounts;
+
+- (nonnull NSDictionary<NSString *, NSNumber *> *)getCompileStatistics;
+
 + (nonnull NSString *)getReservedNameTokens;
 
 + (nonnull NSString *)getNotAtNameStartTokens;
 
 + (nonnull NSString *)getNameSeparatorToken;
 
++ (nonnull NSArray *)compileModelsAtPaths:(nonnull NSArray<NSString *> *)paths;
+
 @end
 
 #endif
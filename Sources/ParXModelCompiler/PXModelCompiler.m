@@ -20,8 +20,11 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <time.h>
 #import "mem_def.h"
 #import "bt_def.h"
+#import "egr_def.h"
+#import "pev_def.h"
 #import "prx_def.h"
 #import "PXModelCompiler.h"
 #import "PXModelCode.h"
@@ -33,57 +36,261 @@
 - (int)getError;
 - (int)parseModelFile:(FILE *)inFile;
 - (PRX_NODE *)getNum:(double)value;
+- (PRX_NODE *)getNode:(OPR)opr
+             withLeft:(PRX_NODE *)o1
+            withRight:(PRX_NODE *)o2
+               inTree:(struct MEM_TREE *)tree;
 - (PRX_OPD *)newName:(char *)name withType:(TYP)typ withIndex:(int)ind;
 - (int)parseHeaderDefinition:(char *)definition;
 - (int)createDerivativesIndex;
 - (void)addNotUsed:(char *)name;
 - (void)addNotAssigned:(char *)name;
 - (int)checkModelConsistency;
+- (int)temporariesOfNode:(PRX_NODE *)p
+            withOperator:(OPR)opr
+                    into:(int *)read;
+- (int)compactStatements:(const int *)keep;
+- (int)eliminateDeadStatements;
 - (int)parseEquation:(char *)equation;
+- (PRX_NODE *)tapeAtNode:(PRX_NODE *)p root:(int)root;
+- (PRX_NODE *)tapeForNode:(PRX_NODE *)p name:(char *)name;
 - (int)parseExpression:(char *)expression;
 - (int)genCodeForNode:(PRX_NODE *)pNode;
+- (int)stackNeedOfNode:(PRX_NODE *)p;
+- (int)powerLoadsOfNode:(PRX_NODE *)p;
+- (int)genReducedPowerOfNode:(PRX_NODE *)p;
+- (int)genFunctionCode;
 - (int)numOut;
+- (int)compactTemporaries;
 - (int)generateDerivatives;
+- (int)derivativeSectionsInModes:(const PXDerivativeMode *)modes;
 - (int)derivativeToVariable:(PRX_OPD *)pOpd;
 - (int)derivativeForSubExpression:(PRX_NODE *)p
                        toVariable:(PRX_OPD *)arg
                           withVal:(PRX_OPD *)fval;
 - (int)simplifyExpressionAtNode:(PRX_NODE *)p;
+- (int)simplifyDerivativeAtNode:(PRX_NODE *)p;
+- (int)saturateDerivativeAtNode:(PRX_NODE *)p;
+- (long)nodesOfNode:(PRX_NODE *)p;
+- (void)nestStatements;
+- (int)isStatement:(int)a exclusiveWith:(int)b;
+- (int)operandsOfNode:(PRX_NODE *)p into:(PRX_OPD **)opd count:(int)n;
+- (int)isReverseEligible;
+- (int)reverseDerivativesForKind:(PXDerivativeKind)kind;
+- (int)isVectorEligible;
+- (int)vectorDerivativesForKind:(PXDerivativeKind)kind;
+- (int)markParameterStage;
+- (int)isInvariantNode:(PRX_NODE *)p;
+- (int)isPrimalNode:(PRX_NODE *)p;
+- (int)sharedSlotForNode:(PRX_NODE *)pNode;
+- (int)genSharedAtNode:(PRX_NODE *)p inStage:(int)stage;
+- (int)genSharedSubexpressionsInStage:(int)stage;
+- (int)genLazyFunctionCode;
+- (int)lazySectionForKind:(PXDerivativeKind)kind column:(int)j;
+- (PXModelCode *)assembleCodeForColumns:(const char *)want;
+- (void)mapStatement:(int)s;
 
 @end
 
+/**
+ @brief Clock of the compile statistics
+
+ @return time in seconds
+ */
+static double compileClock(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
 /**
  @brief Compiler for generating the code from the model input description
  */
 @implementation PXModelCompiler {
 
     PXModelCode *modelCode;
+    PXModelCode *functionCode; /* function code only, for lazy derivatives */
     NSMutableArray *symbolsNotAssigned;
     NSMutableArray *symbolsNotUsed;
+
+    int prxErrorLineno;        /* line number of the error */
+    char prxErrorString[1024]; /* error message */
+
+    struct MEM_TREE *Tree, *DTree; /* memory trees */
+    struct BT_HEAD *BtNames;       /* balanced bin. tree of names */
+    struct BT_HEAD *BtNumbers;     /* balanced bin. tree of numbers */
+    struct BT_HEAD *BtNodes;       /* balanced bin. tree of nodes */
+    struct BT_HEAD *BtShared;      /* subexpressions of the derivatives */
+    struct BT_HEAD *BtSaturated;   /* derivatives rewritten by saturation */
+    PRX_SHARE *pShareFirst, *pShareLast; /* in order of creation */
+
+    int prxLineno; /* line number model file */
+    int prxError;  /* general error flag */
+    int bDeriv;    /* Deriv.s are (not) actually computed */
+    int ifLevel;   /* if nesting level */
+    int bAssign;   /* subexpression can start with assign */
+    int bShare;    /* shared subexpressions: 0 - off, 1 - count, 2 - use */
+    int bFunction; /* function code: only the parameter stage is shared */
+    int nPowReduced; /* powers reduced to multiplications */
+    int nExpFused;   /* products and quotients of exponentials fused */
+    int nSaturated;  /* derivatives rewritten by equality saturation */
+    int nDead;       /* statements removed as dead */
+    int nSlotFreed;  /* temporaries removed from the code */
+    double tPhase[6];  /* wall time per phase: parse, check, dead
+                        * statements, derivatives, temporaries, numbers */
+    long nNodes[4];    /* nodes of the statements, and of the derivatives,
+                        * before and after simplification */
+    struct EGR_BUDGET egrBudget; /* budget of equality saturation */
+    int bLazy;     /* derivatives are generated on request */
+
+    /* code and pattern rows of each derivative, NSNull until generated */
+    NSMutableArray *lazySections[3];
+    NSMutableArray *lazyRows[3];
+    NSMutableArray *lazyLines[3]; /* source map: offset, line pairs */
+
+    /* model codes with derivatives, by the requested columns */
+    NSMutableDictionary<NSData *, PXModelCode *> *lazyCodes;
+
+    char *sModel, *sDate, *sAuthor; /* model identifiers */
+    char *sVersion, *sIdent;
+
+    int nVar, nAux; /* number of model symbols */
+    int nPar, nCon, nFlag;
+    int nRes, nNum, nTmp;
+
+    double *Numbers; /* numeric constants */
+
+    PRX_NODE *NodeH[MAXEQU]; /* array of tree pointers */
+    int UsageFlag[MAXEQU];   /* bit flag: operand of corr. is */
+    int TmpTyp[MAXEQU];      /* flag: corresponding temporary derivative
+                              * is (not) needed to compute further,
+                              * 2 - used in place, for a tape */
+    PRX_NODE *TmpTape[MAXEQU]; /* assignment of a tape or branch record,
+                                * NULL for others */
+    int TmpStage[MAXEQU];    /* temporary is assigned in the parameter stage */
+    int ResTyp[MAXEQU];      /* flag: corresponding residual derivative
+                              * is (not) structurally zero */
+    int StmIf[MAXEQU];       /* enclosing if-statement, -1 for none */
+    int StmBranch[MAXEQU];   /* branch of the enclosing if: 0 - if, 1 - else */
+    int StmMatch[MAXEQU];    /* if of an else or fi, else of an if (-1) */
+    int StmLine[MAXEQU];     /* line of the statement in the model file */
+    PXDerivativeMode kindMode[3]; /* requested mode per kind */
+    PRX_NODE **pHead;        /* pointer for array NodeH */
+    int nHead;               /* number of expression trees */
+    PRX_NODE *pxNode;        /* pointer to any node in a tree */
+
+    PRX_NODE *PriorityStack[MAXEQU]; /* priority stack */
+    PRX_NODE **pSt;                  /* priority stack pointer */
+    int Priority[STOP + 1];          /* operator priority */
+    int IfStatus[MAXLEVEL + 1];
+
+    PRX_OPD **varDefs; /* pointer to variables list */
+    PRX_OPD **auxDefs; /* pointer to auxiliaries list */
+    PRX_OPD **parDefs; /* pointer to parameters list */
+
+    PRX_NODE *N_0, *N_1, *N_2, *N_0p5, *N_1_ln10, *N_2_SQRT_PI;
+}
+
+- (PXModelCompiler *)initWithPath:(NSString *)modelFileName
+                          error:(NSError **)error {
+    return [self initWithPath:modelFileName modes:NULL error:error];
 }
 
-__weak id thisClass; /* for calling self in C-functions */
+/**
+ @brief Compile a model file
+
+ @param modelFileName model definition file
+ @param modes generation of the derivatives per kind: forward, reverse or
+ automatic, NULL for automatic. Reverse mode is used only where the model
+ allows it.
+ @param error error description, output
+ @return compiler, nil on error
+ */
+- (PXModelCompiler *)initWithPath:(NSString *)modelFileName
+                            modes:(const PXDerivativeMode *)modes
+                            error:(NSError **)error {
+    return [self initWithPath:modelFileName
+                        modes:modes
+                       budget:NULL
+                        error:error];
+}
 
-static int prxErrorLineno = 0;
-static char prxErrorString[1024];
+/**
+ @brief Compile a model file, with a budget for the simplification
+
+ @param modelFileName model definition file
+ @param modes generation of the derivatives per kind, NULL for automatic
+ @param budget budget of the simplification of each derivative by equality
+ saturation, NULL for the default
+ @param error error description, output
+ @return compiler, nil on error
+ */
+- (PXModelCompiler *)initWithPath:(NSString *)modelFileName
+                            modes:(const PXDerivativeMode *)modes
+                           budget:(const PXSimplifyBudget *)budget
+                            error:(NSError **)error {
+    return [self initWithPath:modelFileName
+                        modes:modes
+                       budget:budget
+                         lazy:NO
+                        error:error];
+}
 
+/**
+ @brief Compile a model file, with the derivatives generated on request
+
+ @discussion    With lazy set, only the function code is generated. The
+ expression trees are kept by the compiler, and the derivative to a
+ variable, auxiliary or parameter is generated when a code with that
+ column is first requested by getModelCodeForVarColumns:. The derivatives
+ are generated in forward mode, and the code has no parameter stage and no
+ shared subexpressions of the derivatives.
+
+ @param modelFileName model definition file
+ @param modes generation of the derivatives per kind, NULL for automatic,
+ not used when lazy
+ @param budget budget of the simplification of each derivative by equality
+ saturation, NULL for the default
+ @param lazy generate the derivatives on request
+ @param error error description, output
+ @return compiler, nil on error
+ */
 - (PXModelCompiler *)initWithPath:(NSString *)modelFileName
-                          error:(NSError **)error {
+                            modes:(const PXDerivativeMode *)modes
+                           budget:(const PXSimplifyBudget *)budget
+                             lazy:(BOOL)lazy
+                            error:(NSError **)error {
     FILE *inFile;
     const char *fileName;
 
-    prxErrorLineno = 0;
-    prxErrorString[0] = '\0';
-
     NSString *errorDomain = @"com.Middelhoek.ParXModelCompiler";
     NSString *errorDescription;
     NSDictionary *errorUserInfo;
     NSString *errorLineNumber;
+    double t;
 
     self = [super init];
 
     if (self) {
 
+        prxErrorLineno = 0;
+        prxErrorString[0] = '\0';
+        bLazy = lazy ? 1 : 0;
+
+        for (int k = 0; k < 3; k++) {
+            kindMode[k] = modes ? modes[k] : PXDerivativeAutomatic;
+        }
+        if (budget) {
+            egrBudget.maxNodes = budget->maxNodes;
+            egrBudget.maxIter = budget->maxIterations;
+            egrBudget.maxTime = budget->maxSeconds;
+        } else {
+            egrBudget.maxNodes = EGR_MAXNODES;
+            egrBudget.maxIter = EGR_MAXITER;
+            egrBudget.maxTime = EGR_MAXTIME;
+        }
+
         if (!modelFileName || modelFileName.length == 0) {
 
             if (error != nil) {
@@ -118,8 +325,6 @@ static char prxErrorString[1024];
             return nil;
         }
 
-        thisClass = self;
-
         modelCode = [[PXModelCode alloc] init];
         modelCode.fileName = modelFileName;
 
@@ -128,27 +333,57 @@ static char prxErrorString[1024];
 
         [self setStatics];
 
+        t = compileClock();
         if (![self parseModelFile:inFile]) {
             goto error;
         }
+        tPhase[0] += compileClock() - t;
 
         if ([self getError]) { // check for deep errors
             goto error;
         }
 
+        t = compileClock();
         if (![self checkModelConsistency]) {
             goto error;
         }
+        tPhase[1] += compileClock() - t;
+
+        t = compileClock();
+        if (![self eliminateDeadStatements]) {
+            goto error;
+        }
+        tPhase[2] += compileClock() - t;
 
+        if (bLazy) {
+            t = compileClock();
+            if (![self genLazyFunctionCode] || [self getError]) {
+                goto error;
+            }
+            tPhase[3] += compileClock() - t;
+            fclose(inFile);
+            return self;
+        }
+
+        t = compileClock();
         if (![self generateDerivatives]) {
             goto error;
         }
+        tPhase[3] += compileClock() - t;
+
+        t = compileClock();
+        if (![self compactTemporaries]) {
+            goto error;
+        }
+        tPhase[4] += compileClock() - t;
 
         modelCode.numberOfTemp = nTmp;
 
+        t = compileClock();
         if (![self numOut]) {
             goto error;
         }
+        tPhase[5] += compileClock() - t;
 
         if ([self getError]) { // check for deep errors
             goto error;
@@ -189,6 +424,90 @@ error: /* abnormal end of program execution */
     return modelCode;
 }
 
+/**
+ @brief Model code with the derivatives to a selection of columns
+
+ @discussion    Of a lazy compiler, the derivatives to the listed variables
+ and parameters are generated when first requested, and kept. The
+ derivatives to the auxiliaries are generated with the first variable.
+ The code has a derivative section for every column; the ones that are not
+ listed are empty, have an empty Jacobian pattern and are not written by
+ an evaluation. Codes are kept per selection of columns, and are shared by
+ the callers that ask for the same columns. The generation is serialized,
+ so that the compiler may be used from several threads. <br>
+ A compiler that is not lazy returns its code, with all derivatives.
+
+ @param xc list of variables, NULL for all variables
+ @param nxc length of the list of variables
+ @param pc list of parameters, NULL for all parameters
+ @param npc length of the list of parameters
+ @return model code, nil on error
+ */
+- (PXModelCode *)getModelCodeForVarColumns:(const int *)xc
+                                  varCount:(int)nxc
+                                parColumns:(const int *)pc
+                                  parCount:(int)npc {
+    char *want; /* column is requested, variables then parameters */
+    int anyVar = 0;
+    NSData *key;
+    PXModelCode *code = nil;
+    double t;
+
+    if (!bLazy) {
+        return modelCode;
+    }
+    if ((xc && nxc < 0) || (pc && npc < 0)) {
+        return nil;
+    }
+    want = (char *)calloc(nVar + nPar + 1, 1);
+    for (int q = 0; q < (xc ? nxc : nVar); q++) {
+        int j = xc ? xc[q] : q;
+        if (j < 0 || j >= nVar) {
+            free(want);
+            return nil;
+        }
+        want[j] = 1;
+        anyVar = 1;
+    }
+    for (int q = 0; q < (pc ? npc : nPar); q++) {
+        int j = pc ? pc[q] : q;
+        if (j < 0 || j >= nPar) {
+            free(want);
+            return nil;
+        }
+        want[nVar + j] = 1;
+    }
+    key = [NSData dataWithBytes:want length:nVar + nPar];
+
+    @synchronized(self) {
+        t = compileClock();
+        code = lazyCodes[key];
+        for (int j = 0; !code && j < nVar + nPar + nAux; j++) {
+            PXDerivativeKind kind = (j < nVar)          ? PXDerivativeVar
+                                    : (j < nVar + nPar) ? PXDerivativePar
+                                                        : PXDerivativeAux;
+            int col = (kind == PXDerivativeVar)   ? j
+                      : (kind == PXDerivativePar) ? j - nVar
+                                                  : j - nVar - nPar;
+            if (kind == PXDerivativeAux ? !anyVar : !want[j]) {
+                continue;
+            }
+            if (![self lazySectionForKind:kind column:col]) {
+                free(want);
+                return nil;
+            }
+        }
+        if (!code) {
+            code = [self assembleCodeForColumns:want];
+            lazyCodes[key] = code;
+        }
+        tPhase[3] += compileClock() - t;
+    }
+    free(want);
+
+    return code;
+}
+
 - (NSMutableArray *)getSymbolsNotAssigned {
     return symbolsNotAssigned;
 }
@@ -197,6 +516,60 @@ error: /* abnormal end of program execution */
     return symbolsNotUsed;
 }
 
+/**
+ @brief Number of rewrites of the code
+
+ @return "power": powers reduced to multiplications, square roots and
+ reciprocals, "exp": products and quotients of exponentials fused,
+ "saturation": derivatives replaced by a cheaper equal expression,
+ "dead": statements removed because they do not contribute to a residual,
+ "temporary": temporaries removed from the code
+ */
+- (NSDictionary<NSString *, NSNumber *> *)getRewriteCounts {
+    return @{
+        @"power" : @(nPowReduced),
+        @"exp" : @(nExpFused),
+        @"saturation" : @(nSaturated),
+        @"dead" : @(nDead),
+        @"temporary" : @(nSlotFreed)
+    };
+}
+
+/**
+ @brief Statistics of the compilation
+
+ @discussion    The times are wall times in seconds; the derivatives of a
+ lazy compiler add the time of their generation on request. The memory
+ trees of the expressions only grow while the compiler exists, so their
+ size is also their peak. Nodes are counted per statement and derivative,
+ a shared subexpression once for each use.
+
+ @return "parseSeconds", "checkSeconds", "deadSeconds",
+ "derivativeSeconds", "temporarySeconds" and "numberSeconds": time per
+ phase, "treeBytes" and "derivativeTreeBytes": memory of the expressions
+ and of their derivatives, "parsedNodes" and "simplifiedNodes": nodes of
+ the statements before and after simplification, "derivativeNodes" and
+ "simplifiedDerivativeNodes": the same of the derivatives
+ */
+- (NSDictionary<NSString *, NSNumber *> *)getCompileStatistics {
+    @synchronized(self) {
+        return @{
+            @"parseSeconds" : @(tPhase[0]),
+            @"checkSeconds" : @(tPhase[1]),
+            @"deadSeconds" : @(tPhase[2]),
+            @"derivativeSeconds" : @(tPhase[3]),
+            @"temporarySeconds" : @(tPhase[4]),
+            @"numberSeconds" : @(tPhase[5]),
+            @"treeBytes" : @(Tree ? Tree->size : 0),
+            @"derivativeTreeBytes" : @(DTree ? DTree->size : 0),
+            @"parsedNodes" : @(nNodes[0]),
+            @"simplifiedNodes" : @(nNodes[1]),
+            @"derivativeNodes" : @(nNodes[2]),
+            @"simplifiedDerivativeNodes" : @(nNodes[3])
+        };
+    }
+}
+
 + (NSString *)getReservedNameTokens {
     NSString *tokenString = [NSString stringWithCString:reserved_name_tokens
                                                encoding:NSASCIIStringEncoding];
@@ -215,6 +588,46 @@ error: /* abnormal end of program execution */
     return tokenString;
 }
 
+/**
+ @brief Compile a number of model files in parallel
+
+ @discussion    Each file is compiled by a compiler of its own, on as many
+ threads as there are active processors.
+
+ @param paths model definition files
+ @return for each file its PXModelCode, or the NSError of the compilation
+ */
++ (NSArray *)compileModelsAtPaths:(NSArray<NSString *> *)paths {
+
+    NSUInteger nPaths = [paths count];
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:nPaths];
+    for (NSUInteger i = 0; i < nPaths; i++) {
+        [results addObject:[NSNull null]];
+    }
+
+    dispatch_queue_t queue =
+        dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+
+    dispatch_apply(nPaths, queue, ^(size_t i) {
+        NSError *error = nil;
+        id result;
+        @autoreleasepool {
+            PXModelCompiler *compiler =
+                [[PXModelCompiler alloc] initWithPath:paths[i] error:&error];
+            if (compiler) {
+                result = [compiler getModelCode];
+            } else {
+                result = error;
+            }
+        }
+        @synchronized(results) {
+            results[i] = result;
+        }
+    });
+
+    return results;
+}
+
 /* ========================================================================== */
 
 static const struct {
@@ -228,55 +641,20 @@ static const struct {
              {"sign", SGN},  {"not", NOT}};
 static const int nFunSt = sizeof(FunSt) / sizeof(FunSt[0]);
 
-static struct MEM_TREE *Tree, *DTree; /* memory trees */
-static struct BT_HEAD *BtNames;       /* balanced bin. tree of names */
-static struct BT_HEAD *BtNumbers;     /* balanced bin. tree of numbers */
-
-static int prxLineno; /* line number model file */
-static int prxError;  /* general error flag */
-static int bDeriv;    /* Deriv.s are (not) actually computed */
-static int ifLevel;   /* if nesting level */
-static int bAssign;   /* subexpression can start with assign */
-
-static char *sModel, *sDate, *sAuthor; /* model identifiers */
-static char *sVersion, *sIdent;
-
-static int nVar, nAux; /* number of model symbols */
-static int nPar, nCon, nFlag;
-static int nRes, nNum, nTmp;
-
-static double *Numbers; /* numeric constants */
-
-static PRX_NODE *NodeH[MAXEQU]; /* array of tree pointers */
-static int UsageFlag[MAXEQU];   /* bit flag: operand of corr. is */
-static int TmpTyp[MAXEQU];      /* flag: corresponding temporary derivative
-                                 * is (not) needed to compute further */
-static PRX_NODE **pHead;        /* pointer for array NodeH */
-static int nHead;               /* number of expression trees */
-static PRX_NODE *pxNode;        /* pointer to any node in a tree */
-
-static PRX_NODE *PriorityStack[MAXEQU]; /* priority stack */
-static PRX_NODE **pSt;                  /* priority stack pointer */
-static int Priority[STOP + 1];          /* operator priority */
-static int IfStatus[MAXLEVEL + 1];
-
-static PRX_OPD **varDefs; /* pointer to variables list */
-static PRX_OPD **auxDefs; /* pointer to auxiliaries list */
-static PRX_OPD **parDefs; /* pointer to parameters list */
-
-static PRX_NODE *N_0, *N_1, *N_2, *N_0p5, *N_1_ln10, *N_2_SQRT_PI;
-
 /* forward function prototypes */
 static int bt_cmp_names(void *s1, void *s2);
 static int bt_cmp_numbers(void *s1, void *s2);
-static int namTraverse(char *rec);
-static int namTraverse2(char *rec);
-static int numTraverse(char *rec);
+static int bt_cmp_nodes(void *s1, void *s2);
+static int bt_cmp_shared(void *s1, void *s2);
+static int bt_cmp_saturated(void *s1, void *s2);
+static int namTraverse(char *rec, void *ctx);
+static int namTraverse2(char *rec, void *ctx);
+static int numTraverse(char *rec, void *ctx);
 
 /**
  @brief Initialization routine
 
- Reset all the statically declared C variables
+ Reset the compilation state
 
  @return 0 - error, 1 - success
  */
@@ -289,12 +667,29 @@ static int numTraverse(char *rec);
 
     BtNames = bt_define_tree(Tree, bt_cmp_names);
     BtNumbers = bt_define_tree(Tree, bt_cmp_numbers);
+    BtNodes = bt_define_tree(Tree, bt_cmp_nodes);
+    BtShared = NULL;
+    pShareFirst = pShareLast = NULL;
+    BtSaturated = bt_define_tree(DTree, bt_cmp_saturated);
 
     prxLineno = 0;
     prxError = 0;
     bDeriv = 0;
     ifLevel = 0;
     bAssign = 1;
+    bShare = 0;
+    bFunction = 0;
+    nPowReduced = 0;
+    nExpFused = 0;
+    nSaturated = 0;
+    nDead = 0;
+    nSlotFreed = 0;
+    for (int i = 0; i < 6; i++) {
+        tPhase[i] = 0;
+    }
+    for (int i = 0; i < 4; i++) {
+        nNodes[i] = 0;
+    }
 
     sModel = sDate = sAuthor = sVersion = sIdent = NULL;
     nVar = nAux = nPar = nCon = nFlag = 0;
@@ -305,6 +700,8 @@ static int numTraverse(char *rec);
         NodeH[i] = NULL;
         UsageFlag[i] = 0;
         TmpTyp[i] = 0;
+        TmpTape[i] = NULL;
+        TmpStage[i] = 0;
         PriorityStack[i] = NULL;
     }
 
@@ -358,6 +755,7 @@ static int numTraverse(char *rec);
 
     sT = Tree ? mem_free(Tree) : 0;
     sD = DTree ? mem_free(DTree) : 0;
+    Tree = DTree = NULL;
 
     return (int)(sT + sD);
 }
@@ -407,6 +805,38 @@ int bt_cmp_numbers(void *s1, void *s2) {
                : (((PRX_NUM *)s1)->val > ((PRX_NUM *)s2)->val) ? 1 : 0;
 }
 
+/** comparison routine for the balanced binary tree of nodes */
+int bt_cmp_nodes(void *s1, void *s2) {
+    PRX_CONS *c1 = (PRX_CONS *)s1, *c2 = (PRX_CONS *)s2;
+
+    if (c1->opr != c2->opr) {
+        return (c1->opr < c2->opr) ? -1 : 1;
+    }
+    if (c1->o1 != c2->o1) {
+        return ((uintptr_t)c1->o1 < (uintptr_t)c2->o1) ? -1 : 1;
+    }
+    if (c1->o2 != c2->o2) {
+        return ((uintptr_t)c1->o2 < (uintptr_t)c2->o2) ? -1 : 1;
+    }
+    return 0;
+}
+
+/** comparison routine for the balanced binary tree of shared subexpressions */
+int bt_cmp_shared(void *s1, void *s2) {
+    uintptr_t n1 = (uintptr_t)((PRX_SHARE *)s1)->node;
+    uintptr_t n2 = (uintptr_t)((PRX_SHARE *)s2)->node;
+
+    return (n1 < n2) ? -1 : (n1 > n2) ? 1 : 0;
+}
+
+/** comparison routine for the balanced binary tree of saturated derivatives */
+int bt_cmp_saturated(void *s1, void *s2) {
+    uintptr_t n1 = (uintptr_t)((PRX_SATURATE *)s1)->node;
+    uintptr_t n2 = (uintptr_t)((PRX_SATURATE *)s2)->node;
+
+    return (n1 < n2) ? -1 : (n1 > n2) ? 1 : 0;
+}
+
 /* ========================================================================== */
 
 /**
@@ -663,6 +1093,51 @@ int bt_cmp_numbers(void *s1, void *s2) {
     return p;
 }
 
+/**
+ @brief Providing a node contained in balanced binary tree of nodes
+
+ @discussion    A node with the same operator and operands is created once,
+ so that equal subexpressions are shared within and between the expression
+ trees, and the derivative trees. A node is found by the operator and
+ operands it was created with: simplification changes a node in place into
+ one with the same value. Statements are always created anew.
+
+ @param opr operator
+ @param o1 first operand
+ @param o2 second operand
+ @param tree memory tree for a new node
+ @return node pointer
+ */
+- (PRX_NODE *)getNode:(OPR)opr
+             withLeft:(PRX_NODE *)o1
+            withRight:(PRX_NODE *)o2
+               inTree:(struct MEM_TREE *)tree {
+
+    PRX_CONS key, *pCons;
+    PRX_NODE *p;
+
+    key.opr = opr;
+    key.o1 = o1;
+    key.o2 = o2;
+    if (opr != ASS && opr != IF) {
+        pCons = (PRX_CONS *)bt_search(BtNodes, (char *)&key);
+        if (pCons) {
+            return pCons->node;
+        }
+    }
+    p = (PRX_NODE *)mem_slot(tree, sizeof(PRX_NODE));
+    p->opr = opr;
+    p->o1 = o1;
+    p->c.o2 = o2;
+    if (opr != ASS && opr != IF) {
+        pCons = (PRX_CONS *)mem_slot(Tree, sizeof(PRX_CONS));
+        *pCons = key;
+        pCons->node = p;
+        bt_insert(BtNodes, (char *)pCons);
+    }
+    return p;
+}
+
 /* ========================================================================== */
 
 /**
@@ -945,16 +1420,17 @@ int bt_cmp_numbers(void *s1, void *s2) {
  @param rec symbol to index
  @return 0 - success
  */
-int namTraverse(char *rec) {
+int namTraverse(char *rec, void *ctx) {
+    PXModelCompiler *compiler = (__bridge PXModelCompiler *)ctx;
     PRX_OPD *pOpd;
 
     pOpd = (PRX_OPD *)rec;
     if (pOpd->typ == PAR) {
-        parDefs[pOpd->ind] = pOpd;
+        compiler->parDefs[pOpd->ind] = pOpd;
     } else if (pOpd->typ == VAR) {
-        varDefs[pOpd->ind] = pOpd;
+        compiler->varDefs[pOpd->ind] = pOpd;
     } else if (pOpd->typ == AUX) {
-        auxDefs[pOpd->ind] = pOpd;
+        compiler->auxDefs[pOpd->ind] = pOpd;
     }
     return 0;
 }
@@ -970,7 +1446,7 @@ int namTraverse(char *rec) {
     auxDefs = (PRX_OPD **)mem_slot(Tree, nAux * sizeof(PRX_OPD *));
     parDefs = (PRX_OPD **)mem_slot(Tree, nPar * sizeof(PRX_OPD *));
 
-    bt_traverse(BtNames, namTraverse);
+    bt_traverse(BtNames, namTraverse, (__bridge void *)self);
 
     return 1;
 }
@@ -985,7 +1461,8 @@ int namTraverse(char *rec) {
  @param rec symbol to check
  @return 0 - success
  */
-int namTraverse2(char *rec) {
+int namTraverse2(char *rec, void *ctx) {
+    PXModelCompiler *compiler = (__bridge PXModelCompiler *)ctx;
     PRX_OPD *pOpd;
     TYP typ;
 
@@ -993,15 +1470,15 @@ int namTraverse2(char *rec) {
     typ = pOpd->typ;
     if (typ == PAR || typ == VAR || typ == TMP || typ == AUX) {
 
-        if (!(UsageFlag[pOpd->ind] & (1 << typ))) {
+        if (!(compiler->UsageFlag[pOpd->ind] & (1 << typ))) {
 
-            [thisClass addNotUsed:pOpd->name];
+            [compiler addNotUsed:pOpd->name];
         }
     } else if (typ == RES) {
 
-        if (!(UsageFlag[pOpd->ind] & (1 << typ))) {
+        if (!(compiler->UsageFlag[pOpd->ind] & (1 << typ))) {
 
-            [thisClass addNotAssigned:pOpd->name];
+            [compiler addNotAssigned:pOpd->name];
         }
     }
 
@@ -1030,7 +1507,7 @@ int namTraverse2(char *rec) {
         ERRORA("Maximum number of statements (%d) exceeded", MAXEQU);
     }
 
-    bt_traverse(BtNames, namTraverse2);
+    bt_traverse(BtNames, namTraverse2, (__bridge void *)self);
 
     if (nRes <= 0) {
         ERROR("No residuals");
@@ -1043,6 +1520,189 @@ int namTraverse2(char *rec) {
     return 1;
 }
 
+/**
+ @brief Temporaries read by an expression
+
+ @discussion    Unlike operandsOfNode, a tape is not replaced by its
+ operands: its own temporary is read.
+
+ @param p expression
+ @param opr OPD for the values of the temporaries, DOPD for their
+ derivatives
+ @param read flag per temporary, set for the ones that are read
+ @return number of flags set
+ */
+- (int)temporariesOfNode:(PRX_NODE *)p
+            withOperator:(OPR)opr
+                    into:(int *)read {
+
+    if (!p) {
+        return 0;
+    }
+    switch (p->opr) {
+    case OPD:
+    case DOPD:
+        if (p->opr == opr && p->c.optr->typ == TMP &&
+            !read[p->c.optr->ind]) {
+            read[p->c.optr->ind] = 1;
+            return 1;
+        }
+        return 0;
+    case NUM:
+        return 0;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        return [self temporariesOfNode:p->o1 withOperator:opr into:read] +
+               [self temporariesOfNode:p->c.o2 withOperator:opr into:read];
+    default:
+        return [self temporariesOfNode:p->o1 withOperator:opr into:read];
+    }
+}
+
+/**
+ @brief Remove statements from the statement list
+
+ @param keep flag per statement: it is kept
+ @return number of statements removed
+ */
+- (int)compactStatements:(const int *)keep {
+    int s, n = 0;
+
+    for (s = 0; NodeH[s]; s++) {
+        if (keep[s]) {
+            StmLine[n] = StmLine[s];
+            NodeH[n++] = NodeH[s];
+        }
+    }
+    for (int i = n; i < s; i++) {
+        NodeH[i] = NULL;
+    }
+    nHead = n;
+    pHead = NodeH + n;
+    nDead += s - n;
+
+    return s - n;
+}
+
+/**
+ @brief Remove the statements that do not contribute to a residual
+
+ @discussion    The branch of a condition of constant value that is never
+ taken is removed, together with the if, else and fi around the other
+ branch. The remaining statements are then scanned backward: an assignment
+ is live when it assigns a residual, or a temporary that a live statement
+ after it reads; an error statement is always live, as the failure it
+ reports is a result of the model; an if is live when a branch holds a
+ live statement, its else only when the else branch does. An assignment
+ outside the conditionals ends the liveness of its temporary before it.
+ The temporaries that are no longer assigned are removed from the code by
+ compactTemporaries.
+
+ @return 0 - error, 1 - success
+ */
+- (int)eliminateDeadStatements {
+    int Keep[MAXEQU];    /* statement is kept */
+    int TmpLive[MAXEQU]; /* value of the temporary is read further on */
+    int Inner[MAXEQU];   /* if: a branch holds a live statement */
+    int InElse[MAXEQU];  /* if: the else branch holds a live statement */
+    int nStm, a, b, e, f, m, x;
+
+    for (nStm = 0; NodeH[nStm]; nStm++) {
+        ;
+    }
+
+    /* branches of conditions of constant value */
+    [self nestStatements];
+    for (int s = 0; s < nStm; s++) {
+        Keep[s] = 1;
+    }
+    for (int s = 0; s < nStm; s++) {
+        pxNode = NodeH[s];
+        if (!Keep[s] || pxNode->opr != IF || pxNode->o1->opr != NUM) {
+            continue;
+        }
+        e = StmMatch[s];
+        for (f = s + 1; NodeH[f]->opr != FI || StmMatch[f] != s; f++) {
+            ;
+        }
+        if (pxNode->o1->c.nptr->val != 0) {
+            a = (e >= 0) ? e : f; /* else branch */
+            b = f;
+        } else {
+            a = s; /* if branch */
+            b = (e >= 0) ? e : f;
+        }
+        for (x = a; x <= b; x++) {
+            Keep[x] = 0;
+        }
+        Keep[s] = Keep[f] = 0;
+    }
+    nStm -= [self compactStatements:Keep];
+
+    /* live statements */
+    [self nestStatements];
+    for (int t = 0; t < nTmp; t++) {
+        TmpLive[t] = 0;
+    }
+    for (int s = 0; s < nStm; s++) {
+        Keep[s] = Inner[s] = InElse[s] = 0;
+    }
+    for (int s = nStm - 1; s >= 0; s--) {
+        pxNode = NodeH[s];
+        if (pxNode->opr == IF) {
+            if (Inner[s]) {
+                Keep[s] = 1;
+                [self temporariesOfNode:pxNode->o1
+                          withOperator:OPD
+                                  into:TmpLive];
+            }
+            continue;
+        }
+        if (pxNode->opr != ASS && pxNode->opr != RET) {
+            continue;
+        }
+        if (pxNode->opr == ASS && pxNode->c.optr->typ == TMP) {
+            if (!TmpLive[pxNode->c.optr->ind]) {
+                continue;
+            }
+            if (StmIf[s] < 0) {
+                TmpLive[pxNode->c.optr->ind] = 0;
+            }
+        }
+        Keep[s] = 1;
+        [self temporariesOfNode:pxNode->o1
+                          withOperator:OPD
+                                  into:TmpLive];
+        for (x = s, m = StmIf[s]; m >= 0; x = m, m = StmIf[m]) {
+            Inner[m] = 1;
+            if (StmBranch[x]) {
+                InElse[m] = 1;
+            }
+        }
+    }
+    for (int s = 0; s < nStm; s++) {
+        if (NodeH[s]->opr == ELSE) {
+            Keep[s] = InElse[StmMatch[s]];
+        } else if (NodeH[s]->opr == FI) {
+            Keep[s] = Inner[StmMatch[s]];
+        }
+    }
+    [self compactStatements:Keep];
+
+    return 1;
+}
+
 /* ========================================================================== */
 
 /**
@@ -1070,10 +1730,22 @@ int namTraverse2(char *rec) {
         if (length <= 0) {
             return 0;
         }
+        /* a condition of constant value folds to a number */
+        [self simplifyExpressionAtNode:pxNode];
+        if (pxNode->opr == EQU) {
+            pxNode = pxNode->o1;
+        }
         pNodeV = pxNode;
+        if (pNodeV->opr != OPD && pNodeV->opr != NUM) {
+            /* branch record: the derivatives test the stored outcome */
+            pNodeV = [self tapeForNode:pNodeV name:"branch"];
+            if (!pNodeV) {
+                return 0;
+            }
+        }
         NODE(pxNode, IF, pNodeV, NULL);
+        StmLine[pHead - NodeH] = prxLineno;
         *(pHead++) = pxNode;
-        [self genCodeForNode:pxNode];
         if (ifLevel >= MAXLEVEL) {
             ERRORA("Maximum 'if' hierarchy depth (%d) exceeded", MAXLEVEL);
         }
@@ -1088,8 +1760,8 @@ int namTraverse2(char *rec) {
             ERROR("Multiple 'else'");
         }
         NODE(pxNode, ELSE, NULL, NULL);
+        StmLine[pHead - NodeH] = prxLineno;
         *(pHead++) = pxNode;
-        [self genCodeForNode:pxNode];
         IfStatus[ifLevel] = 1;
         return 1;
     } else if (strcmp(equation, "fi") == 0) {
@@ -1097,8 +1769,8 @@ int namTraverse2(char *rec) {
             ERROR("No active 'if' statement");
         }
         NODE(pxNode, FI, NULL, NULL);
+        StmLine[pHead - NodeH] = prxLineno;
         *(pHead++) = pxNode;
-        [self genCodeForNode:pxNode];
         ifLevel--;
         return 1;
     }
@@ -1109,14 +1781,148 @@ int namTraverse2(char *rec) {
     if (length <= 0 || equation[length] != 0) {
         return 0;
     }
+    nNodes[0] += [self nodesOfNode:pxNode];
     [self simplifyExpressionAtNode:pxNode];
     [self simplifyExpressionAtNode:pxNode];
+    nNodes[1] += [self nodesOfNode:pxNode];
+    if (pxNode->opr == ASS) {
+        pNodeV = pxNode;
+        pNodeV->o1 = [self tapeAtNode:pNodeV->o1 root:1];
+        if (!pNodeV->o1) {
+            return 0;
+        }
+        pxNode = pNodeV;
+    }
+    StmLine[pHead - NodeH] = prxLineno;
     *(pHead++) = pxNode;
-    [self genCodeForNode:pxNode];
 
     return 1;
 }
 
+/**
+ @brief Tape of the primal values that the derivatives use
+
+ @discussion    The derivative of exp(u), sqrt(u), tan(u), and of u^v with
+ a variable exponent, contains the value of the function itself. Such a
+ subexpression of an assignment is first assigned to a temporary of its
+ own, the tape, which the assignment then uses, so that the derivatives
+ load the value instead of computing it again. The value of the whole
+ right-hand side is the target of the assignment, and is not taped. <br>
+ The base of a power that is reduced to multiplications, and that uses
+ its base more than once, is taped as well. <br>
+ A tape has no derivative or gradient of its own: its derivative is
+ used in the derivative of the assignment, as before, and its operands
+ count as the operands of the assignment.
+
+ @param p expression
+ @param root the expression is the right-hand side of the assignment
+ @return expression with the tapes as operands, NULL on error
+ */
+- (PRX_NODE *)tapeAtNode:(PRX_NODE *)p root:(int)root {
+    PRX_OPD *opd[MAXCMD];
+    PRX_NODE *p1, *p2;
+    int n, var;
+
+    switch (p->opr) {
+    case OPD:
+    case NUM:
+        return p;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        p1 = [self tapeAtNode:p->o1 root:0];
+        p2 = [self tapeAtNode:p->c.o2 root:0];
+        if (!p1 || !p2) {
+            return NULL;
+        }
+        if ([self powerLoadsOfNode:p] > 1 && p1->opr != OPD &&
+            p1->opr != NUM) {
+            p1 = [self tapeForNode:p1 name:"base"];
+            if (!p1) {
+                return NULL;
+            }
+        }
+        if (p1 != p->o1 || p2 != p->c.o2) {
+            p = [self getNode:p->opr withLeft:p1 withRight:p2 inTree:Tree];
+        }
+        break;
+    default:
+        p1 = [self tapeAtNode:p->o1 root:0];
+        if (!p1) {
+            return NULL;
+        }
+        if (p1 != p->o1) {
+            p = [self getNode:p->opr withLeft:p1 withRight:NULL inTree:Tree];
+        }
+        break;
+    }
+    if (root) {
+        return p;
+    }
+
+    /* the argument, or the exponent, must have a derivative */
+    switch (p->opr) {
+    case EXP:
+    case SQRT:
+    case TAN:
+        n = [self operandsOfNode:p->o1 into:opd count:0];
+        break;
+    case POW:
+        n = [self operandsOfNode:p->c.o2 into:opd count:0];
+        break;
+    default:
+        return p;
+    }
+    var = 0;
+    for (int i = 0; i < n; i++) {
+        if (opd[i]->typ != CON && opd[i]->typ != FLG) {
+            var = 1;
+        }
+    }
+    if (!var) {
+        return p;
+    }
+
+    return [self tapeForNode:p name:"tape"];
+}
+
+/**
+ @brief Assignment of an expression to a new tape
+
+ @param p expression
+ @param name name of the temporary
+ @return operand of the tape, NULL on error
+ */
+- (PRX_NODE *)tapeForNode:(PRX_NODE *)p name:(char *)name {
+    PRX_OPD *pOpd;
+    PRX_NODE *pT;
+
+    if (++nHead > MAXEQU) {
+        ERRORA("Maximum number of statements (%d) exceeded", MAXEQU);
+    }
+    pOpd = (PRX_OPD *)mem_slot(Tree, sizeof(PRX_OPD));
+    pOpd->name = name;
+    pOpd->typ = TMP;
+    pOpd->ind = nTmp++;
+    NODE(pT, OPD, NULL, (PRX_NODE *)pOpd);
+    pOpd->node = pT;
+    NODE(pT, ASS, p, (PRX_NODE *)pOpd);
+    TmpTape[pOpd->ind] = pT;
+    StmLine[pHead - NodeH] = prxLineno;
+    *(pHead++) = pT;
+    return pOpd->node;
+}
+
 /* ========================================================================== */
 
 /**
@@ -1274,10 +2080,16 @@ operation:
         pSt--;
         iOp--;
         if (Op[iOp] == NEG || Op[iOp] == NOT) { /* 1 operand  */
-            NODE(pxNode, Op[iOp], *pSt, NULL);
+            pxNode = [self getNode:Op[iOp]
+                          withLeft:*pSt
+                         withRight:NULL
+                            inTree:Tree];
         } else { /* 2 operands */
             pSt--;
-            NODE(pxNode, Op[iOp], *pSt, *(pSt + 1));
+            pxNode = [self getNode:Op[iOp]
+                          withLeft:*pSt
+                         withRight:*(pSt + 1)
+                            inTree:Tree];
         }
         *(pSt++) = pxNode;
     }
@@ -1390,7 +2202,10 @@ function: /* function call */
         ERRORA("Argument error in function '%s'", name);
     }
     pSt--;
-    NODE(pxNode, FunSt[iFun].opr, *pSt, NULL);
+    pxNode = [self getNode:FunSt[iFun].opr
+                  withLeft:*pSt
+                 withRight:NULL
+                    inTree:Tree];
     *(pSt++) = pxNode;
     pExpr += length + 1;
     goto operation;
@@ -1401,20 +2216,39 @@ function: /* function call */
 /**
  @brief Generation of arithmetic code from parse tree
 
+ @discussion    Of a sum, a product, a logical operator or a comparison,
+ the operand that needs the deeper operand stack is generated first; a
+ comparison is mirrored when its operands are exchanged. This keeps the
+ operand stack of the interpreter as shallow as possible.
+
  @param pNode node in the parse tree
  @return 0 - error, 1 - success
  */
 - (int)genCodeForNode:(PRX_NODE *)pNode {
     OPR opr;
     TYP typ;
+    int ind;
     double value;
     PRX_NODE *pN;
+    PRX_NODE *p1, *p2; /* operands in the order of their code */
 
     if (!pNode) {
         return 0;
     }
-    opr = pNode->opr;
-    switch (opr) {
+    if (bShare) {
+        ind = [self sharedSlotForNode:pNode];
+        if (ind == -2) {
+            return 1; /* counted, the code is discarded */
+        }
+        if (ind >= 0) {
+            [modelCode addOperator:OPD];
+            [modelCode addType:TMP];
+            [modelCode addIndex:ind];
+            return 1;
+        }
+    }
+    opr = pNode->opr;
+    switch (opr) {
     case AND:
     case OR:
     case LT:
@@ -1425,7 +2259,35 @@ function: /* function call */
     case NE:
     case MUL:
     case DIV:
+        p1 = pNode->o1;
+        p2 = pNode->c.o2;
+        if (opr != DIV &&
+            [self stackNeedOfNode:p2] > [self stackNeedOfNode:p1]) {
+            p1 = pNode->c.o2;
+            p2 = pNode->o1;
+            opr = (opr == LT)   ? GT
+                  : (opr == GT) ? LT
+                  : (opr == LE) ? GE
+                  : (opr == GE) ? LE
+                                : opr;
+        }
+        if (![self genCodeForNode:p1]) {
+            return 0;
+        }
+        if (![self genCodeForNode:p2]) {
+            return 0;
+        }
+        [modelCode addOperator:opr];
+        break;
     case POW:
+        ind = [self powerLoadsOfNode:pNode];
+        if (ind == 1 || (ind > 1 && (pNode->o1->opr == OPD ||
+                                     pNode->o1->opr == DOPD))) {
+            if (![self genReducedPowerOfNode:pNode]) {
+                return 0;
+            }
+            break;
+        }
         if (![self genCodeForNode:pNode->o1]) {
             return 0;
         }
@@ -1459,10 +2321,16 @@ function: /* function call */
             }
             [modelCode addOperator:INC];
         } else {
-            if (![self genCodeForNode:pNode->o1]) {
+            p1 = pNode->o1;
+            p2 = pNode->c.o2;
+            if ([self stackNeedOfNode:p2] > [self stackNeedOfNode:p1]) {
+                p1 = pNode->c.o2;
+                p2 = pNode->o1;
+            }
+            if (![self genCodeForNode:p1]) {
                 return 0;
             }
-            if (![self genCodeForNode:pNode->c.o2]) {
+            if (![self genCodeForNode:p2]) {
                 return 0;
             }
             [modelCode addOperator:opr];
@@ -1517,6 +2385,8 @@ function: /* function call */
             typ = DRES;
         } else if (typ == TMP) {
             typ = DTMP;
+        } else if (typ == VAR || typ == AUX || typ == PAR) {
+            typ = DJAC; /* adjoint, reverse mode */
         }
         [modelCode addType:typ];
         [modelCode addIndex:pNode->c.optr->ind];
@@ -1551,6 +2421,8 @@ function: /* function call */
                     }
                 }
                 typ = DTMP;
+            } else if (typ == VAR || typ == AUX || typ == PAR) {
+                typ = DJAC;
             }
         }
         [modelCode addOperator:opr];
@@ -1592,6 +2464,236 @@ function: /* function call */
     return 1;
 }
 
+/**
+ @brief Depth of the operand stack that the code of an expression needs
+
+ @discussion    The Sethi-Ullman number of the expression: a binary
+ operator needs the larger of the depths of its operands, or one more
+ when these are equal, as the operand generated first stays on the stack
+ while the other is computed. genCodeForNode generates the operand that
+ needs the deeper stack first, for the operators of which the operands
+ can be exchanged. Powers that are reduced and subexpressions that are
+ shared are counted as written.
+
+ @param p expression
+ @return depth of the operand stack
+ */
+- (int)stackNeedOfNode:(PRX_NODE *)p {
+    int n1, n2;
+
+    if (!p) {
+        return 0;
+    }
+    switch (p->opr) {
+    case OPD:
+    case DOPD:
+    case NUM:
+        return 1;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        n1 = [self stackNeedOfNode:p->o1];
+        n2 = [self stackNeedOfNode:p->c.o2];
+        return (n1 == n2) ? n1 + 1 : (n1 > n2) ? n1 : n2;
+    default:
+        return [self stackNeedOfNode:p->o1];
+    }
+}
+
+/**
+ @brief Number of nodes of an expression, as written
+
+ @discussion    A subexpression that the expression uses more than once is
+ counted for each use, as the code generated for it.
+
+ @param p expression
+ @return number of nodes
+ */
+- (long)nodesOfNode:(PRX_NODE *)p {
+    if (!p) {
+        return 0;
+    }
+    switch (p->opr) {
+    case OPD:
+    case DOPD:
+    case NUM:
+        return 1;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        return 1 + [self nodesOfNode:p->o1] + [self nodesOfNode:p->c.o2];
+    default:
+        return 1 + [self nodesOfNode:p->o1];
+    }
+}
+
+/** largest magnitude of a constant exponent that is reduced to
+ * multiplications */
+#define MAXPOWER 4
+
+/**
+ @brief Loads of the base of a power in its reduced code
+
+ @discussion    A power with a constant integer or half-integer exponent,
+ of magnitude up to MAXPOWER, is reduced to SQR, MUL, SQRT and REV instead
+ of a call of pow(). Exponents 3, 1.5, 2.5 and 3.5 use the base more than
+ once.
+
+ @param p expression
+ @return number of times the reduced code loads the base, 0 when the
+ power is not reduced
+ */
+- (int)powerLoadsOfNode:(PRX_NODE *)p {
+    double e;
+    int k;
+
+    if (p->opr != POW || p->c.o2->opr != NUM) {
+        return 0;
+    }
+    e = fabs(p->c.o2->c.nptr->val);
+    if (e == 0 || e > MAXPOWER || 2 * e != floor(2 * e)) {
+        return 0;
+    }
+    k = (int)e;
+    return ((k == 3) ? 2 : (k > 0) ? 1 : 0) + ((e > k) ? 1 : 0);
+}
+
+/**
+ @brief Generation of the reduced code of a power
+
+ @param p power with a constant exponent
+ @return 0 - error, 1 - success
+ */
+- (int)genReducedPowerOfNode:(PRX_NODE *)p {
+    double e = fabs(p->c.o2->c.nptr->val);
+    int k = (int)e; /* integer part of the exponent */
+
+    if (k > 0) {
+        if (![self genCodeForNode:p->o1]) {
+            return 0;
+        }
+        if (k >= 2) {
+            [modelCode addOperator:SQR];
+        }
+        if (k == 3) {
+            if (![self genCodeForNode:p->o1]) {
+                return 0;
+            }
+            [modelCode addOperator:MUL];
+        } else if (k == 4) {
+            [modelCode addOperator:SQR];
+        }
+    }
+    if (e > k) { /* half-integer */
+        if (![self genCodeForNode:p->o1]) {
+            return 0;
+        }
+        [modelCode addOperator:SQRT];
+        if (k > 0) {
+            [modelCode addOperator:MUL];
+        }
+    }
+    if (p->c.o2->c.nptr->val < 0) {
+        [modelCode addOperator:REV];
+    }
+    if (bShare != 1) {
+        nPowReduced++;
+    }
+    return 1;
+}
+
+/**
+ @brief Code of the function
+
+ @discussion    The code starts with the parameter stage: the assignments
+ to the temporaries of the stage, followed by the subexpressions of
+ parameters, constants and flags of the other statements and of the
+ derivatives, each assigned to a temporary of its own. An SOP operator ends
+ the stage, when there is one. The other statements follow, in which these
+ subexpressions are replaced by their temporaries. <br>
+ While counting, only the subexpressions of the stage are recorded.
+
+ @return 0 - error, 1 - success
+ */
+- (int)genFunctionCode {
+    int share = bShare;
+    int n = nTmp;    /* temporaries before the stage */
+    int stage = 0;   /* statements in the stage */
+
+    bDeriv = 0;
+    bFunction = 1;
+    if (bShare == 2) {
+        bShare = 0;
+        for (pHead = NodeH; *pHead; pHead++) {
+            pxNode = *pHead;
+            if (pxNode->opr == ASS && pxNode->c.optr->typ == TMP &&
+                TmpStage[pxNode->c.optr->ind]) {
+                [self mapStatement:(int)(pHead - NodeH)];
+                if (![self genCodeForNode:pxNode]) {
+                    return 0;
+                }
+                stage = 1;
+            }
+        }
+        bShare = share;
+        if (![self genSharedSubexpressionsInStage:1]) {
+            return 0;
+        }
+        if (stage || nTmp > n) {
+            [modelCode addOperator:SOP];
+        }
+    }
+    for (pHead = NodeH; *pHead; pHead++) {
+        pxNode = *pHead;
+        if (pxNode->opr == ASS && pxNode->c.optr->typ == TMP &&
+            TmpStage[pxNode->c.optr->ind]) {
+            continue;
+        }
+        [self mapStatement:(int)(pHead - NodeH)];
+        if (![self genCodeForNode:pxNode]) {
+            return 0;
+        }
+    }
+    bFunction = 0;
+    bDeriv = 1;
+
+    return 1;
+}
+
+/**
+ @brief Source map entry for the code of a statement
+
+ @discussion    The code that follows, up to the next entry, is attributed
+ to the line of the model file on which the statement ends. Code that
+ belongs to no single statement, such as shared subexpressions and the
+ start of a section, is attributed to line 0.
+
+ @param s index of the statement in NodeH
+ */
+- (void)mapStatement:(int)s {
+    [modelCode addSourceLine:StmLine[s]];
+}
+
 /* ========================================================================== */
 
 /**
@@ -1602,67 +2704,385 @@ function: /* function call */
  @param rec symbol to check
  @return 0 - success
  */
-int numTraverse(char *rec) {
+int numTraverse(char *rec, void *ctx) {
+    PXModelCompiler *compiler = (__bridge PXModelCompiler *)ctx;
     PRX_NUM *pNum;
 
     pNum = (PRX_NUM *)rec;
-    Numbers[pNum->ind] = pNum->val;
+    compiler->Numbers[pNum->ind] = pNum->val;
     return 0;
 }
 
 /**
- @brief Output of all constants
+ @brief Output of the constants used by the code
+
+ @discussion    The constants are renumbered in the order of their first
+ load. The ones that the code does not load, because their statements were
+ removed or simplified away, are left out.
 
  @return 0 - error, 1 - success
  */
 - (int)numOut {
+    CODE *code = [modelCode getModelCode];
+    int nCode = [modelCode getLengthCode];
+    int *slot; /* new index of a constant, -1 when not loaded */
+    int j, n = 0;
 
-    Numbers = (double *)mem_slot(Tree, nNum * sizeof(double));
-    bt_traverse(BtNumbers, numTraverse);
+    Numbers = (double *)mem_slot(Tree, (nNum + 1) * sizeof(double));
+    bt_traverse(BtNumbers, numTraverse, (__bridge void *)self);
 
+    slot = (int *)mem_slot(Tree, (nNum + 1) * sizeof(int));
     for (int i = 0; i < nNum; i++) {
-        [modelCode addNumber:Numbers[i]];
+        slot[i] = -1;
+    }
+    for (int i = 0; i < nCode; i += pev_length(code[i].o)) {
+        if (code[i].o != NUM) {
+            continue;
+        }
+        j = code[i + 1].i;
+        if (slot[j] < 0) {
+            slot[j] = n++;
+            [modelCode addNumber:Numbers[j]];
+        }
+        code[i + 1].i = slot[j];
+    }
+    nNum = n;
+
+    return 1;
+}
+
+/**
+ @brief Renumber the temporaries of the code densely
+
+ @discussion    A temporary that the code neither loads nor assigns, because
+ its statements were removed or its derivative is never read, gets no
+ slot. The values and the derivatives of the temporaries share the
+ numbering, which keeps the order of the temporaries.
+
+ @return 0 - error, 1 - success
+ */
+- (int)compactTemporaries {
+    CODE *code = [modelCode getModelCode];
+    int nCode = [modelCode getLengthCode];
+    int *slot; /* new index of a temporary, -1 when not in the code */
+    int nPair; /* operands of an operator, pairs of type and index */
+    TYP typ;
+    int n = 0;
+
+    slot = (int *)mem_slot(Tree, (nTmp + 1) * sizeof(int));
+    for (int t = 0; t < nTmp; t++) {
+        slot[t] = -1;
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < nCode; i += pev_length(code[i].o)) {
+            nPair = (pev_length(code[i].o) - 1) / 2;
+            for (int k = i + 1; k < i + 1 + 2 * nPair; k += 2) {
+                typ = code[k].t;
+                if (typ != TMP && typ != DTMP) {
+                    continue;
+                }
+                if (pass == 0) {
+                    slot[code[k + 1].i] = 0;
+                } else {
+                    code[k + 1].i = slot[code[k + 1].i];
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int t = 0; t < nTmp; t++) {
+                if (slot[t] == 0) {
+                    slot[t] = n++;
+                }
+            }
+        }
     }
+    nSlotFreed += nTmp - n;
+    nTmp = n;
 
     return 1;
 }
 
 /* ========================================================================== */
 
+/** reverse mode is chosen when it takes fewer sweeps, counting a
+ * backward sweep as REVERSE_COST forward passes */
+#define REVERSE_COST 3
+
 /**
  @brief Derivative generation frame
 
+ @discussion    Each kind of derivatives is generated in forward mode, one
+ pass per column, in reverse mode, one backward sweep per residual, or in
+ vector mode, a single pass that carries the gradients to all columns.
+ Unless the mode is requested, reverse mode is chosen for the kinds with
+ many more columns than residuals, and forward mode for the other kinds.
+ Vector mode is only used when requested: its gradients multiply every
+ partial derivative with all columns, so that a partial derivative that is
+ not finite turns structural zeros of its row into NaN, where forward mode
+ leaves them 0. A mode that the model does not allow falls back to forward
+ mode. <br>
+ The function code and the derivatives are generated twice. The first time
+ the code is discarded, and the subexpressions of primal values are
+ counted. The ones that occur more than once get a temporary, assigned at
+ the end of the function code, that the code of the second time uses. The
+ subexpressions of parameters, constants and flags get a temporary in the
+ parameter stage, at the start of the function code.
+
  @return 0 - error, 1 - success
  */
 - (int)generateDerivatives {
+    int nDefs[3] = {nVar, nAux, nPar};
+    PXDerivativeMode modes[3];
+    PXModelCode *code;
+    int reverse, vector; /* modes allowed */
+    int ok;
 
     bDeriv = 1;
-    [modelCode addOperator:SOK];
-    for (int i = 0; i <= nVar - 1; i++) {
-        if (![self derivativeToVariable:varDefs[i]]) {
-            return 0;
+    [self nestStatements];
+    reverse = [self isReverseEligible];
+    vector = [self isVectorEligible];
+    for (int k = 0; k < 3; k++) {
+        modes[k] = kindMode[k];
+        if (modes[k] == PXDerivativeAutomatic) {
+            if (reverse && REVERSE_COST * nRes < nDefs[k]) {
+                modes[k] = PXDerivativeReverse;
+            } else {
+                modes[k] = PXDerivativeForward;
+            }
         }
-        [modelCode addOperator:EOD];
-    }
-    [modelCode addOperator:SOK];
-    for (int i = 0; i <= nAux - 1; i++) {
-        if (![self derivativeToVariable:auxDefs[i]]) {
-            return 0;
+        if ((modes[k] == PXDerivativeReverse && !reverse) ||
+            (modes[k] == PXDerivativeVector && !vector)) {
+            modes[k] = PXDerivativeForward;
         }
-        [modelCode addOperator:EOD];
     }
-    [modelCode addOperator:SOK];
-    for (int i = 0; i <= nPar - 1; i++) {
-        if (![self derivativeToVariable:parDefs[i]]) {
-            return 0;
+
+    if (![self markParameterStage]) {
+        return 0;
+    }
+
+    BtShared = bt_define_tree(DTree, bt_cmp_shared);
+    pShareFirst = pShareLast = NULL;
+    code = modelCode;
+    modelCode = [[PXModelCode alloc] init];
+    bShare = 1;
+    ok = [self genFunctionCode] && [self derivativeSectionsInModes:modes];
+    modelCode = code;
+    if (!ok) {
+        return 0;
+    }
+    bShare = 2;
+    if (![self genFunctionCode] || ![self genSharedSubexpressionsInStage:0]) {
+        return 0;
+    }
+    ok = [self derivativeSectionsInModes:modes];
+    bShare = 0;
+
+    return ok;
+}
+
+/**
+ @brief Derivative sections of all kinds
+
+ @param modes generation of the derivatives per kind
+ @return 0 - error, 1 - success
+ */
+- (int)derivativeSectionsInModes:(const PXDerivativeMode *)modes {
+    PRX_OPD **defs[3] = {varDefs, auxDefs, parDefs};
+    int nDefs[3] = {nVar, nAux, nPar};
+
+    for (int k = 0; k < 3; k++) {
+        [modelCode setMode:modes[k] forKind:k];
+        [modelCode addSourceLine:0];
+        [modelCode addOperator:SOK];
+        if (modes[k] == PXDerivativeReverse) {
+            if (![self reverseDerivativesForKind:k]) {
+                return 0;
+            }
+            continue;
+        }
+        if (modes[k] == PXDerivativeVector) {
+            if (![self vectorDerivativesForKind:k]) {
+                return 0;
+            }
+            continue;
+        }
+        for (int i = 0; i <= nDefs[k] - 1; i++) {
+            if (![self derivativeToVariable:defs[k][i]]) {
+                return 0;
+            }
+            [modelCode addSourceLine:0];
+            [modelCode addOperator:EOD];
         }
-        [modelCode addOperator:EOD];
     }
+    [modelCode addSourceLine:0];
     [modelCode addOperator:STOP];
 
     return 1;
 }
 
+/**
+ @brief Function code of a lazy compiler
+
+ @discussion    The function code is generated without the parameter stage
+ and shared subexpressions, which depend on all derivatives. The code of
+ the compiler has empty derivative sections.
+
+ @return 0 - error, 1 - success
+ */
+- (int)genLazyFunctionCode {
+
+    [self nestStatements];
+    bShare = 0;
+    if (![self genFunctionCode]) {
+        return 0;
+    }
+    modelCode.numberOfTemp = nTmp;
+
+    for (int k = 0; k < 3; k++) {
+        int nDefs = (k == 0) ? nVar : (k == 1) ? nAux : nPar;
+        lazySections[k] = [NSMutableArray arrayWithCapacity:nDefs];
+        lazyRows[k] = [NSMutableArray arrayWithCapacity:nDefs];
+        lazyLines[k] = [NSMutableArray arrayWithCapacity:nDefs];
+        for (int i = 0; i < nDefs; i++) {
+            [lazySections[k] addObject:[NSNull null]];
+            [lazyRows[k] addObject:[NSNull null]];
+            [lazyLines[k] addObject:[NSNull null]];
+        }
+    }
+    lazyCodes = [[NSMutableDictionary alloc] init];
+
+    functionCode = modelCode;
+    modelCode = [self assembleCodeForColumns:NULL];
+
+    return 1;
+}
+
+/**
+ @brief Derivative to a single column, for a lazy compiler
+
+ @discussion    The derivative is generated into a code of its own, and
+ kept with its column of the Jacobian pattern and its source map.
+
+ @param kind kind of derivatives
+ @param j column
+ @return 0 - error, 1 - success
+ */
+- (int)lazySectionForKind:(PXDerivativeKind)kind column:(int)j {
+    PRX_OPD **defs[3] = {varDefs, auxDefs, parDefs};
+    PXModelCode *code = modelCode;
+    PXModelCode *section;
+    NSMutableData *map;
+    int *pair;
+    int ok;
+
+    if (lazySections[kind][j] != [NSNull null]) {
+        return 1;
+    }
+
+    section = [[PXModelCode alloc] init];
+    modelCode = section;
+    ok = [self derivativeToVariable:defs[kind][j]] && ![self getError];
+    modelCode = code;
+    if (!ok) {
+        return 0;
+    }
+
+    lazySections[kind][j] =
+        [NSData dataWithBytes:[section getModelCode]
+                       length:[section getLengthCode] * sizeof(CODE)];
+    lazyRows[kind][j] =
+        [NSData dataWithBytes:[section getRowIndicesForKind:kind]
+                       length:[section getNonzerosForKind:kind] * sizeof(int)];
+
+    map = [NSMutableData
+        dataWithLength:2 * [section getLengthSource] * sizeof(int)];
+    pair = (int *)[map mutableBytes];
+    for (int m = 0; m < [section getLengthSource]; m++) {
+        pair[2 * m] = [section getSourceOffsets][m];
+        pair[2 * m + 1] = [section getSourceLines][m];
+    }
+    lazyLines[kind][j] = map;
+
+    return 1;
+}
+
+/**
+ @brief Model code of a lazy compiler, from the function code and the
+ generated derivatives
+
+ @param want column is requested, variables then parameters, NULL for none
+ @return model code
+ */
+- (PXModelCode *)assembleCodeForColumns:(const char *)want {
+    PXModelCode *code = [[PXModelCode alloc] init];
+    CODE *cells = [functionCode getModelCode];
+    int nCells = [functionCode getLengthCode];
+    const int *offsets = [functionCode getSourceOffsets];
+    const int *lines = [functionCode getSourceLines];
+    int nMap = [functionCode getLengthSource];
+    int nDefs[3] = {nVar, nAux, nPar};
+    int anyVar = 0;
+    int none = 0;
+    int m = 0;
+
+    [code copyInterfaceFrom:functionCode];
+    for (int i = 0; i < nCells; i++) {
+        if (m < nMap && offsets[m] == i) {
+            [code addSourceLine:lines[m++]];
+        }
+        [code addCell:cells[i]];
+    }
+    for (int j = 0; want && j < nVar; j++) {
+        anyVar |= want[j];
+    }
+
+    for (int k = 0; k < 3; k++) {
+        [code setMode:PXDerivativeForward forKind:k];
+        [code addSourceLine:0];
+        [code addOperator:SOK];
+        for (int j = 0; j < nDefs[k]; j++) {
+            NSData *section = lazySections[k][j];
+            NSData *rows = lazyRows[k][j];
+            int use = (k == 0)   ? (want && want[j])
+                      : (k == 1) ? anyVar
+                                 : (want && want[nVar + j]);
+            if (use && section != (id)[NSNull null]) {
+                const CODE *c = (const CODE *)[section bytes];
+                const int *pair = (const int *)[lazyLines[k][j] bytes];
+                int nPair = (int)([lazyLines[k][j] length] / (2 * sizeof(int)));
+                m = 0;
+                for (NSUInteger i = 0; i < [section length] / sizeof(CODE);
+                     i++) {
+                    if (m < nPair && pair[2 * m] == (int)i) {
+                        [code addSourceLine:pair[2 * m + 1]];
+                        m++;
+                    }
+                    [code addCell:c[i]];
+                }
+                int count = (int)([rows length] / sizeof(int));
+                [code addPatternColumnForKind:k
+                                         rows:count ? (const int *)[rows bytes]
+                                                    : &none
+                                        count:count];
+            } else {
+                [code addPatternColumnForKind:k rows:&none count:0];
+            }
+            [code addSourceLine:0];
+            [code addOperator:EOD];
+        }
+    }
+    [code addOperator:STOP];
+
+    /* the derivatives may have added numerical constants */
+    Numbers = (double *)mem_slot(Tree, (nNum + 1) * sizeof(double));
+    bt_traverse(BtNumbers, numTraverse, (__bridge void *)self);
+    for (int i = 0; i < nNum; i++) {
+        [code addNumber:Numbers[i]];
+    }
+
+    return code;
+}
+
 /* ========================================================================== */
 
 /**
@@ -1676,10 +3096,15 @@ int numTraverse(char *rec) {
     PRX_NODE *pElse;
     PRX_NODE *IfNode[MAXLEVEL + 1] = {NULL};   /* pos. of last if-node */
     PRX_NODE *ElseNode[MAXLEVEL + 1] = {NULL}; /* pos. of last else-node */
+    int NeedD[MAXEQU]; /* derivative of the temporary is read */
+    int changed;
 
     for (int i = 0; i < nTmp; i++) {
         TmpTyp[i] = 0;
     }
+    for (int i = 0; i < nRes; i++) {
+        ResTyp[i] = 0;
+    }
 
     /*
      * 1st pass - simplify expressions and determine the temporaries
@@ -1699,12 +3124,49 @@ int numTraverse(char *rec) {
                                       withVal:NULL]) {
             return 0;
         }
-        [self simplifyExpressionAtNode:pxNode->abl];
-        [self simplifyExpressionAtNode:pxNode->abl];
+        if (![self simplifyDerivativeAtNode:pxNode->abl]) {
+            return 0;
+        }
         if (pxNode->c.optr->typ == TMP) {
-            if (pxNode->abl->o1 != N_0) {
+            if (TmpTape[pxNode->c.optr->ind] == pxNode) {
+                TmpTyp[pxNode->c.optr->ind] = 2;
+            } else if (pxNode->abl->o1 != N_0) {
                 TmpTyp[pxNode->c.optr->ind] = 1;
             }
+        } else if (pxNode->c.optr->typ == RES) {
+            if (pxNode->abl->o1 != N_0) {
+                ResTyp[pxNode->c.optr->ind] = 1;
+            }
+        }
+    }
+
+    /*
+     * the derivatives of temporaries that no later derivative reads
+     * are not computed
+     */
+    for (int i = 0; i < nTmp; i++) {
+        NeedD[i] = 0;
+    }
+    do {
+        changed = 0;
+        for (pHead = NodeH; *pHead; pHead++) {
+            pxNode = *pHead;
+            if (pxNode->opr != ASS) {
+                continue;
+            }
+            if (pxNode->c.optr->typ == TMP &&
+                (TmpTyp[pxNode->c.optr->ind] != 1 ||
+                 !NeedD[pxNode->c.optr->ind])) {
+                continue;
+            }
+            changed += [self temporariesOfNode:pxNode->abl->o1
+                                  withOperator:DOPD
+                                          into:NeedD];
+        }
+    } while (changed);
+    for (int i = 0; i < nTmp; i++) {
+        if (TmpTyp[i] == 1 && !NeedD[i]) {
+            TmpTyp[i] = 0;
         }
     }
 
@@ -1742,7 +3204,7 @@ int numTraverse(char *rec) {
             }
             typ = pxNode->c.optr->typ;
             if (typ == TMP) {
-                if (!TmpTyp[pxNode->c.optr->ind]) {
+                if (TmpTyp[pxNode->c.optr->ind] != 1) {
                     break;
                 }
             }
@@ -1760,8 +3222,13 @@ int numTraverse(char *rec) {
     /* 3rd pass - output to file */
     for (pHead = NodeH; *pHead; pHead++) {
         pxNode = *pHead;
+        [self mapStatement:(int)(pHead - NodeH)];
         switch (pxNode->opr) {
         case ASS:
+            if (pxNode->c.optr->typ == TMP &&
+                TmpTyp[pxNode->c.optr->ind] != 1) {
+                break; /* tape, used in place, or not read */
+            }
             if (![self genCodeForNode:pxNode->abl]) {
                 return 0;
             }
@@ -1780,16 +3247,27 @@ int numTraverse(char *rec) {
         }
     }
 
+    /* Jacobian pattern: residuals of which the derivative is not zero */
+    int rows[MAXEQU];
+    int count = 0;
+    for (int i = 0; i < nRes; i++) {
+        if (ResTyp[i]) {
+            rows[count++] = i;
+        }
+    }
+    [modelCode addPatternColumnForKind:(pOpd->typ == VAR)   ? PXDerivativeVar
+                                       : (pOpd->typ == AUX) ? PXDerivativeAux
+                                                            : PXDerivativePar
+                                  rows:rows
+                                 count:count];
+
     return 1;
 }
 
 /* ========================================================================== */
 
 #define NODED(p, op, op1, op2)                                                 \
-    p = (PRX_NODE *)mem_slot(DTree, sizeof(PRX_NODE));                         \
-    p->opr = op;                                                               \
-    p->o1 = op1;                                                               \
-    p->c.o2 = op2
+    p = [self getNode:op withLeft:op1 withRight:op2 inTree:DTree]
 
 /**
  @brief Derivative for a subexpression
@@ -2054,8 +3532,18 @@ int numTraverse(char *rec) {
         p->abl = p1->abl;
         break;
     case OPD:
-        if (p->c.optr->typ == TMP) {
-            if (TmpTyp[p->c.optr->ind]) {
+        if (p->c.optr == arg) {
+            p->abl = N_1;
+        } else if (p->c.optr->typ == TMP) {
+            if (TmpTyp[p->c.optr->ind] == 2) { /* tape, used in place */
+                pD = TmpTape[p->c.optr->ind];
+                if (![self derivativeForSubExpression:pD
+                                           toVariable:arg
+                                              withVal:NULL]) {
+                    return 0;
+                }
+                p->abl = pD->abl->o1;
+            } else if (TmpTyp[p->c.optr->ind]) {
                 NODED(pD, DOPD, NULL, (PRX_NODE *)p->c.optr);
                 p->abl = pD;
             } else
@@ -2064,7 +3552,7 @@ int numTraverse(char *rec) {
             NODED(pD, DOPD, NULL, (PRX_NODE *)p->c.optr);
             p->abl = pD;
         } else
-            p->abl = (p->c.optr == arg) ? N_1 : N_0;
+            p->abl = N_0;
         break;
     case NUM:
         p->abl = N_0;
@@ -2201,6 +3689,908 @@ int numTraverse(char *rec) {
 
 /* ========================================================================== */
 
+/**
+ @brief Position of the statements in the conditional blocks
+
+ @discussion    Sets StmIf, StmBranch and StmMatch for the statements in
+ NodeH.
+ */
+- (void)nestStatements {
+    int level = 0;
+    int IfStm[MAXLEVEL + 1];  /* enclosing if-statements */
+    int Branch[MAXLEVEL + 1]; /* their current branch */
+
+    for (int s = 0; NodeH[s]; s++) {
+        switch (NodeH[s]->opr) {
+        case ELSE:
+            StmMatch[s] = IfStm[level];
+            StmMatch[IfStm[level]] = s;
+            Branch[level] = 1;
+            break;
+        case FI:
+            StmMatch[s] = IfStm[level--];
+            break;
+        default:
+            break;
+        }
+        StmIf[s] = (level > 0) ? IfStm[level] : -1;
+        StmBranch[s] = (level > 0) ? Branch[level] : 0;
+        if (NodeH[s]->opr == IF) {
+            StmMatch[s] = -1;
+            IfStm[++level] = s;
+            Branch[level] = 0;
+        }
+    }
+}
+
+/**
+ @brief Statements that are never executed in the same evaluation
+
+ @param a index of statement
+ @param b index of statement
+ @return 1 - in different branches of the same if, 0 - otherwise
+ */
+- (int)isStatement:(int)a exclusiveWith:(int)b {
+    for (int x = a; StmIf[x] >= 0; x = StmIf[x]) {
+        for (int y = b; StmIf[y] >= 0; y = StmIf[y]) {
+            if (StmIf[x] == StmIf[y] && StmBranch[x] != StmBranch[y]) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ @brief Distinct operands of an expression
+
+ @discussion    A tape is replaced by the operands of its expression.
+
+ @param p expression
+ @param opd list of operands, extended
+ @param n number of operands in the list
+ @return new number of operands, -1 if the list is full
+ */
+- (int)operandsOfNode:(PRX_NODE *)p into:(PRX_OPD **)opd count:(int)n {
+
+    if (!p || n < 0) {
+        return n;
+    }
+    switch (p->opr) {
+    case OPD:
+        if (p->c.optr->typ == TMP && TmpTape[p->c.optr->ind]) {
+            return [self operandsOfNode:TmpTape[p->c.optr->ind]->o1
+                                   into:opd
+                                  count:n];
+        }
+        for (int i = 0; i < n; i++) {
+            if (opd[i] == p->c.optr) {
+                return n;
+            }
+        }
+        if (n >= MAXCMD) {
+            return -1;
+        }
+        opd[n++] = p->c.optr;
+        return n;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        n = [self operandsOfNode:p->o1 into:opd count:n];
+        return [self operandsOfNode:p->c.o2 into:opd count:n];
+    default:
+        return [self operandsOfNode:p->o1 into:opd count:n];
+    }
+}
+
+/**
+ @brief Check whether the derivatives can be generated in reverse mode
+
+ @discussion    The backward sweep uses the final values of the
+ temporaries, so a temporary must have a single value in an evaluation:
+ the assignments to a temporary or a residual must be in different
+ branches of a conditional, and every assignment to a temporary that can
+ be executed together with a use of it must precede that use.
+ Residuals may not be used as operands.
+
+ @return 1 - eligible, 0 - forward mode only
+ */
+- (int)isReverseEligible {
+    PRX_OPD *opd[MAXCMD];
+    PRX_NODE *pA;
+    int n;
+
+    for (int s = 0; NodeH[s]; s++) {
+        pxNode = NodeH[s];
+        if (pxNode->opr == ASS) {
+            for (int a = 0; a < s; a++) {
+                pA = NodeH[a];
+                if (pA->opr == ASS && pA->c.optr == pxNode->c.optr &&
+                    ![self isStatement:a exclusiveWith:s]) {
+                    return 0;
+                }
+            }
+        } else if (pxNode->opr != IF) {
+            continue;
+        }
+        n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+        if (n < 0) {
+            return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            if (opd[i]->typ == RES) {
+                return 0;
+            }
+            if (opd[i]->typ != TMP) {
+                continue;
+            }
+            for (int a = s; NodeH[a]; a++) {
+                pA = NodeH[a];
+                if (pA->opr == ASS && pA->c.optr == opd[i] &&
+                    ![self isStatement:a exclusiveWith:s]) {
+                    return 0;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ @brief Reverse mode derivatives of the residuals to one kind of operands
+
+ @discussion    For each residual the adjoints of the temporaries (DTMP)
+ and of the operands of the kind (DJAC) are cleared, and the statements
+ on which the residual depends are visited from last to first. A
+ statement adds, for each operand, its partial derivative times the
+ adjoint of its target to the adjoint of the operand. The conditionals
+ are reversed with the statements; their conditions are evaluated from
+ the primal values. Each residual ends with EOD and leaves its row of
+ the Jacobian in DJAC.
+
+ @param kind kind of derivatives
+ @return 0 - error, 1 - success
+ */
+- (int)reverseDerivativesForKind:(PXDerivativeKind)kind {
+    TYP typ;
+    int nCol;
+    PRX_OPD *opd[MAXCMD];
+    PRX_OPD *pTarget, *u;
+    PRX_NODE *pAdj, *pPart, *pN, *pD;
+    int Depend[MAXEQU]; /* temporary depends on the operands of the kind */
+    int Need[MAXEQU];   /* adjoint of temporary is needed */
+    int Rel[MAXEQU];    /* statement is needed for the residual */
+    int rows[MAXEQU];
+    int nStm, n, m, count;
+    char *nz; /* Jacobian pattern, row by row */
+
+    switch (kind) {
+    case PXDerivativeVar:
+        typ = VAR;
+        nCol = nVar;
+        break;
+    case PXDerivativeAux:
+        typ = AUX;
+        nCol = nAux;
+        break;
+    default:
+        typ = PAR;
+        nCol = nPar;
+        break;
+    }
+
+    for (nStm = 0; NodeH[nStm]; nStm++) {
+        ;
+    }
+    for (int t = 0; t < nTmp; t++) {
+        TmpTyp[t] = TmpTape[t] ? 2 : 0; /* partial derivatives only */
+        Depend[t] = 0;
+    }
+
+    /* temporaries that depend on the operands of the kind */
+    for (int s = 0; s < nStm; s++) {
+        pxNode = NodeH[s];
+        if (pxNode->opr != ASS || pxNode->c.optr->typ != TMP) {
+            continue;
+        }
+        n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+        for (int i = 0; i < n; i++) {
+            if (opd[i]->typ == typ ||
+                (opd[i]->typ == TMP && Depend[opd[i]->ind])) {
+                Depend[pxNode->c.optr->ind] = 1;
+                break;
+            }
+        }
+    }
+
+    nz = (char *)mem_slot(DTree, nRes * nCol + 1);
+    memset(nz, 0, nRes * nCol + 1);
+
+    for (int r = 0; r < nRes; r++) {
+
+        /* statements on which the residual depends */
+        for (int t = 0; t < nTmp; t++) {
+            Need[t] = 0;
+        }
+        for (int s = nStm - 1; s >= 0; s--) {
+            pxNode = NodeH[s];
+            Rel[s] = 0;
+            if (pxNode->opr != ASS) {
+                continue;
+            }
+            pTarget = pxNode->c.optr;
+            if (pTarget->typ == RES ? pTarget->ind != r
+                                    : !Need[pTarget->ind]) {
+                continue;
+            }
+            n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+            for (int i = 0; i < n; i++) {
+                if (opd[i]->typ == typ) {
+                    Rel[s] = 1;
+                } else if (opd[i]->typ == TMP && Depend[opd[i]->ind]) {
+                    Rel[s] = 1;
+                    Need[opd[i]->ind] = 1;
+                }
+            }
+        }
+
+        /* conditionals that enclose these statements */
+        for (int s = 0; s < nStm; s++) {
+            if (Rel[s] && NodeH[s]->opr == ASS) {
+                for (m = StmIf[s]; m >= 0 && !Rel[m]; m = StmIf[m]) {
+                    Rel[m] = 1;
+                }
+            }
+        }
+
+        [modelCode addSourceLine:0];
+        for (int j = 0; j < nCol; j++) {
+            [modelCode addOperator:CLR];
+            [modelCode addType:DJAC];
+            [modelCode addIndex:j];
+        }
+        for (int t = 0; t < nTmp; t++) {
+            if (Need[t]) {
+                [modelCode addOperator:CLR];
+                [modelCode addType:DTMP];
+                [modelCode addIndex:t];
+            }
+        }
+
+        /* backward sweep */
+        for (int s = nStm - 1; s >= 0; s--) {
+            pxNode = NodeH[s];
+            [self mapStatement:s];
+            switch (pxNode->opr) {
+            case FI:
+                m = StmMatch[s];
+                if (!Rel[m]) {
+                    break;
+                }
+                pN = NodeH[m]->o1; /* else-branch comes first */
+                if (StmMatch[m] >= 0) {
+                    NODED(pD, NOT, pN, NULL);
+                    pN = pD;
+                }
+                NODED(pD, IF, pN, NULL);
+                if (![self genCodeForNode:pD]) {
+                    return 0;
+                }
+                break;
+            case ELSE:
+                if (Rel[StmMatch[s]]) {
+                    [modelCode addOperator:ELSE];
+                }
+                break;
+            case IF:
+                if (Rel[s]) {
+                    [modelCode addOperator:FI];
+                }
+                break;
+            case ASS:
+                if (!Rel[s]) {
+                    break;
+                }
+                pTarget = pxNode->c.optr;
+                if (pTarget->typ == RES) {
+                    pAdj = N_1;
+                } else {
+                    NODED(pAdj, DOPD, NULL, (PRX_NODE *)pTarget);
+                }
+                n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+                for (int i = 0; i < n; i++) {
+                    u = opd[i];
+                    if (u->typ != typ && (u->typ != TMP || !Need[u->ind])) {
+                        continue;
+                    }
+                    if (![self derivativeForSubExpression:pxNode
+                                               toVariable:u
+                                                  withVal:NULL]) {
+                        return 0;
+                    }
+                    if (![self simplifyDerivativeAtNode:pxNode->abl]) {
+                        return 0;
+                    }
+                    pPart = pxNode->abl->o1;
+                    if (pPart == N_0) {
+                        continue;
+                    }
+                    if (pAdj == N_1) {
+                        pN = pPart;
+                    } else if (pPart == N_1) {
+                        pN = pAdj;
+                    } else {
+                        NODED(pN, MUL, pPart, pAdj);
+                    }
+                    NODED(pD, DOPD, NULL, (PRX_NODE *)u);
+                    NODED(pPart, ADD, pD, pN);
+                    NODED(pD, ASS, pPart, NULL);
+                    pD->c.optr = u;
+                    if (![self genCodeForNode:pD]) {
+                        return 0;
+                    }
+                    if (u->typ == typ) {
+                        nz[r * nCol + u->ind] = 1;
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        [modelCode addSourceLine:0];
+        [modelCode addOperator:EOD];
+    }
+
+    /* Jacobian pattern */
+    for (int j = 0; j < nCol; j++) {
+        count = 0;
+        for (int r = 0; r < nRes; r++) {
+            if (nz[r * nCol + j]) {
+                rows[count++] = r;
+            }
+        }
+        [modelCode addPatternColumnForKind:kind rows:rows count:count];
+    }
+
+    return 1;
+}
+
+/**
+ @brief Check whether the derivatives can be generated in vector mode
+
+ @discussion    The gradient of the target of an assignment is cleared
+ before the contributions of the operands are added, so an assignment may
+ not use its own target. Residuals may not be used as operands.
+
+ @return 1 - eligible, 0 - forward mode only
+ */
+- (int)isVectorEligible {
+    PRX_OPD *opd[MAXCMD];
+    int n;
+
+    for (int s = 0; NodeH[s]; s++) {
+        pxNode = NodeH[s];
+        if (pxNode->opr != ASS && pxNode->opr != IF) {
+            continue;
+        }
+        n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+        if (n < 0) {
+            return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            if (opd[i]->typ == RES ||
+                (pxNode->opr == ASS && opd[i] == pxNode->c.optr)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ @brief Vector mode derivatives of the residuals to one kind of operands
+
+ @discussion    The temporaries and residuals carry a gradient, a vector
+ with the derivatives to all columns of the kind, and the statements are
+ visited once. An assignment clears the gradient of its target (GCLR) and
+ adds, for each operand, its partial derivative times the gradient of the
+ operand (GADD); the gradient of an operand of the kind is a unit vector.
+ The section ends with a single EOD, at which the gradients of the
+ residuals are the rows of the Jacobian.
+
+ @param kind kind of derivatives
+ @return 0 - error, 1 - success
+ */
+- (int)vectorDerivativesForKind:(PXDerivativeKind)kind {
+    TYP typ;
+    int nCol;
+    PRX_OPD *opd[MAXCMD];
+    PRX_OPD *pTarget, *u;
+    PRX_NODE *pPart;
+    int Depend[MAXEQU]; /* temporary depends on the operands of the kind */
+    int Need[MAXEQU];   /* gradient of the temporary is read */
+    int Rel[MAXEQU];    /* statement is generated */
+    int rows[MAXEQU];
+    int nStm, n, m, count;
+    char *nz; /* gradient patterns, temporaries followed by residuals */
+    char *pDst, *pSrc;
+
+    switch (kind) {
+    case PXDerivativeVar:
+        typ = VAR;
+        nCol = nVar;
+        break;
+    case PXDerivativeAux:
+        typ = AUX;
+        nCol = nAux;
+        break;
+    default:
+        typ = PAR;
+        nCol = nPar;
+        break;
+    }
+
+    for (nStm = 0; NodeH[nStm]; nStm++) {
+        ;
+    }
+    for (int t = 0; t < nTmp; t++) {
+        TmpTyp[t] = TmpTape[t] ? 2 : 0; /* partial derivatives only */
+        Depend[t] = 0;
+    }
+
+    /* temporaries that depend on the operands of the kind */
+    for (int s = 0; s < nStm; s++) {
+        pxNode = NodeH[s];
+        if (pxNode->opr != ASS || pxNode->c.optr->typ != TMP) {
+            continue;
+        }
+        n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+        for (int i = 0; i < n; i++) {
+            if (opd[i]->typ == typ ||
+                (opd[i]->typ == TMP && Depend[opd[i]->ind])) {
+                Depend[pxNode->c.optr->ind] = 1;
+                break;
+            }
+        }
+    }
+
+    /*
+     * assignments with a gradient that a residual needs, and the
+     * conditionals around them
+     */
+    for (int t = 0; t < nTmp; t++) {
+        Need[t] = 0;
+    }
+    for (int s = nStm - 1; s >= 0; s--) {
+        pxNode = NodeH[s];
+        Rel[s] = pxNode->opr == ASS &&
+                 (pxNode->c.optr->typ == RES ||
+                  (Depend[pxNode->c.optr->ind] &&
+                   !TmpTape[pxNode->c.optr->ind] &&
+                   Need[pxNode->c.optr->ind]));
+        if (!Rel[s]) {
+            continue;
+        }
+        n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+        for (int i = 0; i < n; i++) {
+            if (opd[i]->typ == TMP) {
+                Need[opd[i]->ind] = 1;
+            }
+        }
+    }
+    for (int s = 0; s < nStm; s++) {
+        if (Rel[s] && NodeH[s]->opr == ASS) {
+            for (m = StmIf[s]; m >= 0 && !Rel[m]; m = StmIf[m]) {
+                Rel[m] = 1;
+            }
+        }
+    }
+
+    nz = (char *)mem_slot(DTree, (nTmp + nRes) * nCol + 1);
+    memset(nz, 0, (nTmp + nRes) * nCol + 1);
+
+    [modelCode addSourceLine:0];
+    for (int r = 0; r < nRes; r++) {
+        [modelCode addOperator:GCLR];
+        [modelCode addType:DRES];
+        [modelCode addIndex:r];
+    }
+
+    for (int s = 0; s < nStm; s++) {
+        pxNode = NodeH[s];
+        [self mapStatement:s];
+        switch (pxNode->opr) {
+        case IF:
+            if (Rel[s]) {
+                if (![self genCodeForNode:pxNode]) {
+                    return 0;
+                }
+            }
+            break;
+        case ELSE:
+        case FI:
+            if (Rel[StmMatch[s]]) {
+                [modelCode addOperator:pxNode->opr];
+            }
+            break;
+        case ASS:
+            if (!Rel[s]) {
+                break;
+            }
+            pTarget = pxNode->c.optr;
+            pDst = nz + ((pTarget->typ == RES) ? nTmp + pTarget->ind
+                                               : pTarget->ind) * nCol;
+            [modelCode addOperator:GCLR];
+            [modelCode addType:(pTarget->typ == RES) ? DRES : DTMP];
+            [modelCode addIndex:pTarget->ind];
+            n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+            for (int i = 0; i < n; i++) {
+                u = opd[i];
+                if (u->typ != typ && (u->typ != TMP || !Depend[u->ind])) {
+                    continue;
+                }
+                if (![self derivativeForSubExpression:pxNode
+                                           toVariable:u
+                                              withVal:NULL]) {
+                    return 0;
+                }
+                if (![self simplifyDerivativeAtNode:pxNode->abl]) {
+                    return 0;
+                }
+                pPart = pxNode->abl->o1;
+                if (pPart == N_0) {
+                    continue;
+                }
+                if (![self genCodeForNode:pPart]) {
+                    return 0;
+                }
+                [modelCode addOperator:GADD];
+                [modelCode addType:(pTarget->typ == RES) ? DRES : DTMP];
+                [modelCode addIndex:pTarget->ind];
+                [modelCode addType:(u->typ == TMP) ? DTMP : u->typ];
+                [modelCode addIndex:u->ind];
+                if (u->typ == TMP) {
+                    pSrc = nz + u->ind * nCol;
+                    for (int j = 0; j < nCol; j++) {
+                        pDst[j] |= pSrc[j];
+                    }
+                } else {
+                    pDst[u->ind] = 1;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    [modelCode addSourceLine:0];
+    [modelCode addOperator:EOD];
+
+    /* Jacobian pattern */
+    for (int j = 0; j < nCol; j++) {
+        count = 0;
+        for (int r = 0; r < nRes; r++) {
+            if (nz[(nTmp + r) * nCol + j]) {
+                rows[count++] = r;
+            }
+        }
+        [modelCode addPatternColumnForKind:kind rows:rows count:count];
+    }
+
+    return 1;
+}
+
+/* ========================================================================== */
+
+/**
+ @brief Temporaries that are assigned in the parameter stage
+
+ @discussion    A temporary is assigned in the parameter stage when it has
+ a single assignment, outside any conditional and before any use, of an
+ expression of parameters, constants, flags and the temporaries of the
+ stage. Its value then only changes with the parameters.
+
+ @return 0 - error, 1 - success
+ */
+- (int)markParameterStage {
+    PRX_OPD *opd[MAXCMD];
+    int nAss[MAXEQU]; /* number of assignments to a temporary */
+    int Used[MAXEQU]; /* temporary is used by a previous statement */
+    int n;
+
+    for (int t = 0; t < nTmp; t++) {
+        TmpStage[t] = 0;
+        nAss[t] = 0;
+        Used[t] = 0;
+    }
+    for (int s = 0; NodeH[s]; s++) {
+        pxNode = NodeH[s];
+        if (pxNode->opr == ASS && pxNode->c.optr->typ == TMP) {
+            nAss[pxNode->c.optr->ind]++;
+        }
+    }
+    for (int s = 0; NodeH[s]; s++) {
+        pxNode = NodeH[s];
+        if (pxNode->opr == ASS && pxNode->c.optr->typ == TMP &&
+            StmIf[s] < 0 && nAss[pxNode->c.optr->ind] == 1 &&
+            !Used[pxNode->c.optr->ind] &&
+            [self isInvariantNode:pxNode->o1]) {
+            TmpStage[pxNode->c.optr->ind] = 1;
+        }
+        n = [self operandsOfNode:pxNode->o1 into:opd count:0];
+        if (n < 0) {
+            break; /* no further statements in the stage */
+        }
+        for (int i = 0; i < n; i++) {
+            if (opd[i]->typ == TMP) {
+                Used[opd[i]->ind] = 1;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ @brief Check whether an expression depends on the parameters only
+
+ @param p expression
+ @return 1 - parameters, constants, flags and temporaries of the parameter
+ stage only, 0 - other operands
+ */
+- (int)isInvariantNode:(PRX_NODE *)p {
+    PRX_SHARE key, *pShare;
+
+    if (!p) {
+        return 1;
+    }
+    if (BtShared) {
+        key.node = p;
+        pShare = (PRX_SHARE *)bt_search(BtShared, (char *)&key);
+        if (pShare) {
+            return pShare->stage;
+        }
+    }
+    switch (p->opr) {
+    case NUM:
+        return 1;
+    case OPD:
+        switch (p->c.optr->typ) {
+        case PAR:
+        case CON:
+        case FLG:
+            return 1;
+        case TMP:
+            return TmpStage[p->c.optr->ind];
+        default:
+            return 0;
+        }
+    case DOPD:
+        return 0;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        return [self isInvariantNode:p->o1] && [self isInvariantNode:p->c.o2];
+    default:
+        return [self isInvariantNode:p->o1];
+    }
+}
+
+/**
+ @brief Check whether an expression depends on primal values only
+
+ @param p expression
+ @return 1 - primal values only, 0 - contains a derivative
+ */
+- (int)isPrimalNode:(PRX_NODE *)p {
+    PRX_SHARE key, *pShare;
+
+    if (!p) {
+        return 1;
+    }
+    key.node = p;
+    pShare = (PRX_SHARE *)bt_search(BtShared, (char *)&key);
+    if (pShare) {
+        return pShare->primal;
+    }
+    switch (p->opr) {
+    case DOPD:
+        return 0;
+    case OPD:
+    case NUM:
+        return 1;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        return [self isPrimalNode:p->o1] && [self isPrimalNode:p->c.o2];
+    default:
+        return [self isPrimalNode:p->o1];
+    }
+}
+
+/**
+ @brief Sharing of a subexpression in the code of the derivatives
+
+ @discussion    While counting, each operator node gets a record with the
+ number of times its code is generated. Constants and negations are not
+ recorded. The operands of a subexpression of primal values that was
+ counted before are not visited again, so that its subexpressions are
+ counted once for all its occurrences. A subexpression of parameters,
+ constants and flags is recorded for the parameter stage, and its operands
+ are not visited. In the function code only these are recorded. <br>
+ While using, a subexpression that has a temporary is replaced by it; in
+ the function code only by a temporary of the stage.
+
+ @param pNode node in a function or derivative tree
+ @return index of the temporary that holds the value, -1 to generate the
+ code of the node, -2 to skip it
+ */
+- (int)sharedSlotForNode:(PRX_NODE *)pNode {
+    PRX_SHARE key, *pShare;
+    int stage;
+
+    if (pNode->opr < AND || pNode->opr > SGN || pNode->opr == NEG ||
+        pNode->opr == EQU ||
+        (pNode->opr == REV && pNode->o1->opr == NUM)) {
+        return -1;
+    }
+    key.node = pNode;
+    pShare = (PRX_SHARE *)bt_search(BtShared, (char *)&key);
+    if (bShare == 2) {
+        if (!pShare || (bFunction && !pShare->stage)) {
+            return -1;
+        }
+        return pShare->ind;
+    }
+    if (pShare) {
+        pShare->count++;
+        return pShare->primal ? -2 : -1;
+    }
+    stage = [self isInvariantNode:pNode];
+    if (bFunction && !stage) {
+        return -1;
+    }
+    pShare = (PRX_SHARE *)mem_slot(DTree, sizeof(PRX_SHARE));
+    pShare->node = pNode;
+    pShare->count = 1;
+    pShare->primal = stage || [self isPrimalNode:pNode];
+    pShare->stage = stage;
+    pShare->ind = -1;
+    pShare->next = NULL;
+    bt_insert(BtShared, (char *)pShare);
+    if (pShareLast) {
+        pShareLast->next = pShare;
+    } else {
+        pShareFirst = pShare;
+    }
+    pShareLast = pShare;
+    return stage ? -2 : -1;
+}
+
+/**
+ @brief Temporaries for the shared subexpressions of an expression
+
+ @discussion    A subexpression of primal values is shared when its code is
+ generated more than once. A subexpression of the parameter stage always
+ gets a temporary. The subexpressions are assigned before the expressions
+ that use them.
+
+ @param p expression
+ @param stage assign the subexpressions of the parameter stage
+ @return 0 - error, 1 - success
+ */
+- (int)genSharedAtNode:(PRX_NODE *)p inStage:(int)stage {
+    PRX_SHARE key, *pShare;
+
+    if (!p || p->opr < AND || p->opr > SGN) {
+        return 1;
+    }
+    key.node = p;
+    pShare = (PRX_SHARE *)bt_search(BtShared, (char *)&key);
+    if (pShare && pShare->ind >= 0) {
+        return 1;
+    }
+    switch (p->opr) {
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        if (![self genSharedAtNode:p->o1 inStage:stage] ||
+            ![self genSharedAtNode:p->c.o2 inStage:stage]) {
+            return 0;
+        }
+        break;
+    default:
+        if (![self genSharedAtNode:p->o1 inStage:stage]) {
+            return 0;
+        }
+        break;
+    }
+    if (!pShare || pShare->stage != stage || nTmp >= MAXEQU) {
+        return 1;
+    }
+    if (!stage && (pShare->count < 2 || !pShare->primal)) {
+        return 1;
+    }
+    if (![self genCodeForNode:p]) {
+        return 0;
+    }
+    [modelCode addOperator:ASS];
+    [modelCode addType:TMP];
+    [modelCode addIndex:nTmp];
+    pShare->ind = nTmp++;
+    return 1;
+}
+
+/**
+ @brief Assignment of the shared subexpressions
+
+ @discussion    At the end of the function code all temporaries have their
+ final value, which is the value that the code of the derivatives uses.
+ They follow an SOD operator, at which an evaluation without Jacobians
+ ends, so that the residuals alone do not compute them. <br>
+ The subexpressions of the parameter stage only use parameters, constants,
+ flags and the temporaries of the stage, and are assigned in the stage.
+
+ @param stage assign the subexpressions of the parameter stage
+ @return 0 - error, 1 - success
+ */
+- (int)genSharedSubexpressionsInStage:(int)stage {
+
+    [modelCode addSourceLine:0];
+    if (!stage) {
+        [modelCode addOperator:SOD];
+    }
+    for (PRX_SHARE *pShare = pShareFirst; pShare; pShare = pShare->next) {
+        if (pShare->stage == stage &&
+            ![self genSharedAtNode:pShare->node inStage:stage]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ========================================================================== */
+
 /**
  @brief Simplification of expressions
 
@@ -2296,12 +4686,14 @@ int numTraverse(char *rec) {
             }
             p->o1 = [self getNum:value];
         } else if (p2->opr == MUL) {
-            if (p2->o1->opr == NEG) {
+            if (p2->o1->opr == NEG) { /* p2 may be shared */
+                NODED(pD, MUL, p2->o1->o1, p2->c.o2);
                 p->opr = ADD;
-                p2->o1 = p2->o1->o1;
+                p->c.o2 = pD;
             } else if (p2->c.o2->opr == NEG) {
+                NODED(pD, MUL, p2->o1, p2->c.o2->o1);
                 p->opr = ADD;
-                p2->c.o2 = p2->c.o2->o1;
+                p->c.o2 = pD;
             }
         }
         break;
@@ -2353,6 +4745,12 @@ int numTraverse(char *rec) {
                 ERROR("Multiplication overflow");
             }
             p->o1 = [self getNum:value];
+        } else if (p1->opr == EXP && p2->opr == EXP) {
+            NODED(pD, ADD, p1->o1, p2->o1);
+            p->opr = EXP;
+            p->o1 = pD;
+            p->c.o2 = NULL;
+            nExpFused++;
         }
         break;
     case DIV:
@@ -2396,6 +4794,12 @@ int numTraverse(char *rec) {
                 p->o1 = N_1;
                 p->c.o2 = NULL;
             }
+        } else if (p1->opr == EXP && p2->opr == EXP) {
+            NODED(pD, SUB, p1->o1, p2->o1);
+            p->opr = EXP;
+            p->o1 = pD;
+            p->c.o2 = NULL;
+            nExpFused++;
         }
         break;
     case REV:
@@ -2450,10 +4854,155 @@ int numTraverse(char *rec) {
             p->c.o2 = NULL;
         }
         break;
+    case NOT:
+        assert(p1 != NULL);
+        if (p1->opr == NUM) {
+            p->opr = EQU;
+            p->o1 = (p1->c.nptr->val == 0) ? N_1 : N_0;
+            p->c.o2 = NULL;
+        }
+        break;
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+        assert(p1 != NULL);
+        assert(p2 != NULL);
+        if (p1->opr == NUM && p2->opr == NUM) {
+            double a = p1->c.nptr->val, b = p2->c.nptr->val;
+            int c = 0;
+            switch (opr) { /* as the interpreter */
+            case AND:
+                c = (a != 0 && b != 0);
+                break;
+            case OR:
+                c = (a != 0 || b != 0);
+                break;
+            case LT:
+                c = (a < b);
+                break;
+            case GT:
+                c = (a > b);
+                break;
+            case LE:
+                c = (a <= b);
+                break;
+            case GE:
+                c = (a >= b);
+                break;
+            case EQ:
+                c = (a == b);
+                break;
+            default:
+                c = (a != b);
+                break;
+            }
+            p->opr = EQU;
+            p->o1 = c ? N_1 : N_0;
+            p->c.o2 = NULL;
+        }
+        break;
     default:
         break;
     }
     return 1;
 }
 
+
+/**
+ @brief Simplification of a derivative
+
+ @discussion The nodes are simplified one by one, twice, and the
+ expression is then rewritten by equality saturation. The nodes are
+ counted, except while the shared subexpressions are counted.
+
+ @param p assignment of the derivative
+ @return 0 - error, 1 - success
+ */
+- (int)simplifyDerivativeAtNode:(PRX_NODE *)p {
+    int ok;
+
+    if (bShare != 1) {
+        nNodes[2] += [self nodesOfNode:p->o1];
+    }
+    [self simplifyExpressionAtNode:p];
+    [self simplifyExpressionAtNode:p];
+    ok = [self saturateDerivativeAtNode:p];
+    if (bShare != 1) {
+        nNodes[3] += [self nodesOfNode:p->o1];
+    }
+    return ok;
+}
+
+/**
+ @brief Equality saturation of a derivative
+
+ @discussion The expression is rewritten by equality saturation, within
+ the budget, and replaced by the equal expression of the lowest cost, when
+ that saves at least one operation outside the parameter stage. The result
+ is kept per expression, so that the counting and the use of the shared
+ subexpressions see the same derivatives.
+
+ @param p assignment of the derivative
+ @return 0 - error, 1 - success
+ */
+- (int)saturateDerivativeAtNode:(PRX_NODE *)p {
+    PRX_SATURATE key, *pSat;
+    struct EGR_GRAPH *g;
+    struct EGR_TERM *term = NULL, *t;
+    PRX_NODE **node = NULL;
+    int cls, nTerm = 0;
+    double cost, best;
+
+    if (egrBudget.maxNodes <= 0 || p->o1->opr == NUM ||
+        p->o1->opr == OPD || p->o1->opr == DOPD) {
+        return 1;
+    }
+    key.node = p->o1;
+    pSat = (PRX_SATURATE *)bt_search(BtSaturated, (char *)&key);
+    if (pSat) {
+        p->o1 = pSat->result;
+        return 1;
+    }
+    pSat = (PRX_SATURATE *)mem_slot(DTree, sizeof(PRX_SATURATE));
+    pSat->node = pSat->result = p->o1;
+    bt_insert(BtSaturated, (char *)pSat);
+
+    g = egr_new(&egrBudget);
+    if (!g) {
+        return 1; /* the expression is kept */
+    }
+    cls = egr_expression(g, p->o1, TmpStage);
+    cost = (cls < 0) ? -1 : egr_extract(g, cls, NULL, NULL);
+    if (cost > 0 && egr_saturate(g) >= 0) {
+        best = egr_extract(g, cls, &term, &nTerm);
+        if (best >= 0 && best <= cost - 1) {
+            node = malloc(nTerm * sizeof(PRX_NODE *));
+        }
+    }
+    if (node) {
+        for (int k = 0; k < nTerm; k++) {
+            t = term + k;
+            if (t->leaf) {
+                node[k] = t->leaf;
+            } else if (t->opr == NUM) {
+                node[k] = [self getNum:t->val];
+            } else {
+                NODED(node[k], t->opr, node[t->o1],
+                      (t->o2 < 0) ? NULL : node[t->o2]);
+            }
+        }
+        pSat->result = p->o1 = node[nTerm - 1];
+        nSaturated++;
+    }
+    free(node);
+    free(term);
+    egr_free(g);
+    return 1;
+}
+
 @end
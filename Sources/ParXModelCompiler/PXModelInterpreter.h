@@ -22,16 +22,26 @@
 #ifndef _PXModelInterpreter_h
 #define _PXModelInterpreter_h
 
-#import "prx_def.h"
+#import "PXModelProgram.h"
 
 @class PXModelCode;
 
 @interface PXModelInterpreter : NSObject
 
 @property int errorCode;
+@property BOOL staged;
+@property BOOL profiling;
+@property(readonly, nonnull) PXModelProgram *program;
 
 - (nullable PXModelInterpreter *)initWithCode:(nonnull PXModelCode *)modelCode;
 
+- (nullable PXModelInterpreter *)initWithProgram:
+    (nonnull PXModelProgram *)program;
+
+- (BOOL)evaluateStageForPar:(nonnull const double *)p
+                        con:(nonnull const double *)c
+                       flag:(nonnull const double *)f;
+
 - (BOOL)evaluateForVar:(nonnull const double *)x
                    aux:(nonnull const double *)a
                    par:(nonnull const double *)p
@@ -46,6 +56,84 @@
               parFlags:(nullable const BOOL *)pf
                   JacP:(nullable double *)jp;
 
+- (BOOL)evaluateForVar:(nonnull const double *)x
+                   aux:(nonnull const double *)a
+                   par:(nonnull const double *)p
+                   con:(nonnull const double *)c
+                  flag:(nonnull const double *)f
+                   res:(nonnull double *)r
+              jacXFlag:(const BOOL)jxf
+            varColumns:(nullable const int *)xc
+              varCount:(int)nxc
+                  JacX:(nullable double *)jx
+                  JacA:(nullable double *)ja
+              jacPFlag:(const BOOL)jpf
+            parColumns:(nullable const int *)pc
+              parCount:(int)npc
+                  JacP:(nullable double *)jp;
+
+- (BOOL)evaluateJacobianVectorForVar:(nonnull const double *)x
+                                 aux:(nonnull const double *)a
+                                 par:(nonnull const double *)p
+                                 con:(nonnull const double *)c
+                                flag:(nonnull const double *)f
+                                 res:(nonnull double *)r
+                              varDir:(nullable const double *)vx
+                              auxDir:(nullable const double *)va
+                              parDir:(nullable const double *)vp
+                              resDir:(nonnull double *)jv;
+
+- (BOOL)evaluateVectorJacobianForVar:(nonnull const double *)x
+                                 aux:(nonnull const double *)a
+                                 par:(nonnull const double *)p
+                                 con:(nonnull const double *)c
+                                flag:(nonnull const double *)f
+                                 res:(nonnull double *)r
+                             weights:(nonnull const double *)w
+                              varAdj:(nullable double *)gx
+                              auxAdj:(nullable double *)ga
+                              parAdj:(nullable double *)gp;
+
+- (BOOL)evaluateHessianVectorForVar:(nonnull const double *)x
+                                aux:(nonnull const double *)a
+                                par:(nonnull const double *)p
+                                con:(nonnull const double *)c
+                               flag:(nonnull const double *)f
+                                res:(nonnull double *)r
+                          direction:(nonnull const double *)v
+                               JacP:(nonnull double *)jp
+                           HessVecP:(nonnull double *)hv;
+
+- (BOOL)evaluateHessianForVar:(nonnull const double *)x
+                          aux:(nonnull const double *)a
+                          par:(nonnull const double *)p
+                          con:(nonnull const double *)c
+                         flag:(nonnull const double *)f
+                          res:(nonnull double *)r
+                         JacP:(nonnull double *)jp
+                        HessP:(nonnull double *)h;
+
+- (BOOL)evaluatePoints:(int)nPoints
+                forVar:(nonnull const double *)x
+                   aux:(nonnull const double *)a
+                   par:(nonnull const double *)p
+                   con:(nonnull const double *)c
+                  flag:(nonnull const double *)f
+                   res:(nonnull double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(nullable const BOOL *)xf
+                  JacX:(nullable double *)jx
+                  JacA:(nullable double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(nullable const BOOL *)pf
+                  JacP:(nullable double *)jp
+                status:(nonnull int *)status
+            errorCodes:(nullable int *)ec;
+
+- (nonnull NSArray<NSDictionary<NSString *, NSNumber *> *> *)profileLines;
+- (nonnull NSArray<NSDictionary<NSString *, NSNumber *> *> *)profileOperators;
+- (void)resetProfile;
+
 @end
 
 #endif
@@ -21,276 +21,361 @@
 
 #import <Foundation/Foundation.h>
 #import "PXModelInterpreter.h"
-#import "PXModelCode.h"
-
-@interface PXModelInterpreter ()
-
-- (BOOL)referenceCode:(PXModelCode *)modelCode;
-
-@end
+#import "PXModelProgram.h"
+#import "PXModelWorkspace.h"
 
 /**
  @brief Interpreter for model code generated by the ParX Model Compiler
+
+ @discussion    Combines a linked program with a workspace of its own.
+ Interpreters on different threads may share one program, see initWithProgram.
  */
 @implementation PXModelInterpreter {
 
-    /** number of residuals */
-    int nRes;
-
-    /** number of variables */
-    int nVar;
+    /** scratch storage of this interpreter */
+    PXModelWorkspace *workspace;
+}
 
-    /** number of auxillary variables */
-    int nAux;
+/**
+ @brief Initialize with compiled model code
 
-    /** number of parameters */
-    int nPar;
+ @param modelCode compiled code
+ */
+- (PXModelInterpreter *)initWithCode:(PXModelCode *)modelCode {
 
-    /** number of flags */
-    int nFlg;
+    PXModelProgram *program = [[PXModelProgram alloc] initWithCode:modelCode];
+    if (!program) {
+        return nil;
+    }
+    return [self initWithProgram:program];
+}
 
-    /** number of constants */
-    int nCon;
+/**
+ @brief Initialize with a linked program, which may be shared
 
-    /** number of numerical constants */
-    int nNum;
+ @param program linked interpreter code
+ */
+- (PXModelInterpreter *)initWithProgram:(PXModelProgram *)program {
 
-    /** number of temporaries */
-    int nTmp;
+    self = [super init];
+    if (self) {
+        _program = program;
+        workspace = [[PXModelWorkspace alloc] initWithProgram:program];
+        if (!workspace) {
+            return nil;
+        }
+    }
+    return self;
+}
 
-    /** length of code stack */
-    int nCode;
+- (int)errorCode {
+    return workspace.errorCode;
+}
 
-    /** Start pointer for kinds of deriv.s
-     *
-     * [0]: function code <br>
-     * [1]: variables derivatives <br>
-     * [2]: auxiliaries derivatives <br>
-     * [3]: parameters derivatives <br>
-     */
-    CODE *kindStart[4];
+- (void)setErrorCode:(int)errorCode {
+    workspace.errorCode = errorCode;
+}
 
-    /** operand stack */
-    double *Stack;
+- (BOOL)staged {
+    return workspace.staged;
+}
 
-    /** pointer to temporaries store */
-    double *Tmp;
+- (void)setStaged:(BOOL)staged {
+    workspace.staged = staged;
+}
 
-    /** pointer to deriv. of temporaries */
-    double *DTmp;
+- (BOOL)profiling {
+    return workspace.profiling;
+}
 
-    /** pointer to numerical constants */
-    double *Num;
+- (void)setProfiling:(BOOL)profiling {
+    workspace.profiling = profiling;
 }
 
 /**
- @brief Initialize with compiled model code
+ @brief Execution of the parameter stage
 
- @param modelCode compiled code
+ @discussion    See PXModelProgram. The next evaluations with the same
+ parameters, constants and flags use the values of the stage; others
+ evaluate it again.
+
+ @param p parameters
+ @param c constants
+ @param f flags
+ @return YES/NO for success
  */
-- (PXModelInterpreter *)initWithCode:(PXModelCode *)modelCode {
+- (BOOL)evaluateStageForPar:(const double *)p
+                        con:(const double *)c
+                       flag:(const double *)f {
 
-    self = [super init];
-    if (self) {
-        nRes = (int)[[modelCode resName] count];
-        nVar = (int)[[modelCode varName] count];
-        nAux = (int)[[modelCode auxName] count];
-        nPar = (int)[[modelCode parName] count];
-        nFlg = (int)[[modelCode flgName] count];
-        nCon = (int)[[modelCode conName] count];
-        nNum = [modelCode getLengthNumbers];
-        nTmp = [modelCode numberOfTemp];
-        nCode = [modelCode getLengthCode];
-
-        if (nNum < 0 || nTmp < 0) {
-            return nil;
-        }
-        if (nTmp > 0) {
-            Tmp = (double *)calloc(nTmp, sizeof(double));
-            DTmp = (double *)calloc(nTmp, sizeof(double));
-        } else {
-            Tmp = NULL;
-            DTmp = NULL;
-        }
+    return [_program evaluateStageForPar:p con:c flag:f workspace:workspace];
+}
 
-        if (nNum > 0) {
-            Num = (double *)calloc(nNum, sizeof(double));
-            double *inNum = [modelCode getModelNumbers];
-            for (int i = 0; i < nNum; i++) {
-                Num[i] = inNum[i];
-            }
-        } else {
-            Num = NULL;
-        }
+/**
+ @brief Execution of interpreter code
 
-        int maxCodeSize = nCode * 2; /* always ok. Worst case: all codes
-                                        if/else, or all push on stack */
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xf flags per variable
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pf flags per parameter
+ @param jp Jacobian for parameters
+ @return YES/NO for success
+ */
+- (BOOL)evaluateForVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(const BOOL *)xf
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(const BOOL *)pf
+                  JacP:(double *)jp {
 
-        kindStart[0] = (CODE *)calloc(maxCodeSize, sizeof(CODE));
-        kindStart[1] = NULL;
-        kindStart[2] = NULL;
-        kindStart[3] = NULL;
+    return [_program evaluateForVar:x
+                                aux:a
+                                par:p
+                                con:c
+                               flag:f
+                                res:r
+                           jacXFlag:jxf
+                           varFlags:xf
+                               JacX:jx
+                               JacA:ja
+                           jacPFlag:jpf
+                           parFlags:pf
+                               JacP:jp
+                          workspace:workspace];
+}
 
-        Stack = (double *)calloc(maxCodeSize, sizeof(double));
+/**
+ @brief Execution of interpreter code, for lists of columns
 
-        _errorCode = 0;
+ @discussion    See PXModelProgram for the lists of columns.
 
-        int result = [self referenceCode:modelCode];
-        if (!result) {
-            return nil;
-        }
-    }
-    return self;
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xc list of variables, NULL for all variables
+ @param nxc length of the list of variables
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pc list of parameters, NULL for all parameters
+ @param npc length of the list of parameters
+ @param jp Jacobian for parameters
+ @return YES/NO for success
+ */
+- (BOOL)evaluateForVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+            varColumns:(const int *)xc
+              varCount:(int)nxc
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+            parColumns:(const int *)pc
+              parCount:(int)npc
+                  JacP:(double *)jp {
+
+    return [_program evaluateForVar:x
+                                aux:a
+                                par:p
+                                con:c
+                               flag:f
+                                res:r
+                           jacXFlag:jxf
+                         varColumns:xc
+                           varCount:nxc
+                               JacX:jx
+                               JacA:ja
+                           jacPFlag:jpf
+                         parColumns:pc
+                           parCount:npc
+                               JacP:jp
+                          workspace:workspace];
 }
 
-- (void)dealloc {
+/**
+ @brief Product of the Jacobians and a direction
+
+ @discussion    See PXModelProgram.
 
-    free(Tmp);
-    free(DTmp);
-    free(Num);
-    free(kindStart[0]);
-    free(Stack);
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param vx direction of the variables, NULL for zero
+ @param va direction of the auxiliary variables, NULL for zero
+ @param vp direction of the parameters, NULL for zero
+ @param jv product of the Jacobians and the direction, per residual
+ @return YES/NO for success
+ */
+- (BOOL)evaluateJacobianVectorForVar:(const double *)x
+                                 aux:(const double *)a
+                                 par:(const double *)p
+                                 con:(const double *)c
+                                flag:(const double *)f
+                                 res:(double *)r
+                              varDir:(const double *)vx
+                              auxDir:(const double *)va
+                              parDir:(const double *)vp
+                              resDir:(double *)jv {
+
+    return [_program evaluateJacobianVectorForVar:x
+                                              aux:a
+                                              par:p
+                                              con:c
+                                             flag:f
+                                              res:r
+                                           varDir:vx
+                                           auxDir:va
+                                           parDir:vp
+                                           resDir:jv
+                                        workspace:workspace];
 }
 
 /**
- @brief Input and adaptation of interpreter code
+ @brief Product of a vector of the residuals and the Jacobians
 
- @discussion    check array indices <br>
- replace for conditionals indices by pointers
+ @discussion    See PXModelProgram.
 
- @param modelCode model code
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param w weights of the residuals
+ @param gx product for the variables, NULL if not needed
+ @param ga product for the auxiliary variables, NULL if not needed
+ @param gp product for the parameters, NULL if not needed
  @return YES/NO for success
  */
-- (BOOL)referenceCode:(PXModelCode *)modelCode {
+- (BOOL)evaluateVectorJacobianForVar:(const double *)x
+                                 aux:(const double *)a
+                                 par:(const double *)p
+                                 con:(const double *)c
+                                flag:(const double *)f
+                                 res:(double *)r
+                             weights:(const double *)w
+                              varAdj:(double *)gx
+                              auxAdj:(double *)ga
+                              parAdj:(double *)gp {
+
+    return [_program evaluateVectorJacobianForVar:x
+                                              aux:a
+                                              par:p
+                                              con:c
+                                             flag:f
+                                              res:r
+                                          weights:w
+                                           varAdj:gx
+                                           auxAdj:ga
+                                           parAdj:gp
+                                        workspace:workspace];
+}
 
-    OPR opr = INVAL; /* current operator */
-    TYP typ;         /* type of operand */
-    int ind;         /* index of operand */
-    int kod = 0;     /* kind of derivatives (var, aux or par) */
+/**
+ @brief Product of the Hessians for the parameters and a direction
 
-    CODE *IfPos[MAXLEVEL + 1] = {NULL};
-    CODE *ElsePos[MAXLEVEL + 1] = {NULL};
-    int level = 0;
+ @discussion    See PXModelProgram for the layout of the product.
 
-    CODE *inCode = [modelCode getModelCode];
-    CODE *code = kindStart[0];
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param v direction of the parameters
+ @param jp Jacobian for parameters
+ @param hv product of the Hessians and the direction
+ @return YES/NO for success
+ */
+- (BOOL)evaluateHessianVectorForVar:(const double *)x
+                                aux:(const double *)a
+                                par:(const double *)p
+                                con:(const double *)c
+                               flag:(const double *)f
+                                res:(double *)r
+                          direction:(const double *)v
+                               JacP:(double *)jp
+                           HessVecP:(double *)hv {
+
+    return [_program evaluateHessianVectorForVar:x
+                                             aux:a
+                                             par:p
+                                             con:c
+                                            flag:f
+                                             res:r
+                                       direction:v
+                                            JacP:jp
+                                        HessVecP:hv
+                                       workspace:workspace];
+}
 
-    for (int i = 0; i < nCode; i++) {
-        opr = inCode[i].o;
-        if (opr >= STOP) {
-            break;
-        }
-        switch (opr) {
-        default:
-            (*code++).o = opr;
-            break;
-        case DOPD:
-        case OPD:
-        case ASS:
-        case NASS:
-        case CLR:
-            typ = inCode[++i].t;
-            ind = inCode[++i].i;
-            switch (typ) { /* check array index */
-            case VAR:
-                if (ind >= nVar) {
-                    return NO;
-                }
-                break;
-            case AUX:
-                if (ind >= nAux) {
-                    return NO;
-                }
-                break;
-            case PAR:
-                if (ind >= nPar) {
-                    return NO;
-                }
-                break;
-            case CON:
-                if (ind >= nCon) {
-                    return NO;
-                }
-                break;
-            case FLG:
-                if (ind >= nFlg) {
-                    return NO;
-                }
-                break;
-            case RES:
-                if (ind >= nRes) {
-                    return NO;
-                }
-                break;
-            case TMP:
-                if (ind >= nTmp) {
-                    return NO;
-                }
-                break;
-            case DRES:
-                if (ind >= nRes) {
-                    return NO;
-                }
-                break;
-            case DTMP:
-                if (ind >= nTmp) {
-                    return NO;
-                }
-                break;
-            default:
-                return NO;
-                break;
-            }
-            (*code++).o = opr;
-            (*code++).t = typ;
-            (*code++).i = ind;
-            break;
-        case NUM:
-            ind = inCode[++i].i;
-            (*code++).o = opr;
-            (*code++).i = ind;
-            break;
-        case IF:
-            (*code++).o = IF;
-            IfPos[++level] = code++;
-            ElsePos[level] = (CODE *)NULL;
-            break;
-        case ELSE:
-            (*code++).o = JMP;
-            ElsePos[level] = code++;
-            assert(IfPos[level] != NULL);
-            (*IfPos[level]).c = code;
-            break;
-        case FI:
-            if (ElsePos[level]) {
-                (*ElsePos[level]).c = code;
-            } else {
-                assert(IfPos[level] != NULL);
-                (*IfPos[level]).c = code;
-            }
-            level--;
-            break;
-        case EOD: /* End Of (single) Derivative */
-            (*code++).o = EOD;
-            break;
-        case SOK: /* Start Of Kind of derivatives */
-            kindStart[++kod] = code;
-            (*code++).o = SOK;
-            break;
-        }
-    }
+/**
+ @brief Hessians of the residuals for the parameters
 
-    if (opr != STOP) {
-        return NO;
-    }
-    (*code).o = INVAL;
+ @discussion    See PXModelProgram for the packed upper triangles.
 
-    return YES;
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jp Jacobian for parameters
+ @param h Hessians for the parameters, upper triangles
+ @return YES/NO for success
+ */
+- (BOOL)evaluateHessianForVar:(const double *)x
+                          aux:(const double *)a
+                          par:(const double *)p
+                          con:(const double *)c
+                         flag:(const double *)f
+                          res:(double *)r
+                         JacP:(double *)jp
+                        HessP:(double *)h {
+
+    return [_program evaluateHessianForVar:x
+                                       aux:a
+                                       par:p
+                                       con:c
+                                      flag:f
+                                       res:r
+                                      JacP:jp
+                                     HessP:h
+                                 workspace:workspace];
 }
 
 /**
- @brief Execution of interpreter code
+ @brief Batched execution of interpreter code
 
+ @discussion    See PXModelProgram for the data layout.
+
+ @param nPoints number of points
  @param x variables
  @param a auxillary variables
  @param p parameters
@@ -304,9 +389,12 @@
  @param jpf flag evaluate Jacobian for parameters
  @param pf flags per parameter
  @param jp Jacobian for parameters
- @return YES/NO for success
+ @param status PXPointStatus per point
+ @param ec optional error code per point, as raised by error()
+ @return YES/NO for success of all points
  */
-- (BOOL)evaluateForVar:(const double *)x
+- (BOOL)evaluatePoints:(int)nPoints
+                forVar:(const double *)x
                    aux:(const double *)a
                    par:(const double *)p
                    con:(const double *)c
@@ -318,298 +406,54 @@
                   JacA:(double *)ja
               jacPFlag:(const BOOL)jpf
               parFlags:(const BOOL *)pf
-                  JacP:(double *)jp {
-    /** interpreter code pointer */
-    CODE *code = kindStart[0];
-
-    /** operand stack pointer */
-    double *pSt = Stack;
-
-    int kod = 0;      /* kind of derivatives              */
-    int iDvt = 0;     /* index of current deriv. variable */
-    double *jac = jx; /* pointer to current Jacobian      */
-
-    OPR opr;    /* operator                         */
-    TYP typ;    /* type of operand                  */
-    int ind;    /* operand index                    */
-    double val; /* operand value                    */
-
-    self.errorCode = 0;
-
-    for (;;) {
-        opr = (*code++).o;
-        switch (opr) {
-        default:
-            self.errorCode = -1;
-            return NO; /* error */
-        case INVAL:
-            return YES; /* finished */
-        case AND:
-            pSt--;
-            *pSt = (*pSt != 0 && *(pSt + 1) != 0) ? 1 : 0;
-            break;
-        case OR:
-            pSt--;
-            *pSt = (*pSt != 0 || *(pSt + 1) != 0) ? 1 : 0;
-            break;
-        case NOT:
-            *pSt = (*pSt == 0) ? 1 : 0;
-            break;
-        case LT:
-            pSt--;
-            *pSt = (*pSt < *(pSt + 1)) ? 1 : 0;
-            break;
-        case GT:
-            pSt--;
-            *pSt = (*pSt > *(pSt + 1)) ? 1 : 0;
-            break;
-        case LE:
-            pSt--;
-            *pSt = (*pSt <= *(pSt + 1)) ? 1 : 0;
-            break;
-        case GE:
-            pSt--;
-            *pSt = (*pSt >= *(pSt + 1)) ? 1 : 0;
-            break;
-        case EQ:
-            pSt--;
-            *pSt = (*pSt == *(pSt + 1)) ? 1 : 0;
-            break;
-        case NE:
-            pSt--;
-            *pSt = (*pSt != *(pSt + 1)) ? 1 : 0;
-            break;
-        case ADD:
-            pSt--;
-            *pSt = *pSt + *(pSt + 1);
-            break;
-        case SUB:
-            pSt--;
-            *pSt = *pSt - *(pSt + 1);
-            break;
-        case MUL:
-            pSt--;
-            *pSt = *pSt * *(pSt + 1);
-            break;
-        case DIV:
-            pSt--;
-            *pSt = *pSt / *(pSt + 1);
-            break;
-        case POW:
-            pSt--;
-            *pSt = pow(*pSt, *(pSt + 1));
-            break;
-        case SGN:
-            *pSt = (*pSt >= 0) ? 1 : -1;
-            break;
-        case SIN:
-            *pSt = sin(*pSt);
-            break;
-        case COS:
-            *pSt = cos(*pSt);
-            break;
-        case TAN:
-            *pSt = tan(*pSt);
-            break;
-        case ASIN:
-            *pSt = asin(*pSt);
-            break;
-        case ACOS:
-            *pSt = acos(*pSt);
-            break;
-        case ATAN:
-            *pSt = atan(*pSt);
-            break;
-        case SINH:
-            *pSt = sinh(*pSt);
-            break;
-        case COSH:
-            *pSt = cosh(*pSt);
-            break;
-        case TANH:
-            *pSt = tanh(*pSt);
-            break;
-        case ERF:
-            *pSt = erf(*pSt);
-            break;
-        case EXP:
-            *pSt = exp(*pSt);
-            break;
-        case LOG:
-            *pSt = log(*pSt);
-            break;
-        case LG:
-            *pSt = log10(*pSt);
-            break;
-        case SQRT:
-            *pSt = sqrt(*pSt);
-            break;
-        case SQR:
-            *pSt = *pSt * *pSt;
-            break;
-        case NEG:
-            *pSt = -*pSt;
-            break;
-        case REV:
-            *pSt = 1.0 / *pSt;
-            break;
-        case INC:
-            *pSt += 1;
-            break;
-        case DEC:
-            *pSt -= 1;
-            break;
-        case ABS:
-            if (*pSt < 0) {
-                *pSt = -*pSt;
-            }
-            break;
-        case RET:
-            self.errorCode = *pSt;
-            // return (*pSt == 0) ? YES : NO;
-            return NO;
-            break;
-        case CHKL:
-            pSt--;
-            if (*pSt < *(pSt + 1)) {
-                return NO;
-            }
-            pSt--;
-            break;
-        case CHKG:
-            pSt--;
-            if (*pSt > *(pSt + 1)) {
-                return NO;
-            }
-            pSt--;
-            break;
-        case DOPD:
-        case OPD:
-            typ = (*code++).t;
-            ind = (*code++).i;
-
-            switch (typ) {
-            case VAR:
-                val = x[ind];
-                break;
-            case AUX:
-                val = a[ind];
-                break;
-            case PAR:
-                val = p[ind];
-                break;
-            case CON:
-                val = c[ind];
-                break;
-            case FLG:
-                val = f[ind] > 0.5 ? 1 : 0;
-                break;
-            case RES:
-                val = r[ind];
-                break;
-            case TMP:
-                val = Tmp[ind];
-                break;
-            case DRES:
-                val = jac[iDvt * nRes + ind];
-                break;
-            case DTMP:
-                val = DTmp[ind];
-                break;
-            default:
-                self.errorCode = -1;
-                return NO;
-                break;
-            }
-            *(++pSt) = val;
-            break;
-        case NUM:
-            ind = (*code++).i;
-            *(++pSt) = Num[ind];
-            break;
-        case LDF:
-            ind = (*code++).i;
-            *(++pSt) = f[ind] > 0.5 ? 1 : 0;
-            break;
-        case ASS:
-        case NASS:
-        case CLR:
-            typ = (*code++).t;
-            ind = (*code++).i;
-            if (opr == ASS) {
-                val = *(pSt--);
-            } else if (opr == NASS) {
-                val = -(*(pSt--));
-            } else {
-                val = 0.0;
-            }
-            switch (typ) {
-
-            case RES:
-                r[ind] = val;
-                break;
-            case TMP:
-                Tmp[ind] = val;
-                break;
-            case DRES:
-                jac[iDvt * nRes + ind] = val;
-                break;
-            case DTMP:
-                DTmp[ind] = val;
-                break;
-            default:
-                self.errorCode = -1;
-                return NO;
-                break;
-            }
-            break;
-        case IF:
-            if (*(pSt--) == 0) {
-                code = (*code).c;
-            } else {
-                code++;
-            }
-            break;
-        case EOD:
-            iDvt++;
-            if ((kod == 1) && (iDvt < nVar) && (xf[iDvt] == NO)) {
-                for (code++; (*code).o != EOD; code++)
-                    ; /* skip over variable derivative */
-            }
-            if ((kod == 3) && (iDvt < nPar) && (pf[iDvt] == NO)) {
-                for (code++; (*code).o != EOD; code++)
-                    ; /* skip over parameter derivative */
-            }
-            break;
-        case SOK:
-            kod++;
-            iDvt = 0;
-            jac = (kod == 1) ? jx : (kod == 2) ? ja : jp;
-            if (kod == 1) {
-                if (jxf == NO) {
-                    code = kindStart[3]; /* skip straight to parameter
-                                            derivatives */
-                    kod++;
-                } else if (xf[iDvt] == NO) {
-                    for (code++; (*code).o != EOD; code++)
-                        ; /* skip over first variable derivative */
-                }
-            } else if (kod == 3) {
-                if (jpf == NO) {
-                    return YES;
-                }
-                if (pf[iDvt] == NO) {
-                    for (code++; (*code).o != EOD; code++)
-                        ; /* skip over first parameter derivative */
-                }
-            }
-            break;
-        case JMP:
-            code = (*code).c;
-            break;
-        }
-    }
-    return YES;
+                  JacP:(double *)jp
+                status:(int *)status
+            errorCodes:(int *)ec {
+
+    return [_program evaluatePoints:nPoints
+                             forVar:x
+                                aux:a
+                                par:p
+                                con:c
+                               flag:f
+                                res:r
+                           jacXFlag:jxf
+                           varFlags:xf
+                               JacX:jx
+                               JacA:ja
+                           jacPFlag:jpf
+                           parFlags:pf
+                               JacP:jp
+                             status:status
+                         errorCodes:ec
+                          workspace:workspace];
+}
+
+/**
+ @brief Lines of the model file by their cost, while profiling
+
+ @discussion    See PXModelProgram.
+
+ @return entries "line", "count", "time", "function", "var", "aux" and
+ "par", by decreasing time
+ */
+- (NSArray<NSDictionary<NSString *, NSNumber *> *> *)profileLines {
+
+    return [_program profileLinesOfWorkspace:workspace];
+}
+
+/**
+ @brief Operators by their cost, while profiling
+
+ @return entries "operator", "count" and "time", by decreasing time
+ */
+- (NSArray<NSDictionary<NSString *, NSNumber *> *> *)profileOperators {
+
+    return [_program profileOperatorsOfWorkspace:workspace];
+}
+
+- (void)resetProfile {
+    [workspace resetProfile];
 }
 
 @end
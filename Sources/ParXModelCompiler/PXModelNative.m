@@ -0,0 +1,342 @@
+//
+// PXModelNative.m
+// ParXModelCompiler
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+#import <dlfcn.h>
+#import "PXModelNative.h"
+#import "PXModelCode.h"
+#import "gen_def.h"
+
+/** name of the generated model function */
+#define NATIVE_NAME "prx_model"
+
+/** C compiler for the generated source */
+#define NATIVE_CC @"/usr/bin/cc"
+
+/** signature of the generated model function, see gen_def.h */
+typedef int (*NATIVE_MODEL)(const double *x, const double *a,
+                            const double *p, const double *c,
+                            const double *f, double *r, int jxf,
+                            const unsigned char *xf, double *jx, double *ja,
+                            int jpf, const unsigned char *pf, double *jp,
+                            int *ec, double *g);
+
+@interface PXModelNative ()
+
++ (BOOL)describeCode:(PXModelCode *)modelCode model:(struct GEN_MODEL *)gm;
++ (NSError *)errorWithDescription:(NSString *)description code:(int)code;
+
+@end
+
+/**
+ @brief Model code compiled to a native shared library
+
+ @discussion    The interpreter code is translated to C, compiled with the
+ system C compiler and loaded into the process. The result is evaluated
+ with the same arguments and results as PXModelInterpreter. An instance
+ holds no state of an evaluation and can be used by any number of threads
+ at once: the scratch memory comes with each call, and the error code is
+ returned per call.
+ */
+@implementation PXModelNative {
+
+    /** handle of the loaded library */
+    void *handle;
+
+    /** the model function */
+    NATIVE_MODEL model;
+
+    /** length of the scratch, the gradients of the kinds in vector mode */
+    int nScratch;
+}
+
+/**
+ @brief Describe compiled code for the C generator
+
+ @param modelCode compiled code
+ @param gm description, output
+ @return YES/NO for success
+ */
++ (BOOL)describeCode:(PXModelCode *)modelCode model:(struct GEN_MODEL *)gm {
+
+    gm->code = [modelCode getModelCode];
+    gm->nCode = [modelCode getLengthCode];
+    gm->num = [modelCode getModelNumbers];
+    gm->nNum = [modelCode getLengthNumbers];
+    gm->nRes = (int)[[modelCode resName] count];
+    gm->nVar = (int)[[modelCode varName] count];
+    gm->nAux = (int)[[modelCode auxName] count];
+    gm->nPar = (int)[[modelCode parName] count];
+    gm->nCon = (int)[[modelCode conName] count];
+    gm->nFlg = (int)[[modelCode flgName] count];
+    gm->nTmp = [modelCode numberOfTemp];
+    for (int k = 0; k < 3; k++) {
+        gm->reverse[k] = ([modelCode getModeForKind:k] == PXDerivativeReverse);
+        gm->vector[k] = ([modelCode getModeForKind:k] == PXDerivativeVector);
+    }
+
+    return (gm->code != NULL) ? YES : NO;
+}
+
+/**
+ @brief Generate the C source of a model
+
+ @param modelCode compiled code
+ @param path output file
+ @return YES/NO for success
+ */
++ (BOOL)writeSourceForCode:(PXModelCode *)modelCode toPath:(NSString *)path {
+
+    struct GEN_MODEL gm;
+
+    if (![PXModelNative describeCode:modelCode model:&gm]) {
+        return NO;
+    }
+
+    FILE *out = fopen([path fileSystemRepresentation], "w");
+    if (!out) {
+        return NO;
+    }
+    int ok = gen_c_source(out, NATIVE_NAME, &gm);
+    if (fclose(out) != 0) {
+        ok = 0;
+    }
+    return ok ? YES : NO;
+}
+
++ (NSError *)errorWithDescription:(NSString *)description code:(int)code {
+
+    NSDictionary *errorUserInfo = [NSDictionary
+        dictionaryWithObjectsAndKeys:description, NSLocalizedDescriptionKey,
+                                     nil];
+    return [NSError errorWithDomain:@"com.Middelhoek.ParXModelCompiler"
+                               code:code
+                           userInfo:errorUserInfo];
+}
+
+/**
+ @brief Initialize with compiled model code
+
+ @param modelCode compiled code
+ @param error description of the failing step
+ */
+- (PXModelNative *)initWithCode:(PXModelCode *)modelCode
+                          error:(NSError **)error {
+
+    self = [super init];
+    if (self) {
+        handle = NULL;
+        model = NULL;
+        nScratch = 0;
+
+        NSString *base = [NSTemporaryDirectory()
+            stringByAppendingPathComponent:
+                [NSString stringWithFormat:@"ParXModel-%@",
+                                           [[NSUUID UUID] UUIDString]]];
+        NSString *srcPath = [base stringByAppendingPathExtension:@"c"];
+        NSString *libPath = [base stringByAppendingPathExtension:@"dylib"];
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+
+        if (![PXModelNative writeSourceForCode:modelCode toPath:srcPath]) {
+            [fileManager removeItemAtPath:srcPath error:nil];
+            if (error != nil) {
+                *error = [PXModelNative
+                    errorWithDescription:@"Error generating C source"
+                                    code:2];
+            }
+            return nil;
+        }
+
+        NSTask *task = [[NSTask alloc] init];
+        task.executableURL = [NSURL fileURLWithPath:NATIVE_CC];
+        /* no contraction into fma, the operations round as interpreted */
+        task.arguments = @[
+            @"-O2", @"-ffp-contract=off", @"-shared", @"-fPIC", @"-o", libPath,
+            srcPath, @"-lm"
+        ];
+
+        BOOL built = [task launchAndReturnError:nil];
+        if (built) {
+            [task waitUntilExit];
+            built = (task.terminationStatus == 0);
+        }
+        [fileManager removeItemAtPath:srcPath error:nil];
+        if (!built) {
+            [fileManager removeItemAtPath:libPath error:nil];
+            if (error != nil) {
+                *error = [PXModelNative
+                    errorWithDescription:@"Error compiling C source"
+                                    code:3];
+            }
+            return nil;
+        }
+
+        handle = dlopen([libPath fileSystemRepresentation],
+                        RTLD_NOW | RTLD_LOCAL);
+        [fileManager removeItemAtPath:libPath error:nil]; /* stays mapped */
+        if (handle) {
+            model = (NATIVE_MODEL)dlsym(handle, NATIVE_NAME);
+        }
+        if (!model) {
+            if (error != nil) {
+                *error = [PXModelNative
+                    errorWithDescription:@"Error loading native model code"
+                                    code:4];
+            }
+            return nil;
+        }
+
+        struct GEN_MODEL gm;
+        [PXModelNative describeCode:modelCode model:&gm];
+        nScratch = gen_scratch_length(&gm);
+    }
+    return self;
+}
+
+- (void)dealloc {
+
+    if (handle) {
+        dlclose(handle);
+    }
+}
+
+- (int)scratchLength {
+    return nScratch;
+}
+
+/**
+ @brief Execution of native model code
+
+ @discussion    The scratch memory is allocated for the call, when the
+ model has a kind of derivatives in vector mode.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xf flags per variable, NULL for all variables
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pf flags per parameter, NULL for all parameters
+ @param jp Jacobian for parameters
+ @param ec optional error code, as raised by error(), -1 when the scratch
+ memory cannot be allocated
+ @return YES/NO for success
+ */
+- (BOOL)evaluateForVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(const BOOL *)xf
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(const BOOL *)pf
+                  JacP:(double *)jp
+             errorCode:(int *)ec {
+
+    double *g = NULL;
+
+    if (nScratch > 0) {
+        g = (double *)malloc(nScratch * sizeof(double));
+        if (!g) {
+            if (ec) {
+                *ec = -1;
+            }
+            return NO;
+        }
+    }
+    BOOL ok = [self evaluateForVar:x
+                               aux:a
+                               par:p
+                               con:c
+                              flag:f
+                               res:r
+                          jacXFlag:jxf
+                          varFlags:xf
+                              JacX:jx
+                              JacA:ja
+                          jacPFlag:jpf
+                          parFlags:pf
+                              JacP:jp
+                           scratch:g
+                         errorCode:ec];
+    free(g);
+
+    return ok;
+}
+
+/**
+ @brief Execution of native model code, with scratch memory of the caller
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xf flags per variable, NULL for all variables
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pf flags per parameter, NULL for all parameters
+ @param jp Jacobian for parameters
+ @param g scratch of scratchLength doubles, of the calling thread
+ @param ec optional error code, as raised by error()
+ @return YES/NO for success
+ */
+- (BOOL)evaluateForVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(const BOOL *)xf
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(const BOOL *)pf
+                  JacP:(double *)jp
+               scratch:(double *)g
+             errorCode:(int *)ec {
+
+    int code = 0;
+
+    /* BOOL is a single byte holding 0 or 1 on all Apple targets */
+    int ok = model(x, a, p, c, f, r, jxf, (const unsigned char *)xf, jx, ja,
+                   jpf, (const unsigned char *)pf, jp, &code, g);
+    if (ec) {
+        *ec = code;
+    }
+
+    return ok ? YES : NO;
+}
+
+@end
@@ -0,0 +1,187 @@
+//
+// PXModelProgram.h
+// ParXModelCompiler
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef _PXModelProgram_h
+#define _PXModelProgram_h
+
+#import "prx_def.h"
+
+@class PXModelCode;
+@class PXModelWorkspace;
+
+/** Outcome of a single point in a batched evaluation */
+typedef NS_ENUM(int, PXPointStatus) {
+    PXPointStatusOK = 0,     /* evaluated successfully */
+    PXPointStatusLimit = 1,  /* operand outside its declared limits */
+    PXPointStatusError = 2,  /* model raised error() */
+    PXPointStatusInvalid = 3 /* invalid interpreter code */
+};
+
+/** Storage of the Jacobians written by a program */
+typedef NS_ENUM(int, PXJacobianLayout) {
+    PXJacobianDense = 0, /* all entries, column by column */
+    PXJacobianCSC = 1,   /* structural nonzeros, column by column */
+    PXJacobianCSR = 2    /* structural nonzeros, row by row */
+};
+
+@interface PXModelProgram : NSObject
+
+@property(readonly) int numberOfTemp;
+@property(readonly) int stackDepth;
+@property(readonly) int liveValues;
+@property(readonly) int gradientSize;
+@property(readonly) int numberOfColumns;
+@property(readonly) int tangentSize;
+@property(readonly) size_t tapeSize;
+@property(readonly) int profileSize;
+@property(readonly) int stageInputSize;
+@property(readonly) PXJacobianLayout layout;
+
+- (nullable PXModelProgram *)initWithCode:(nonnull PXModelCode *)modelCode;
+- (nullable PXModelProgram *)initWithCode:(nonnull PXModelCode *)modelCode
+                                   layout:(PXJacobianLayout)layout;
+
+- (BOOL)evaluateStageForPar:(nonnull const double *)p
+                        con:(nonnull const double *)c
+                       flag:(nonnull const double *)f
+                  workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluateForVar:(nonnull const double *)x
+                   aux:(nonnull const double *)a
+                   par:(nonnull const double *)p
+                   con:(nonnull const double *)c
+                  flag:(nonnull const double *)f
+                   res:(nonnull double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(nullable const BOOL *)xf
+                  JacX:(nullable double *)jx
+                  JacA:(nullable double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(nullable const BOOL *)pf
+                  JacP:(nullable double *)jp
+             workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluateForVar:(nonnull const double *)x
+                   aux:(nonnull const double *)a
+                   par:(nonnull const double *)p
+                   con:(nonnull const double *)c
+                  flag:(nonnull const double *)f
+                   res:(nonnull double *)r
+              jacXFlag:(const BOOL)jxf
+            varColumns:(nullable const int *)xc
+              varCount:(int)nxc
+                  JacX:(nullable double *)jx
+                  JacA:(nullable double *)ja
+              jacPFlag:(const BOOL)jpf
+            parColumns:(nullable const int *)pc
+              parCount:(int)npc
+                  JacP:(nullable double *)jp
+             workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluateJacobianVectorForVar:(nonnull const double *)x
+                                 aux:(nonnull const double *)a
+                                 par:(nonnull const double *)p
+                                 con:(nonnull const double *)c
+                                flag:(nonnull const double *)f
+                                 res:(nonnull double *)r
+                              varDir:(nullable const double *)vx
+                              auxDir:(nullable const double *)va
+                              parDir:(nullable const double *)vp
+                              resDir:(nonnull double *)jv
+                           workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluateVectorJacobianForVar:(nonnull const double *)x
+                                 aux:(nonnull const double *)a
+                                 par:(nonnull const double *)p
+                                 con:(nonnull const double *)c
+                                flag:(nonnull const double *)f
+                                 res:(nonnull double *)r
+                             weights:(nonnull const double *)w
+                              varAdj:(nullable double *)gx
+                              auxAdj:(nullable double *)ga
+                              parAdj:(nullable double *)gp
+                           workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluateHessianVectorForVar:(nonnull const double *)x
+                                aux:(nonnull const double *)a
+                                par:(nonnull const double *)p
+                                con:(nonnull const double *)c
+                               flag:(nonnull const double *)f
+                                res:(nonnull double *)r
+                          direction:(nonnull const double *)v
+                               JacP:(nonnull double *)jp
+                           HessVecP:(nonnull double *)hv
+                          workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluateHessianForVar:(nonnull const double *)x
+                          aux:(nonnull const double *)a
+                          par:(nonnull const double *)p
+                          con:(nonnull const double *)c
+                         flag:(nonnull const double *)f
+                          res:(nonnull double *)r
+                         JacP:(nonnull double *)jp
+                        HessP:(nonnull double *)h
+                    workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluatePoints:(int)nPoints
+                forVar:(nonnull const double *)x
+                   aux:(nonnull const double *)a
+                   par:(nonnull const double *)p
+                   con:(nonnull const double *)c
+                  flag:(nonnull const double *)f
+                   res:(nonnull double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(nullable const BOOL *)xf
+                  JacX:(nullable double *)jx
+                  JacA:(nullable double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(nullable const BOOL *)pf
+                  JacP:(nullable double *)jp
+                status:(nonnull int *)status
+            errorCodes:(nullable int *)ec
+             workspace:(nonnull PXModelWorkspace *)ws;
+
+- (BOOL)evaluatePoints:(int)nPoints
+                forVar:(nonnull const double *)x
+                   aux:(nonnull const double *)a
+                   par:(nonnull const double *)p
+                   con:(nonnull const double *)c
+                  flag:(nonnull const double *)f
+                   res:(nonnull double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(nullable const BOOL *)xf
+                  JacX:(nullable double *)jx
+                  JacA:(nullable double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(nullable const BOOL *)pf
+                  JacP:(nullable double *)jp
+                status:(nonnull int *)status
+            errorCodes:(nullable int *)ec
+               workers:(int)nWorkers;
+
+- (nonnull NSArray<NSDictionary<NSString *, NSNumber *> *> *)
+    profileLinesOfWorkspace:(nonnull PXModelWorkspace *)ws;
+- (nonnull NSArray<NSDictionary<NSString *, NSNumber *> *> *)
+    profileOperatorsOfWorkspace:(nonnull PXModelWorkspace *)ws;
+
+@end
+
+#endif
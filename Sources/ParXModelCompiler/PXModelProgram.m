@@ -0,0 +1,4537 @@
+//
+// PXModelProgram.m
+// ParXModelCompiler
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+#import <stdatomic.h>
+#import <time.h>
+#import <float.h>
+#import "PXModelProgram.h"
+#import "PXModelWorkspace.h"
+#import "PXModelCode.h"
+#import "vec_def.h"
+#import "pev_def.h"
+
+@interface PXModelProgram ()
+
+- (BOOL)positionNonzeros:(PXModelCode *)modelCode;
+- (void)pairColumns:(PXModelCode *)modelCode;
+- (BOOL)referenceCode:(PXModelCode *)modelCode;
+
+- (BOOL)threadCode:(BOOL)profiled;
+- (int)instructionsOfSegment:(int)s;
+- (BOOL)isStagedForPar:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+             workspace:(PXModelWorkspace *)ws;
+
+- (void)scatterGradients:(const double *)g
+                   width:(int)w
+                    kind:(int)kod
+                    into:(double *)jac
+                  stride:(int)ld
+                   count:(int)n;
+
+- (BOOL)tangentForVar:(const double *)x
+                  aux:(const double *)a
+                  par:(const double *)p
+                  con:(const double *)c
+                 flag:(const double *)f
+               varDir:(const double *)dx
+               auxDir:(const double *)da
+               parDir:(const double *)dp
+                  res:(double *)r
+               resDir:(double *)dr
+             jacPFlag:(const BOOL)jpf
+           parColumns:(const int *)pc
+             parCount:(int)npc
+                 JacP:(double *)jp
+              JacPDir:(double *)djp
+            workspace:(PXModelWorkspace *)ws;
+
+- (BOOL)interpretForVar:(const double *)x
+                    aux:(const double *)a
+                    par:(const double *)p
+                    con:(const double *)c
+                   flag:(const double *)f
+                    res:(double *)r
+               jacXFlag:(const BOOL)jxf
+             varColumns:(const int *)xc
+               varCount:(int)nxc
+                   JacX:(double *)jx
+                   JacA:(double *)ja
+               jacPFlag:(const BOOL)jpf
+             parColumns:(const int *)pc
+               parCount:(int)npc
+                   JacP:(double *)jp
+              workspace:(PXModelWorkspace *)ws;
+
+- (BOOL)evaluateThreadedForVar:(const double *)x
+                           aux:(const double *)a
+                           par:(const double *)p
+                           con:(const double *)c
+                          flag:(const double *)f
+                           res:(double *)r
+                      jacXFlag:(const BOOL)jxf
+                    varColumns:(const int *)xc
+                      varCount:(int)nxc
+                          JacX:(double *)jx
+                          JacA:(double *)ja
+                      jacPFlag:(const BOOL)jpf
+                    parColumns:(const int *)pc
+                      parCount:(int)npc
+                          JacP:(double *)jp
+                     workspace:(PXModelWorkspace *)ws
+                      handlers:(const void *const **)handlers;
+
+- (BOOL)evaluateLanesFrom:(int)p0
+                    count:(int)n
+                   stride:(int)ld
+                   forVar:(const double *)x
+                      aux:(const double *)a
+                      par:(const double *)p
+                      con:(const double *)c
+                     flag:(const double *)f
+                      res:(double *)r
+                 jacXFlag:(const BOOL)jxf
+               varColumns:(const int *)xc
+                 varCount:(int)nxc
+                     JacX:(double *)jx
+                     JacA:(double *)ja
+                 jacPFlag:(const BOOL)jpf
+               parColumns:(const int *)pc
+                 parCount:(int)npc
+                     JacP:(double *)jp
+                   status:(int *)status
+               errorCodes:(int *)ec
+                    stage:(BOOL)stage
+                workspace:(PXModelWorkspace *)ws;
+
+@end
+
+/** number of points handed to a worker at a time in a parallel evaluation */
+#define CHUNK (4 * LANES)
+
+/** lane state of a diverging conditional in a batch */
+typedef struct {
+    unsigned char save[LANES]; /* lane mask before the if */
+    unsigned char cond[LANES]; /* lane outcome of the condition */
+    CODE *jmp;                 /* jump over the else branch, or NULL */
+    CODE *els;                 /* start of the else branch */
+    CODE *end;                 /* end of the conditional */
+    CODE *stop;                /* end of the branch being executed */
+} LANE_FRAME;
+
+/** executed instruction of the function code, for the adjoint sweep */
+typedef struct {
+    CODE *code; /* operator, followed by its operands */
+    double a;   /* first operand */
+    double b;   /* second operand */
+} TAPE;
+
+/** operators in a profile */
+#define PROF_OPR (STOP + 1)
+
+#if defined(__GNUC__)
+/** the compiler supports label addresses: use direct-threaded code */
+#define THREADED_CODE 1
+#endif
+
+/** operators of the threaded register code, by their cells */
+typedef enum {
+    T_END,
+    /* dst a b */
+    T_AND, T_OR, T_LT, T_GT, T_LE, T_GE, T_EQ, T_NE,
+    T_ADD, T_SUB, T_MUL, T_DIV, T_POW,
+    /* dst a */
+    T_NOT, T_NEG, T_REV, T_SQR, T_INC, T_DEC, T_SIN, T_COS, T_TAN, T_ASIN,
+    T_ACOS, T_ATAN, T_SINH, T_COSH, T_TANH, T_ERF, T_EXP, T_LOG, T_LG,
+    T_SQRT, T_ABS, T_SGN, T_MOV,
+    /* dst index */
+    T_FLG,
+    /* dst */
+    T_CLR,
+    /* dst gradient; a dst gradient, src gradient; a dst entry */
+    T_GCLR, T_GADD, T_GSEED,
+    /* a, a b, a target, target, next derivative */
+    T_RET, T_CHKL, T_CHKG, T_IF, T_JMP, T_EOD, T_SOK,
+    /* none */
+    T_SOP, T_SOD,
+    /* segment of the profile */
+    T_SEG,
+    T_NOPR
+} TOPR;
+
+/** operand bases of the register code, following the types of operands */
+#define NUMB (DJAC + 1) /* numerical constants */
+#define REGB (DJAC + 2) /* register file */
+#define SPLB (DJAC + 3) /* spilled registers */
+#define NBASE (DJAC + 4)
+
+/** operand of the register code: base and index in a single cell */
+#define BASE_BITS 4
+#define BASE_MASK ((1 << BASE_BITS) - 1)
+#define REF(base, ind) (((ind) << BASE_BITS) | (base))
+
+/** size of the register file */
+#define NREG 16
+
+/**
+ @brief Linked interpreter code of a model
+
+ @discussion    The program is not modified after initialization and can be
+ shared by any number of threads. Everything that changes during an
+ evaluation lives in a PXModelWorkspace, of which each thread needs its own.
+ */
+@implementation PXModelProgram {
+
+    /** number of residuals */
+    int nRes;
+
+    /** number of variables */
+    int nVar;
+
+    /** number of auxillary variables */
+    int nAux;
+
+    /** number of parameters */
+    int nPar;
+
+    /** number of flags */
+    int nFlg;
+
+    /** number of constants */
+    int nCon;
+
+    /** number of numerical constants */
+    int nNum;
+
+    /** number of temporaries */
+    int nTmp;
+
+    /** length of code stack */
+    int nCode;
+
+    /** maximum depth of the operand stack */
+    int nDepth;
+
+    /** maximum number of values live at once in the register code */
+    int nLive;
+
+    /** distance of the columns of a Jacobian, 0 when sparse */
+    int nStride;
+
+    /** distance of the rows of a Jacobian, 0 when sparse */
+    int nRowStride;
+
+    /** derivatives in reverse mode, by kind (index as kod) */
+    BOOL Reverse[4];
+
+    /** derivatives in vector mode, by kind (index as kod) */
+    BOOL Vector[4];
+
+    /** derivatives per column that are skipped by the flags, by kind */
+    BOOL Flagged[4];
+
+    /** length of a gradient, the most columns of a kind in vector mode */
+    int nVec;
+
+    /** position of the derivative of a residual to a column, while linking
+     * and for the kinds in vector mode
+     *
+     * -1 for a structural zero, by kind of derivatives
+     */
+    int *Position[3];
+
+    /** Start pointer for kinds of deriv.s
+     *
+     * [0]: function code <br>
+     * [1]: variables derivatives <br>
+     * [2]: auxiliaries derivatives <br>
+     * [3]: parameters derivatives <br>
+     */
+    CODE *kindStart[4];
+
+    /** end of the parameter stage, start of the code per point */
+    CODE *pointStart;
+
+    /** start of each derivative, by kind in forward mode (index as kod)
+     *
+     * Column[kod][j] is the first cell of column j, Column[kod][nc] the
+     * cell after the last derivative of the kind, NULL for other kinds
+     */
+    CODE **Column[4];
+
+    /** pointer to numerical constants */
+    double *Num;
+
+    /** direct-threaded register code, NULL if not available */
+    CODE *tStart;
+
+    /** start of parameter derivatives in register code */
+    CODE *tKind3;
+
+    /** end of the parameter stage in register code */
+    CODE *tPoint;
+
+    /** start of each derivative in register code, as Column */
+    CODE **TColumn[4];
+
+    /** profiled copy of the register code, NULL if not available
+     *
+     * a T_SEG opens each segment: a run of instructions of one line and
+     * kind without jumps in or out
+     */
+    CODE *pStart;
+
+    /** as tKind3, tPoint and TColumn, in the profiled register code */
+    CODE *pKind3;
+    CODE *pPoint;
+    CODE **PColumn[4];
+
+    /** segments of the profiled register code
+     *
+     * SegFirst[s] is the first cell of segment s in the linked code,
+     * SegFirst[nSegment] the end, SegKind[s] its kind of derivatives
+     */
+    int *SegFirst;
+    int *SegKind;
+    int nSegment;
+
+    /** pairs of parameters with a residual in common, for the Hessians
+     *
+     * PairCol[PairStart[k]] ... PairCol[PairStart[k + 1] - 1] are the
+     * parameters i <= k of which the derivatives share a row with k
+     */
+    int *PairStart;
+    int *PairCol;
+
+    /** line of the model file of each cell of the linked code, 0 when
+     * unknown, for the profiles */
+    int *Line;
+
+    /** number of lines in the profiles, the last line plus one */
+    int nLine;
+}
+
+/**
+ @brief Initialize with compiled model code, for dense Jacobians
+
+ @param modelCode compiled code
+ */
+- (PXModelProgram *)initWithCode:(PXModelCode *)modelCode {
+
+    return [self initWithCode:modelCode layout:PXJacobianDense];
+}
+
+/**
+ @brief Initialize with compiled model code
+
+ @discussion    With a sparse layout, the Jacobian arguments of an
+ evaluation are arrays with the structural nonzeros of the pattern in
+ PXModelCode, in the order of the layout. The code that clears
+ structurally zero derivatives is left out.
+
+ @param modelCode compiled code
+ @param layout storage of the Jacobians
+ */
+- (PXModelProgram *)initWithCode:(PXModelCode *)modelCode
+                          layout:(PXJacobianLayout)layout {
+
+    self = [super init];
+    if (self) {
+        _layout = layout;
+        nRes = (int)[[modelCode resName] count];
+        nVar = (int)[[modelCode varName] count];
+        nAux = (int)[[modelCode auxName] count];
+        nPar = (int)[[modelCode parName] count];
+        nFlg = (int)[[modelCode flgName] count];
+        nCon = (int)[[modelCode conName] count];
+        nNum = [modelCode getLengthNumbers];
+        nTmp = [modelCode numberOfTemp];
+        nCode = [modelCode getLengthCode];
+
+        if (nNum < 0 || nTmp < 0) {
+            return nil;
+        }
+
+        if (nNum > 0) {
+            Num = (double *)calloc(nNum, sizeof(double));
+            double *inNum = [modelCode getModelNumbers];
+            for (int i = 0; i < nNum; i++) {
+                Num[i] = inNum[i];
+            }
+        } else {
+            Num = NULL;
+        }
+
+        /* linked code: an if takes two cells more, an else one more */
+        CODE *inCode = [modelCode getModelCode];
+        int maxCodeSize = nCode + 1;
+        for (int i = 0; i < nCode; i += pev_length(inCode[i].o)) {
+            if (inCode[i].o == IF) {
+                maxCodeSize += 2;
+            } else if (inCode[i].o == ELSE) {
+                maxCodeSize += 1;
+            }
+        }
+
+        kindStart[0] = (CODE *)calloc(maxCodeSize, sizeof(CODE));
+        Line = (int *)calloc(maxCodeSize, sizeof(int));
+        nLine = 1;
+        for (int m = 0; m < [modelCode getLengthSource]; m++) {
+            if ([modelCode getSourceLines][m] >= nLine) {
+                nLine = [modelCode getSourceLines][m] + 1;
+            }
+        }
+        kindStart[1] = NULL;
+        kindStart[2] = NULL;
+        kindStart[3] = NULL;
+        pointStart = kindStart[0];
+
+        nDepth = [modelCode getStackDepth];
+        if (nDepth < 0) {
+            return nil;
+        }
+        nLive = 0;
+        tStart = NULL;
+        tKind3 = NULL;
+        tPoint = NULL;
+        pStart = NULL;
+        pKind3 = NULL;
+        pPoint = NULL;
+        SegFirst = NULL;
+        SegKind = NULL;
+        nSegment = 0;
+        for (int k = 0; k < 4; k++) {
+            Column[k] = NULL;
+            TColumn[k] = NULL;
+            PColumn[k] = NULL;
+        }
+
+        nStride = (layout == PXJacobianDense) ? nRes : 0;
+        nRowStride = (layout == PXJacobianDense) ? 1 : 0;
+        Reverse[0] = NO;
+        Vector[0] = NO;
+        Flagged[0] = NO;
+        nVec = 0;
+        for (int k = 0; k < 3; k++) {
+            PXDerivativeMode mode = [modelCode getModeForKind:k];
+            int nCol = (k == 0) ? nVar : (k == 1) ? nAux : nPar;
+            Reverse[k + 1] = (mode == PXDerivativeReverse);
+            Vector[k + 1] = (mode == PXDerivativeVector);
+            Flagged[k + 1] = (mode == PXDerivativeForward);
+            if (Vector[k + 1] && nCol > nVec) {
+                nVec = nCol;
+            }
+        }
+        Position[0] = NULL;
+        Position[1] = NULL;
+        Position[2] = NULL;
+        if (layout != PXJacobianDense && ![self positionNonzeros:modelCode]) {
+            return nil;
+        }
+
+        [self pairColumns:modelCode];
+
+        int result = [self referenceCode:modelCode];
+        for (int k = 0; k < 3; k++) {
+            if (!Vector[k + 1]) { /* kept to scatter the gradients */
+                free(Position[k]);
+                Position[k] = NULL;
+            }
+        }
+        if (!result) {
+            return nil;
+        }
+#ifdef THREADED_CODE
+        /* on failure the switched code is used, or no profile is kept */
+        [self threadCode:YES];
+        [self threadCode:NO];
+#endif
+    }
+    return self;
+}
+
+- (void)dealloc {
+
+    free(Num);
+    free(kindStart[0]);
+    free(tStart);
+    free(pStart);
+    for (int k = 0; k < 3; k++) {
+        free(Position[k]);
+    }
+    for (int k = 0; k < 4; k++) {
+        free(Column[k]);
+        free(TColumn[k]);
+        free(PColumn[k]);
+    }
+    free(SegFirst);
+    free(SegKind);
+    free(PairStart);
+    free(PairCol);
+    free(Line);
+}
+
+- (int)numberOfTemp {
+    return nTmp;
+}
+
+- (int)stackDepth {
+    return nDepth;
+}
+
+- (int)liveValues {
+    return nLive;
+}
+
+- (int)gradientSize {
+    return (nTmp + nRes) * nVec;
+}
+
+- (int)numberOfColumns {
+    return nVar + nPar;
+}
+
+/**
+ @brief Size of the tangents in a workspace
+
+ @discussion    Operand stack, temporaries, their derivatives, gradients
+ and residuals, followed by a direction and a Jacobian of the parameters.
+ */
+- (int)tangentSize {
+    return (nDepth + 1) + 2 * nTmp + (nTmp + nRes) * nVec + nRes + nPar +
+           nRes * nPar;
+}
+
+/**
+ @brief Size in bytes of the tape in a workspace
+
+ @discussion    An entry per cell of the code, followed by the adjoints of
+ the operand stack, temporaries, residuals, variables, auxiliaries and
+ parameters.
+ */
+- (size_t)tapeSize {
+    return (nCode + 1) * sizeof(TAPE) +
+           (nDepth + 1 + nTmp + nRes + nVar + nAux + nPar) * sizeof(double);
+}
+
+/**
+ @brief Size of the profile in a workspace
+
+ @discussion    Count and time per segment of the profiled register code,
+ followed by the time of reading the clock.
+ */
+- (int)profileSize {
+    return 2 * nSegment + 1;
+}
+
+/**
+ @brief Size of the inputs of the parameter stage in a workspace
+
+ @discussion    Parameters, constants and flags, as last staged.
+ */
+- (int)stageInputSize {
+    return nPar + nCon + nFlg;
+}
+
+/**
+ @brief Positions of the derivatives in sparse Jacobians
+
+ @param modelCode model code with the Jacobian pattern
+ @return YES/NO for success
+ */
+- (BOOL)positionNonzeros:(PXModelCode *)modelCode {
+
+    int nCol[3] = {nVar, nAux, nPar};
+
+    for (int k = 0; k < 3; k++) {
+        if ([modelCode getColumnsForKind:k] != nCol[k]) {
+            return NO; /* no pattern */
+        }
+        int *pos = (int *)malloc((nRes * nCol[k] + 1) * sizeof(int));
+        for (int i = 0; i < nRes * nCol[k]; i++) {
+            pos[i] = -1;
+        }
+        if (_layout == PXJacobianCSC) {
+            const int *start = [modelCode getColumnStartsForKind:k];
+            const int *row = [modelCode getRowIndicesForKind:k];
+            for (int j = 0; j < nCol[k]; j++) {
+                for (int n = start[j]; n < start[j + 1]; n++) {
+                    pos[j * nRes + row[n]] = n;
+                }
+            }
+        } else {
+            const int *start = [modelCode getRowStartsForKind:k];
+            const int *col = [modelCode getColumnIndicesForKind:k];
+            for (int i = 0; i < nRes; i++) {
+                for (int n = start[i]; n < start[i + 1]; n++) {
+                    pos[col[n] * nRes + i] = n;
+                }
+            }
+        }
+        Position[k] = pos;
+    }
+    return YES;
+}
+
+/**
+ @brief Pairs of parameters of which the second derivatives can be nonzero
+
+ @discussion    A second derivative of a residual to two parameters is
+ structurally zero when the residual does not depend on both. Without a
+ pattern for the parameters all pairs are listed.
+
+ @param modelCode model code with the Jacobian pattern
+ */
+- (void)pairColumns:(PXModelCode *)modelCode {
+
+    BOOL pattern = ([modelCode getColumnsForKind:PXDerivativePar] == nPar);
+    const int *start = [modelCode getColumnStartsForKind:PXDerivativePar];
+    const int *row = [modelCode getRowIndicesForKind:PXDerivativePar];
+    int n = 0;
+
+    PairStart = (int *)calloc(nPar + 1, sizeof(int));
+    PairCol = (int *)calloc(nPar * (nPar + 1) / 2 + 1, sizeof(int));
+    for (int k = 0; k < nPar; k++) {
+        PairStart[k] = n;
+        for (int i = 0; i <= k; i++) {
+            BOOL common = !pattern;
+            if (pattern) { /* merge of the rows, in increasing order */
+                int u = start[i], w = start[k];
+                while (!common && u < start[i + 1] && w < start[k + 1]) {
+                    if (row[u] == row[w]) {
+                        common = YES;
+                    } else if (row[u] < row[w]) {
+                        u++;
+                    } else {
+                        w++;
+                    }
+                }
+            }
+            if (common) {
+                PairCol[n++] = i;
+            }
+        }
+    }
+    PairStart[nPar] = n;
+}
+
+/**
+ @brief Input and adaptation of interpreter code
+
+ @discussion    check array indices <br>
+ replace for conditionals indices by pointers <br>
+ check the maximum depth of the operand stack <br>
+ table the start of each derivative of a kind in forward mode <br>
+ record the line of the model file of each instruction, for the profiles
+
+ @param modelCode model code
+ @return YES/NO for success
+ */
+- (BOOL)referenceCode:(PXModelCode *)modelCode {
+
+    OPR opr = INVAL; /* current operator */
+    TYP typ;         /* type of operand */
+    int ind;         /* index of operand */
+    int iGrd;        /* source of a gradient addition */
+    int kod = 0;     /* kind of derivatives (var, aux or par) */
+    int iCol = 0;    /* column of the derivatives */
+    int zero = -1;   /* numerical constant 0, for sparse Jacobians */
+    int nCol[4] = {0, nVar, nAux, nPar}; /* columns by kind */
+    int depth = 0;   /* depth of the operand stack */
+
+    CODE *IfPos[MAXLEVEL + 1] = {NULL};
+    CODE *ElsePos[MAXLEVEL + 1] = {NULL};
+    int level = 0;
+
+    CODE *inCode = [modelCode getModelCode];
+    CODE *code = kindStart[0];
+
+    for (int i = 0; i < nNum; i++) {
+        if (Num[i] == 0.0 && !signbit(Num[i])) {
+            zero = i;
+        }
+    }
+
+    for (int i = 0; i < nCode; i++) {
+        opr = inCode[i].o;
+        if (opr >= STOP) {
+            break;
+        }
+        Line[code - kindStart[0]] = [modelCode getSourceLineAtOffset:i];
+        switch (opr) {
+        default:
+            (*code++).o = opr;
+            switch (opr) { /* operators that pop an operand */
+            case AND:
+            case OR:
+            case LT:
+            case GT:
+            case LE:
+            case GE:
+            case EQ:
+            case NE:
+            case ADD:
+            case SUB:
+            case MUL:
+            case DIV:
+            case POW:
+                depth--;
+                break;
+            case CHKL:
+            case CHKG:
+                depth -= 2;
+                break;
+            default:
+                break;
+            }
+            break;
+        case DOPD:
+        case OPD:
+        case ASS:
+        case NASS:
+        case CLR:
+            if (opr == OPD || opr == DOPD) {
+                depth++;
+            } else if (opr != CLR) {
+                depth--;
+            }
+            typ = inCode[++i].t;
+            ind = inCode[++i].i;
+            switch (typ) { /* check array index */
+            case VAR:
+                if (ind >= nVar) {
+                    return NO;
+                }
+                break;
+            case AUX:
+                if (ind >= nAux) {
+                    return NO;
+                }
+                break;
+            case PAR:
+                if (ind >= nPar) {
+                    return NO;
+                }
+                break;
+            case CON:
+                if (ind >= nCon) {
+                    return NO;
+                }
+                break;
+            case FLG:
+                if (ind >= nFlg) {
+                    return NO;
+                }
+                break;
+            case RES:
+                if (ind >= nRes) {
+                    return NO;
+                }
+                break;
+            case TMP:
+                if (ind >= nTmp) {
+                    return NO;
+                }
+                break;
+            case DRES:
+                if (ind >= nRes || Reverse[kod] || Vector[kod]) {
+                    return NO;
+                }
+                break;
+            case DTMP:
+                if (ind >= nTmp) {
+                    return NO;
+                }
+                break;
+            case DJAC: /* row iCol of the Jacobian, reverse mode */
+                if (!Reverse[kod] || ind >= nCol[kod] || iCol >= nRes) {
+                    return NO;
+                }
+                break;
+            default:
+                return NO;
+                break;
+            }
+            if (typ == DJAC && _layout == PXJacobianDense) {
+                ind *= nRes;
+            } else if ((typ == DRES || typ == DJAC) &&
+                       _layout != PXJacobianDense) {
+                if (typ == DRES && (kod == 0 || iCol >= nCol[kod])) {
+                    return NO;
+                }
+                ind = (typ == DRES) ? Position[kod - 1][iCol * nRes + ind]
+                                    : Position[kod - 1][ind * nRes + iCol];
+                if (ind < 0) { /* structural zero */
+                    if (opr == CLR) {
+                        break;
+                    }
+                    if (opr != OPD && opr != DOPD) {
+                        return NO;
+                    }
+                    if (zero < 0) {
+                        return NO;
+                    }
+                    (*code++).o = NUM;
+                    (*code++).i = zero;
+                    break;
+                }
+            }
+            (*code++).o = opr;
+            (*code++).t = typ;
+            (*code++).i = ind;
+            break;
+        case GCLR: /* gradient of a temporary or residual, vector mode */
+        case GADD:
+            if (!Vector[kod]) {
+                return NO;
+            }
+            typ = inCode[++i].t;
+            ind = inCode[++i].i;
+            if (typ == DTMP && ind < nTmp) {
+                ind *= nVec;
+            } else if (typ == DRES && ind < nRes) {
+                ind = (nTmp + ind) * nVec;
+            } else {
+                return NO;
+            }
+            if (opr == GCLR) {
+                (*code++).o = GCLR;
+                (*code++).i = ind;
+                break;
+            }
+            depth--;
+            typ = inCode[++i].t;
+            iGrd = inCode[++i].i;
+            if (typ == DTMP && iGrd < nTmp) {
+                (*code++).o = GADD;
+                (*code++).i = ind;
+                (*code++).i = iGrd * nVec;
+            } else if (typ == (TYP)(kod - 1) && iGrd < nCol[kod]) {
+                (*code++).o = GSEED; /* unit gradient of VAR, AUX or PAR */
+                (*code++).i = ind + iGrd;
+            } else {
+                return NO;
+            }
+            break;
+        case NUM:
+        case LDF:
+            depth++;
+            ind = inCode[++i].i;
+            (*code++).o = opr;
+            (*code++).i = ind;
+            break;
+        case IF:
+            depth--;
+            (*code++).o = IF;
+            IfPos[++level] = code; /* else (or end) and end of conditional */
+            code += 2;
+            ElsePos[level] = (CODE *)NULL;
+            break;
+        case ELSE:
+            (*code++).o = JMP;
+            ElsePos[level] = code++;
+            assert(IfPos[level] != NULL);
+            (*IfPos[level]).c = code;
+            break;
+        case FI:
+            if (ElsePos[level]) {
+                (*ElsePos[level]).c = code;
+            } else {
+                assert(IfPos[level] != NULL);
+                (*IfPos[level]).c = code;
+            }
+            (*(IfPos[level] + 1)).c = code;
+            level--;
+            break;
+        case EOD: /* End Of (single) Derivative */
+            if (Column[kod] && iCol >= nCol[kod]) {
+                return NO;
+            }
+            (*code++).o = EOD;
+            iCol++;
+            if (Column[kod]) {
+                Column[kod][iCol] = code;
+            }
+            break;
+        case SOP: /* Start Of Point code, end of the parameter stage */
+            if (kod != 0 || level != 0 || depth != 0) {
+                return NO;
+            }
+            pointStart = code;
+            (*code++).o = SOP;
+            break;
+        case SOD: /* Start Of Derivatives, the shared subexpressions */
+            if (kod != 0 || level != 0 || depth != 0) {
+                return NO;
+            }
+            (*code++).o = SOD;
+            break;
+        case SOK: /* Start Of Kind of derivatives */
+            if (kod >= 3 || (Column[kod] && iCol != nCol[kod])) {
+                return NO;
+            }
+            kindStart[++kod] = code;
+            (*code++).o = SOK;
+            iCol = 0;
+            if (Flagged[kod]) {
+                Column[kod] = (CODE **)calloc(nCol[kod] + 1, sizeof(CODE *));
+                Column[kod][0] = code;
+            }
+            break;
+        }
+        if (depth > nDepth) { /* deeper than the code records */
+            return NO;
+        }
+    }
+
+    if (opr != STOP || (Column[kod] && iCol != nCol[kod])) {
+        return NO;
+    }
+    (*code).o = INVAL;
+
+    return YES;
+}
+
+/** number of cells of an operator in the linked code */
+#define LINKED_LENGTH(opr)                                                     \
+    (((opr) == IF || (opr) == OPD || (opr) == DOPD || (opr) == ASS ||          \
+      (opr) == NASS || (opr) == CLR || (opr) == GADD)                          \
+         ? 3                                                                   \
+     : ((opr) == NUM || (opr) == LDF || (opr) == JMP || (opr) == GCLR ||       \
+        (opr) == GSEED)                                                        \
+         ? 2                                                                   \
+         : 1)
+
+/** operator of the linked code that takes two operands */
+#define BINARY_OPR(opr)                                                        \
+    ((opr) == AND || (opr) == OR || (opr) == LT || (opr) == GT ||              \
+     (opr) == LE || (opr) == GE || (opr) == EQ || (opr) == NE ||               \
+     (opr) == ADD || (opr) == SUB || (opr) == MUL || (opr) == DIV ||           \
+     (opr) == POW)
+
+/**
+ @brief Lowering of the linked code into direct-threaded register code
+
+ @discussion    The operand stack is simulated during the translation, so
+ that every operator becomes a three-address instruction: <br>
+ handler, destination, operands. <br>
+ Variables, parameters, temporaries and numerical constants are addressed
+ where they are stored, and are not pushed. An intermediate value gets a
+ register, or a spill slot in the operand stack of the workspace when all
+ NREG registers are live. Registers are assigned by a linear scan over the
+ live ranges of the values. <br>
+ A value that is stored right after it is computed is written directly to
+ its destination. <br>
+ The start of each derivative of a kind in forward mode is tabled as in
+ the linked code, so that the evaluation jumps from one requested column to
+ the next. Kinds in reverse or vector mode are never skipped. <br>
+ The compiler leaves the operand stack empty at every statement, and
+ therefore at every jump. Code that does not, is not translated. <br>
+ The profiled copy opens each segment with a T_SEG, which counts and times
+ it: a segment starts at a new line or kind, at a jump target and after a
+ jump, where the operand stack is empty. It is kept apart from the register
+ code, which therefore runs unchanged when not profiling.
+
+ @param profiled translate into the profiled copy
+ @return YES/NO for success
+ */
+- (BOOL)threadCode:(BOOL)profiled {
+
+    const void *const *Handler = NULL;
+    TOPR Simple[STOP + 1]; /* threaded operator of single operators */
+    CODE *lc = kindStart[0];
+    OPR opr;
+    int nLinked, nMark, nPatch, nVal, depth;
+    int k, t, v, u, w;
+    int last;  /* start of the last instruction, if it may be rewritten */
+    int kod;   /* kind of derivatives */
+    int first[4] = {0}; /* first mark of a kind */
+    BOOL cut = YES;     /* the last operator ends a segment */
+    BOOL ok = YES;
+
+    [self evaluateThreadedForVar:NULL
+                             aux:NULL
+                             par:NULL
+                             con:NULL
+                            flag:NULL
+                             res:NULL
+                        jacXFlag:NO
+                      varColumns:NULL
+                        varCount:0
+                            JacX:NULL
+                            JacA:NULL
+                        jacPFlag:NO
+                      parColumns:NULL
+                        parCount:0
+                            JacP:NULL
+                       workspace:nil
+                        handlers:&Handler];
+
+    for (k = 0; k <= STOP; k++) {
+        Simple[k] = T_NOPR;
+    }
+    Simple[AND] = T_AND;
+    Simple[OR] = T_OR;
+    Simple[NOT] = T_NOT;
+    Simple[LT] = T_LT;
+    Simple[GT] = T_GT;
+    Simple[LE] = T_LE;
+    Simple[GE] = T_GE;
+    Simple[EQ] = T_EQ;
+    Simple[NE] = T_NE;
+    Simple[NEG] = T_NEG;
+    Simple[ADD] = T_ADD;
+    Simple[SUB] = T_SUB;
+    Simple[MUL] = T_MUL;
+    Simple[DIV] = T_DIV;
+    Simple[POW] = T_POW;
+    Simple[REV] = T_REV;
+    Simple[SQR] = T_SQR;
+    Simple[INC] = T_INC;
+    Simple[DEC] = T_DEC;
+    Simple[SIN] = T_SIN;
+    Simple[COS] = T_COS;
+    Simple[TAN] = T_TAN;
+    Simple[ASIN] = T_ASIN;
+    Simple[ACOS] = T_ACOS;
+    Simple[ATAN] = T_ATAN;
+    Simple[SINH] = T_SINH;
+    Simple[COSH] = T_COSH;
+    Simple[TANH] = T_TANH;
+    Simple[ERF] = T_ERF;
+    Simple[EXP] = T_EXP;
+    Simple[LOG] = T_LOG;
+    Simple[LG] = T_LG;
+    Simple[SQRT] = T_SQRT;
+    Simple[ABS] = T_ABS;
+    Simple[SGN] = T_SGN;
+
+    /* 1st pass - length of the linked code and the jump targets */
+    nMark = 0;
+    for (k = 0; lc[k].o != INVAL; k += LINKED_LENGTH(lc[k].o)) {
+        if (lc[k].o == EOD || lc[k].o == SOK) {
+            nMark++;
+        }
+    }
+    nLinked = k + 1;
+
+    unsigned char *target = (unsigned char *)calloc(nLinked, 1);
+    int *map = (int *)calloc(nLinked, sizeof(int));
+    int *patch = (int *)calloc(nLinked, sizeof(int));
+    int *mark = (int *)calloc(nMark + 1, sizeof(int));
+    int *opnd = (int *)calloc(nDepth + 1, sizeof(int)); /* operand stack */
+    int *from = (int *)calloc(nLinked, sizeof(int)); /* live range of value */
+    int *to = (int *)calloc(nLinked, sizeof(int));
+    int *def = (int *)calloc(nLinked, sizeof(int)); /* cell of definition */
+    int *use = (int *)calloc(nLinked, sizeof(int)); /* cell of use */
+    int *loc = (int *)calloc(nLinked, sizeof(int)); /* register or slot */
+    tStart = (CODE *)calloc((profiled ? 6 : 4) * nLinked, sizeof(CODE));
+    tPoint = tStart;
+    if (profiled) {
+        SegFirst = (int *)calloc(nLinked + 1, sizeof(int));
+        SegKind = (int *)calloc(nLinked, sizeof(int));
+        nSegment = 0;
+    }
+
+    for (k = 0; lc[k].o != INVAL; k += LINKED_LENGTH(lc[k].o)) {
+        if (lc[k].o == IF) {
+            target[lc[k + 1].c - lc] = 1;
+            target[lc[k + 2].c - lc] = 1;
+        } else if (lc[k].o == JMP) {
+            target[lc[k + 1].c - lc] = 1;
+        }
+    }
+
+/* start of an instruction */
+#define EMIT(topr)                                                             \
+    last = t;                                                                  \
+    tStart[t++].h = Handler[topr]
+
+/* new value as destination */
+#define DEFINE()                                                               \
+    from[nVal] = last;                                                         \
+    to[nVal] = last;                                                           \
+    def[nVal] = t;                                                             \
+    use[nVal] = -1;                                                            \
+    opnd[depth++] = REF(REGB, nVal);                                           \
+    tStart[t++].i = REF(REGB, nVal++)
+
+/* operand, the end of the live range of a value */
+#define USE(ref)                                                               \
+    if (((ref) & BASE_MASK) == REGB) {                                         \
+        to[(ref) >> BASE_BITS] = last;                                         \
+        use[(ref) >> BASE_BITS] = t;                                           \
+    }                                                                          \
+    tStart[t++].i = (ref)
+
+/* the value was computed by the last instruction */
+#define IS_LAST(ref)                                                           \
+    (last >= 0 && ((ref) & BASE_MASK) == REGB &&                               \
+     def[(ref) >> BASE_BITS] == last + 1)
+
+    /* 2nd pass - translation with values numbered in order */
+    t = 0;
+    nPatch = 0;
+    nMark = 0;
+    nVal = 0;
+    depth = 0;
+    last = -1;
+    kod = 0;
+    for (k = 0;;) {
+        map[k] = t;
+        opr = lc[k].o;
+        if (target[k]) {
+            if (depth != 0) {
+                ok = NO;
+                break;
+            }
+            last = -1;
+        }
+
+        if (opr == INVAL) {
+            EMIT(T_END);
+            break;
+        }
+
+        if (profiled && depth == 0 &&
+            (cut || target[k] || opr == SOK || opr == SOP ||
+             Line[k] != Line[SegFirst[nSegment - 1]])) {
+            SegFirst[nSegment] = k;
+            SegKind[nSegment] = kod;
+            EMIT(T_SEG);
+            tStart[t++].i = nSegment++;
+            last = -1;
+        }
+
+        switch (opr) {
+        default:
+            if (Simple[opr] == T_NOPR) {
+                ok = NO;
+                break;
+            }
+            if (!BINARY_OPR(opr)) {
+                v = opnd[--depth];
+                EMIT(Simple[opr]);
+                DEFINE();
+                USE(v);
+                break;
+            }
+            w = opnd[--depth];
+            v = opnd[--depth];
+            EMIT(Simple[opr]);
+            DEFINE();
+            USE(v);
+            USE(w);
+            break;
+        case OPD:
+        case DOPD:
+            if (lc[k + 1].t == FLG) {
+                EMIT(T_FLG);
+                DEFINE();
+                tStart[t++].i = lc[k + 2].i;
+            } else {
+                opnd[depth++] = REF(lc[k + 1].t, lc[k + 2].i);
+            }
+            break;
+        case NUM:
+            opnd[depth++] = REF(NUMB, lc[k + 1].i);
+            break;
+        case LDF:
+            EMIT(T_FLG);
+            DEFINE();
+            tStart[t++].i = lc[k + 1].i;
+            break;
+        case ASS:
+        case NASS:
+            if (depth != 1) {
+                ok = NO;
+                break;
+            }
+            v = opnd[--depth];
+            if (opr == ASS && IS_LAST(v)) { /* compute in place */
+                from[v >> BASE_BITS] = -1;
+                tStart[last + 1].i = REF(lc[k + 1].t, lc[k + 2].i);
+            } else {
+                EMIT((opr == ASS) ? T_MOV : T_NEG);
+                tStart[t++].i = REF(lc[k + 1].t, lc[k + 2].i);
+                USE(v);
+            }
+            last = -1;
+            break;
+        case CLR:
+            EMIT(T_CLR);
+            tStart[t++].i = REF(lc[k + 1].t, lc[k + 2].i);
+            last = -1;
+            break;
+        case GCLR:
+            EMIT(T_GCLR);
+            tStart[t++].i = lc[k + 1].i;
+            last = -1;
+            break;
+        case GADD:
+        case GSEED:
+            v = opnd[--depth];
+            EMIT((opr == GADD) ? T_GADD : T_GSEED);
+            USE(v);
+            tStart[t++].i = lc[k + 1].i;
+            if (opr == GADD) {
+                tStart[t++].i = lc[k + 2].i;
+            }
+            last = -1;
+            break;
+        case RET:
+            v = opnd[--depth];
+            EMIT(T_RET);
+            USE(v);
+            break;
+        case CHKL:
+        case CHKG:
+            w = opnd[--depth];
+            v = opnd[--depth];
+            EMIT((opr == CHKL) ? T_CHKL : T_CHKG);
+            USE(v);
+            USE(w);
+            last = -1;
+            break;
+        case IF:
+            v = opnd[--depth];
+            EMIT(T_IF);
+            USE(v);
+            patch[nPatch++] = t;
+            tStart[t++].i = (int)(lc[k + 1].c - lc);
+            last = -1;
+            break;
+        case JMP:
+            EMIT(T_JMP);
+            patch[nPatch++] = t;
+            tStart[t++].i = (int)(lc[k + 1].c - lc);
+            last = -1;
+            break;
+        case SOP:
+            if (depth != 0) {
+                ok = NO;
+                break;
+            }
+            tPoint = tStart + map[k];
+            EMIT(T_SOP);
+            last = -1;
+            break;
+        case SOD:
+            if (depth != 0) {
+                ok = NO;
+                break;
+            }
+            EMIT(T_SOD);
+            last = -1;
+            break;
+        case EOD:
+        case SOK:
+            if (depth != 0) {
+                ok = NO;
+                break;
+            }
+            if (opr == SOK && lc + k == kindStart[3]) {
+                tKind3 = tStart + map[k];
+            }
+            if (opr == SOK) {
+                kod++;
+                first[kod] = nMark;
+            }
+            if (Column[kod]) { /* only forward mode is skipped */
+                mark[nMark++] = t;
+            }
+            EMIT((opr == EOD) ? T_EOD : T_SOK);
+            last = -1;
+            break;
+        }
+        if (!ok) {
+            break;
+        }
+        cut = (opr == IF || opr == JMP || opr == EOD || opr == SOK);
+        k += LINKED_LENGTH(opr);
+    }
+    if (profiled) {
+        SegFirst[nSegment] = k;
+    }
+
+#undef EMIT
+#undef DEFINE
+#undef USE
+#undef IS_LAST
+
+    /* 3rd pass - linear scan allocation of registers and spill slots */
+    if (ok) {
+        int holder[NREG];  /* value in a register, or -1 */
+        int *spill = opnd; /* value in a spill slot, or -1 */
+        int nSpill = 0;
+        int live, r, s;
+
+        for (r = 0; r < NREG; r++) {
+            holder[r] = -1;
+        }
+        for (v = 0; v < nVal; v++) {
+            if (from[v] < 0) {
+                continue; /* value was folded away */
+            }
+            live = 1;
+            for (r = 0; r < NREG; r++) { /* expire ended ranges */
+                if (holder[r] >= 0 && to[holder[r]] <= from[v]) {
+                    holder[r] = -1;
+                }
+                live += (holder[r] >= 0);
+            }
+            for (s = 0; s < nSpill; s++) {
+                if (spill[s] >= 0 && to[spill[s]] <= from[v]) {
+                    spill[s] = -1;
+                }
+                live += (spill[s] >= 0);
+            }
+            if (live > nLive) {
+                nLive = live;
+            }
+
+            for (r = 0; r < NREG && holder[r] >= 0; r++)
+                ;
+            u = -1; /* value that goes to a spill slot */
+            if (r < NREG) {
+                holder[r] = v;
+                loc[v] = REF(REGB, r);
+            } else { /* spill the range that ends last */
+                int rMax = 0;
+                for (r = 1; r < NREG; r++) {
+                    if (to[holder[r]] > to[holder[rMax]]) {
+                        rMax = r;
+                    }
+                }
+                u = v;
+                if (to[holder[rMax]] > to[v]) {
+                    u = holder[rMax];
+                    holder[rMax] = v;
+                    loc[v] = REF(REGB, rMax);
+                }
+            }
+            if (u >= 0) {
+                for (s = 0; s < nSpill && spill[s] >= 0; s++)
+                    ;
+                if (s > nDepth) {
+                    ok = NO;
+                    break;
+                }
+                if (s == nSpill) {
+                    nSpill++;
+                }
+                spill[s] = u;
+                loc[u] = REF(SPLB, s);
+            }
+        }
+    }
+
+    if (ok) {
+        /* values */
+        for (v = 0; v < nVal; v++) {
+            if (from[v] >= 0) {
+                tStart[def[v]].i = loc[v];
+                if (use[v] >= 0) {
+                    tStart[use[v]].i = loc[v];
+                }
+            }
+        }
+
+        /* jump targets */
+        for (k = 0; k < nPatch; k++) {
+            tStart[patch[k]].c = tStart + map[tStart[patch[k]].i];
+        }
+
+        /* start of each derivative, after its SOK or the preceding EOD */
+        for (kod = 1; kod <= 3; kod++) {
+            if (Column[kod]) {
+                int nc = (kod == 1) ? nVar : (kod == 2) ? nAux : nPar;
+                TColumn[kod] = (CODE **)calloc(nc + 1, sizeof(CODE *));
+                for (k = 0; k <= nc; k++) {
+                    TColumn[kod][k] = tStart + mark[first[kod] + k] + 1;
+                }
+            }
+        }
+    } else {
+        free(tStart);
+        tStart = NULL;
+        tKind3 = NULL;
+        tPoint = NULL;
+        nLive = 0;
+        if (profiled) {
+            free(SegFirst);
+            free(SegKind);
+            SegFirst = NULL;
+            SegKind = NULL;
+            nSegment = 0;
+        }
+    }
+
+    if (ok && profiled) { /* kept as the profiled copy */
+        pStart = tStart;
+        pKind3 = tKind3;
+        pPoint = tPoint;
+        for (kod = 0; kod < 4; kod++) {
+            PColumn[kod] = TColumn[kod];
+            TColumn[kod] = NULL;
+        }
+        tStart = NULL;
+        tKind3 = NULL;
+        tPoint = NULL;
+    }
+
+    free(target);
+    free(map);
+    free(patch);
+    free(mark);
+    free(opnd);
+    free(from);
+    free(to);
+    free(def);
+    free(use);
+    free(loc);
+
+    return ok;
+}
+
+/**
+ @brief Copy the gradients of the residuals into a Jacobian
+
+ @discussion    At the end of a kind in vector mode, the gradient of a
+ residual holds its row of the Jacobian. Each entry is w values apart in
+ the gradients, and n values are copied to ld values apart in the Jacobian.
+
+ @param g gradients of the temporaries and residuals
+ @param w values per gradient entry, 1 or LANES
+ @param kod kind of derivatives
+ @param jac Jacobian of the kind
+ @param ld values per entry of the Jacobian
+ @param n number of values copied per entry
+ */
+- (void)scatterGradients:(const double *)g
+                   width:(int)w
+                    kind:(int)kod
+                    into:(double *)jac
+                  stride:(int)ld
+                   count:(int)n {
+
+    int nCol = (kod == 1) ? nVar : (kod == 2) ? nAux : nPar;
+    const int *pos = Position[kod - 1];
+    const double *src;
+    int ind;
+
+    for (int i = 0; i < nRes; i++) {
+        src = g + (nTmp + i) * nVec * w;
+        for (int j = 0; j < nCol; j++) {
+            ind = pos ? pos[j * nRes + i] : j * nStride + i;
+            if (ind >= 0) { /* not a structural zero */
+                vec_copy(jac + ind * ld, src + j * w, n);
+            }
+        }
+    }
+}
+
+/**
+ @brief Execution of the parameter stage
+
+ @discussion    The parameter stage computes the values that only depend on
+ the parameters, constants and flags into temporaries of the workspace. The
+ workspace is then staged: the next evaluations skip the stage and use these
+ values. The workspace keeps a copy of the parameters, constants and flags
+ of the stage; an evaluation with other values evaluates the stage again,
+ so that the values of the stage are never stale.
+
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)evaluateStageForPar:(const double *)p
+                        con:(const double *)c
+                       flag:(const double *)f
+                  workspace:(PXModelWorkspace *)ws {
+
+    ws.staged = NO;
+    if (pointStart != kindStart[0] &&
+        ![self evaluateForVar:NULL
+                          aux:NULL
+                          par:p
+                          con:c
+                         flag:f
+                          res:NULL
+                     jacXFlag:NO
+                     varFlags:NULL
+                         JacX:NULL
+                         JacA:NULL
+                     jacPFlag:NO
+                     parFlags:NULL
+                         JacP:NULL
+                    workspace:ws]) {
+        return NO;
+    }
+    double *in = [ws stageInputs];
+    memcpy(in, p, nPar * sizeof(double));
+    memcpy(in + nPar, c, nCon * sizeof(double));
+    memcpy(in + nPar + nCon, f, nFlg * sizeof(double));
+    ws.staged = YES;
+    return YES;
+}
+
+/**
+ @brief Check whether the parameter stage of a workspace was evaluated for
+ the given parameters, constants and flags
+
+ @discussion    The values are compared bit for bit.
+
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param ws staged workspace
+ @return YES when the stage holds, NO when it must be evaluated again
+ */
+- (BOOL)isStagedForPar:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+             workspace:(PXModelWorkspace *)ws {
+
+    const double *in = [ws stageInputs];
+
+    return (memcmp(in, p, nPar * sizeof(double)) == 0 &&
+            memcmp(in + nPar, c, nCon * sizeof(double)) == 0 &&
+            memcmp(in + nPar + nCon, f, nFlg * sizeof(double)) == 0)
+               ? YES
+               : NO;
+}
+
+/**
+ @brief List of the flagged columns of a kind
+
+ @param flags flag per column, NULL for all columns
+ @param n number of columns
+ @param cols flagged columns in increasing order, output
+ @param count number of listed columns, output
+ @return list of the columns, NULL for all columns
+ */
+static const int *flaggedColumns(const BOOL *flags, int n, int *cols,
+                                 int *count) {
+    if (!flags) {
+        *count = n;
+        return NULL;
+    }
+    *count = 0;
+    for (int j = 0; j < n; j++) {
+        if (flags[j]) {
+            cols[(*count)++] = j;
+        }
+    }
+    return cols;
+}
+
+/**
+ @brief Check a list of columns of a kind
+
+ @param cols list of columns, NULL for all columns
+ @param count length of the list
+ @param n number of columns
+ @return YES/NO for all columns in range
+ */
+static BOOL validColumns(const int *cols, int count, int n) {
+    if (!cols) {
+        return YES;
+    }
+    if (count < 0) {
+        return NO;
+    }
+    for (int q = 0; q < count; q++) {
+        if (cols[q] < 0 || cols[q] >= n) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+/**
+ @brief Clock of the profiles
+
+ @return time in seconds
+ */
+static double profileClock(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+/**
+ @brief Time of reading the clock of the profiles, which the time of each
+ profiled segment includes
+
+ @return mean time of a reading, in seconds, not zero
+ */
+static double profileClockTime(void) {
+    double t0 = profileClock(), t = t0;
+
+    for (int k = 0; k < 1000; k++) {
+        t = profileClock();
+    }
+    return fmax((t - t0) / 1000, DBL_MIN);
+}
+
+/**
+ @brief Execution of interpreter code
+
+ @discussion    A kind of derivatives generated in reverse or vector mode is
+ computed for all its columns; the flags per variable or parameter are
+ ignored. With a staged workspace the parameter stage is skipped. <br>
+ The flags are turned into lists of columns, kept in the workspace.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xf flags per variable
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pf flags per parameter
+ @param jp Jacobian for parameters
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)evaluateForVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(const BOOL *)xf
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(const BOOL *)pf
+                  JacP:(double *)jp
+             workspace:(PXModelWorkspace *)ws {
+
+    int nxc, npc;
+    int *cols = [ws columns];
+    const int *xc = flaggedColumns(xf, nVar, cols, &nxc);
+    const int *pc = flaggedColumns(pf, nPar, cols + nVar, &npc);
+
+    return [self evaluateForVar:x
+                            aux:a
+                            par:p
+                            con:c
+                           flag:f
+                            res:r
+                       jacXFlag:jxf
+                     varColumns:xc
+                       varCount:nxc
+                           JacX:jx
+                           JacA:ja
+                       jacPFlag:jpf
+                     parColumns:pc
+                       parCount:npc
+                           JacP:jp
+                      workspace:ws];
+}
+
+/**
+ @brief Execution of interpreter code, for lists of columns
+
+ @discussion    Only the derivatives to the listed variables and parameters
+ are computed, in the order of the lists; the other columns of the
+ Jacobians are left as they are. The evaluation jumps from one listed column
+ to the next, so that its cost does not depend on the columns that are left
+ out. A kind of derivatives generated in reverse or vector mode is computed
+ for all its columns; the lists are ignored. With a staged workspace the
+ parameter stage is skipped, unless the parameters, constants or flags
+ differ from those of the stage, which is then evaluated again. <br>
+ While the workspace is profiling, the profiled copy of the register code
+ is run, which counts and times each segment in the profile.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xc list of variables, NULL for all variables
+ @param nxc length of the list of variables
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pc list of parameters, NULL for all parameters
+ @param npc length of the list of parameters
+ @param jp Jacobian for parameters
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)evaluateForVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+            varColumns:(const int *)xc
+              varCount:(int)nxc
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+            parColumns:(const int *)pc
+              parCount:(int)npc
+                  JacP:(double *)jp
+             workspace:(PXModelWorkspace *)ws {
+
+    if ((jxf && !validColumns(xc, nxc, nVar)) ||
+        (jpf && !validColumns(pc, npc, nPar))) {
+        ws.errorCode = -1;
+        return NO;
+    }
+    if (ws.staged && ![self isStagedForPar:p con:c flag:f workspace:ws] &&
+        ![self evaluateStageForPar:p con:c flag:f workspace:ws]) {
+        return NO;
+    }
+#ifdef THREADED_CODE
+    if (tStart) {
+        return [self evaluateThreadedForVar:x
+                                        aux:a
+                                        par:p
+                                        con:c
+                                       flag:f
+                                        res:r
+                                   jacXFlag:jxf
+                                 varColumns:xc
+                                   varCount:nxc
+                                       JacX:jx
+                                       JacA:ja
+                                   jacPFlag:jpf
+                                 parColumns:pc
+                                   parCount:npc
+                                       JacP:jp
+                                  workspace:ws
+                                   handlers:NULL];
+    }
+#endif
+    return [self interpretForVar:x
+                             aux:a
+                             par:p
+                             con:c
+                            flag:f
+                             res:r
+                        jacXFlag:jxf
+                      varColumns:xc
+                        varCount:nxc
+                            JacX:jx
+                            JacA:ja
+                        jacPFlag:jpf
+                      parColumns:pc
+                        parCount:npc
+                            JacP:jp
+                       workspace:ws];
+}
+
+/**
+ @brief Execution of interpreter code, switched dispatch
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xc list of variables, NULL for all variables
+ @param nxc length of the list of variables
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pc list of parameters, NULL for all parameters
+ @param npc length of the list of parameters
+ @param jp Jacobian for parameters
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)interpretForVar:(const double *)x
+                    aux:(const double *)a
+                    par:(const double *)p
+                    con:(const double *)c
+                   flag:(const double *)f
+                    res:(double *)r
+               jacXFlag:(const BOOL)jxf
+             varColumns:(const int *)xc
+               varCount:(int)nxc
+                   JacX:(double *)jx
+                   JacA:(double *)ja
+               jacPFlag:(const BOOL)jpf
+             parColumns:(const int *)pc
+               parCount:(int)npc
+                   JacP:(double *)jp
+              workspace:(PXModelWorkspace *)ws {
+    /** interpreter code pointer */
+    CODE *code = ws.staged ? pointStart : kindStart[0];
+
+    /** operand stack pointer */
+    double *pSt = [ws stack];
+
+    double *Tmp = [ws tmp];       /* temporaries      */
+    double *DTmp = [ws dTmp];     /* deriv. of temps. */
+    double *Grad = [ws gradient]; /* gradients        */
+
+    int kod = 0;      /* kind of derivatives              */
+    int iDvt = 0;     /* index of current deriv. variable */
+    double *jac = jx; /* pointer to current Jacobian      */
+    int nc = 0;       /* columns of the current kind      */
+    const int *sel = NULL; /* listed columns of the kind, or NULL */
+    int nSel = 0;     /* number of listed columns         */
+    int q = 0;        /* position in the list             */
+
+    OPR opr;    /* operator                         */
+    TYP typ;    /* type of operand                  */
+    int ind;    /* operand index                    */
+    double val; /* operand value                    */
+
+    ws.errorCode = 0;
+
+    for (;;) {
+        opr = (*code++).o;
+        switch (opr) {
+        default:
+            ws.errorCode = -1;
+            return NO; /* error */
+        case INVAL:
+            return YES; /* finished */
+        case AND:
+            pSt--;
+            *pSt = (*pSt != 0 && *(pSt + 1) != 0) ? 1 : 0;
+            break;
+        case OR:
+            pSt--;
+            *pSt = (*pSt != 0 || *(pSt + 1) != 0) ? 1 : 0;
+            break;
+        case NOT:
+            *pSt = (*pSt == 0) ? 1 : 0;
+            break;
+        case LT:
+            pSt--;
+            *pSt = (*pSt < *(pSt + 1)) ? 1 : 0;
+            break;
+        case GT:
+            pSt--;
+            *pSt = (*pSt > *(pSt + 1)) ? 1 : 0;
+            break;
+        case LE:
+            pSt--;
+            *pSt = (*pSt <= *(pSt + 1)) ? 1 : 0;
+            break;
+        case GE:
+            pSt--;
+            *pSt = (*pSt >= *(pSt + 1)) ? 1 : 0;
+            break;
+        case EQ:
+            pSt--;
+            *pSt = (*pSt == *(pSt + 1)) ? 1 : 0;
+            break;
+        case NE:
+            pSt--;
+            *pSt = (*pSt != *(pSt + 1)) ? 1 : 0;
+            break;
+        case ADD:
+            pSt--;
+            *pSt = *pSt + *(pSt + 1);
+            break;
+        case SUB:
+            pSt--;
+            *pSt = *pSt - *(pSt + 1);
+            break;
+        case MUL:
+            pSt--;
+            *pSt = *pSt * *(pSt + 1);
+            break;
+        case DIV:
+            pSt--;
+            *pSt = *pSt / *(pSt + 1);
+            break;
+        case POW:
+            pSt--;
+            *pSt = pow(*pSt, *(pSt + 1));
+            break;
+        case SGN:
+            *pSt = (*pSt >= 0) ? 1 : -1;
+            break;
+        case SIN:
+            *pSt = sin(*pSt);
+            break;
+        case COS:
+            *pSt = cos(*pSt);
+            break;
+        case TAN:
+            *pSt = tan(*pSt);
+            break;
+        case ASIN:
+            *pSt = asin(*pSt);
+            break;
+        case ACOS:
+            *pSt = acos(*pSt);
+            break;
+        case ATAN:
+            *pSt = atan(*pSt);
+            break;
+        case SINH:
+            *pSt = sinh(*pSt);
+            break;
+        case COSH:
+            *pSt = cosh(*pSt);
+            break;
+        case TANH:
+            *pSt = tanh(*pSt);
+            break;
+        case ERF:
+            *pSt = erf(*pSt);
+            break;
+        case EXP:
+            *pSt = exp(*pSt);
+            break;
+        case LOG:
+            *pSt = log(*pSt);
+            break;
+        case LG:
+            *pSt = log10(*pSt);
+            break;
+        case SQRT:
+            *pSt = sqrt(*pSt);
+            break;
+        case SQR:
+            *pSt = *pSt * *pSt;
+            break;
+        case NEG:
+            *pSt = -*pSt;
+            break;
+        case REV:
+            *pSt = 1.0 / *pSt;
+            break;
+        case INC:
+            *pSt += 1;
+            break;
+        case DEC:
+            *pSt -= 1;
+            break;
+        case ABS:
+            if (*pSt < 0) {
+                *pSt = -*pSt;
+            }
+            break;
+        case RET:
+            ws.errorCode = *pSt;
+            // return (*pSt == 0) ? YES : NO;
+            return NO;
+            break;
+        case CHKL:
+            pSt--;
+            if (*pSt < *(pSt + 1)) {
+                return NO;
+            }
+            pSt--;
+            break;
+        case CHKG:
+            pSt--;
+            if (*pSt > *(pSt + 1)) {
+                return NO;
+            }
+            pSt--;
+            break;
+        case DOPD:
+        case OPD:
+            typ = (*code++).t;
+            ind = (*code++).i;
+
+            switch (typ) {
+            case VAR:
+                val = x[ind];
+                break;
+            case AUX:
+                val = a[ind];
+                break;
+            case PAR:
+                val = p[ind];
+                break;
+            case CON:
+                val = c[ind];
+                break;
+            case FLG:
+                val = f[ind] > 0.5 ? 1 : 0;
+                break;
+            case RES:
+                val = r[ind];
+                break;
+            case TMP:
+                val = Tmp[ind];
+                break;
+            case DRES:
+                val = jac[iDvt * nStride + ind];
+                break;
+            case DJAC:
+                val = jac[iDvt * nRowStride + ind];
+                break;
+            case DTMP:
+                val = DTmp[ind];
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            *(++pSt) = val;
+            break;
+        case NUM:
+            ind = (*code++).i;
+            *(++pSt) = Num[ind];
+            break;
+        case LDF:
+            ind = (*code++).i;
+            *(++pSt) = f[ind] > 0.5 ? 1 : 0;
+            break;
+        case ASS:
+        case NASS:
+        case CLR:
+            typ = (*code++).t;
+            ind = (*code++).i;
+            if (opr == ASS) {
+                val = *(pSt--);
+            } else if (opr == NASS) {
+                val = -(*(pSt--));
+            } else {
+                val = 0.0;
+            }
+            switch (typ) {
+
+            case RES:
+                r[ind] = val;
+                break;
+            case TMP:
+                Tmp[ind] = val;
+                break;
+            case DRES:
+                jac[iDvt * nStride + ind] = val;
+                break;
+            case DJAC:
+                jac[iDvt * nRowStride + ind] = val;
+                break;
+            case DTMP:
+                DTmp[ind] = val;
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            break;
+        case GCLR:
+            ind = (*code++).i;
+            vec_set(Grad + ind, 0.0, nc);
+            break;
+        case GADD:
+            ind = (*code++).i;
+            vec_axpy(Grad + ind, *(pSt--), Grad + (*code++).i, nc);
+            break;
+        case GSEED:
+            ind = (*code++).i;
+            Grad[ind] = Grad[ind] + *(pSt--);
+            break;
+        case IF:
+            if (*(pSt--) == 0) {
+                code = (*code).c;
+            } else {
+                code += 2;
+            }
+            break;
+        case EOD:
+            if (Vector[kod]) {
+                [self scatterGradients:Grad
+                                 width:1
+                                  kind:kod
+                                  into:jac
+                                stride:1
+                                 count:1];
+            }
+            if (sel) {
+                q++; /* next listed column */
+                iDvt = (q < nSel) ? sel[q] : nc;
+                code = Column[kod][iDvt];
+            } else {
+                iDvt++;
+            }
+            break;
+        case SOK:
+            kod++;
+            iDvt = 0;
+            jac = (kod == 1) ? jx : (kod == 2) ? ja : jp;
+            nc = (kod == 1) ? nVar : (kod == 2) ? nAux : nPar;
+            if (kod == 1 && jxf == NO) {
+                code = kindStart[3]; /* skip straight to parameter
+                                        derivatives */
+                kod++;
+                break;
+            }
+            if (kod == 3 && jpf == NO) {
+                return YES;
+            }
+            sel = NULL;
+            if (Column[kod] && kod != 2) { /* only forward mode is skipped */
+                sel = (kod == 1) ? xc : pc;
+                nSel = (kod == 1) ? nxc : npc;
+            }
+            if (sel) {
+                q = 0; /* first listed column */
+                iDvt = (nSel > 0) ? sel[0] : nc;
+                code = Column[kod][iDvt];
+            }
+            break;
+        case SOP:
+            if (!x) {
+                return YES; /* parameter stage only */
+            }
+            break;
+        case SOD:
+            if (jxf == NO && jpf == NO) {
+                return YES; /* residuals only */
+            }
+            break;
+        case JMP:
+            code = (*code).c;
+            break;
+        }
+    }
+    return YES;
+}
+
+/**
+ @brief Execution of interpreter code with tangents
+
+ @discussion    Each value carries its tangent, its derivative in a direction
+ of the variables, auxiliaries and parameters. The tangents of the residuals
+ are the product of the Jacobians and the direction. The derivative code is
+ differentiated as it is evaluated: the tangents of the Jacobian for the
+ parameters are the products of the Hessians of the residuals and the
+ direction. The derivatives to the variables and the auxiliaries are not
+ evaluated, and the parameter stage is always evaluated, for its tangents.
+ The linked code is used.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param dx direction of the variables, NULL for zero
+ @param da direction of the auxiliary variables, NULL for zero
+ @param dp direction of the parameters, NULL for zero
+ @param r residuals
+ @param dr tangents of the residuals, NULL if not needed
+ @param jpf flag evaluate Jacobian for parameters
+ @param pc list of parameters, NULL for all parameters
+ @param npc length of the list of parameters
+ @param jp Jacobian for parameters
+ @param djp tangents of the Jacobian for parameters
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)tangentForVar:(const double *)x
+                  aux:(const double *)a
+                  par:(const double *)p
+                  con:(const double *)c
+                 flag:(const double *)f
+               varDir:(const double *)dx
+               auxDir:(const double *)da
+               parDir:(const double *)dp
+                  res:(double *)r
+               resDir:(double *)dr
+             jacPFlag:(const BOOL)jpf
+           parColumns:(const int *)pc
+             parCount:(int)npc
+                 JacP:(double *)jp
+              JacPDir:(double *)djp
+            workspace:(PXModelWorkspace *)ws {
+    /** interpreter code pointer */
+    CODE *code = kindStart[0];
+
+    /** operand stack pointer, and of the tangents */
+    double *pSt = [ws stack];
+    double *dSt = [ws tangent];
+
+    double *Tmp = [ws tmp];                  /* temporaries      */
+    double *DTmp = [ws dTmp];                /* deriv. of temps. */
+    double *Grad = [ws gradient];            /* gradients        */
+    double *TTmp = dSt + nDepth + 1;         /* their tangents   */
+    double *TDTmp = TTmp + nTmp;
+    double *TGrad = TDTmp + nTmp;
+    double *TRes = TGrad + (nTmp + nRes) * nVec;
+
+    int kod = 0;       /* kind of derivatives              */
+    int iDvt = 0;      /* index of current deriv. variable */
+    double *jac = jp;  /* pointer to current Jacobian      */
+    double *djac = djp; /* and to its tangents             */
+    int nc = 0;        /* columns of the current kind      */
+    const int *sel = NULL; /* listed columns of the kind, or NULL */
+    int nSel = 0;      /* number of listed columns         */
+    int q = 0;         /* position in the list             */
+
+    OPR opr;     /* operator                         */
+    TYP typ;     /* type of operand                  */
+    int ind;     /* operand index                    */
+    double val;  /* operand value                    */
+    double dval; /* tangent of the operand           */
+
+    if (!dr) {
+        dr = TRes;
+    }
+
+    ws.errorCode = 0;
+
+    for (;;) {
+        opr = (*code++).o;
+        switch (opr) {
+        default:
+            ws.errorCode = -1;
+            return NO; /* error */
+        case INVAL:
+            return YES; /* finished */
+        case AND:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt != 0 && *(pSt + 1) != 0) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case OR:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt != 0 || *(pSt + 1) != 0) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case NOT:
+            *pSt = (*pSt == 0) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case LT:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt < *(pSt + 1)) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case GT:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt > *(pSt + 1)) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case LE:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt <= *(pSt + 1)) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case GE:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt >= *(pSt + 1)) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case EQ:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt == *(pSt + 1)) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case NE:
+            pSt--;
+            dSt--;
+            *pSt = (*pSt != *(pSt + 1)) ? 1 : 0;
+            *dSt = 0;
+            break;
+        case ADD:
+            pSt--;
+            dSt--;
+            *pSt = *pSt + *(pSt + 1);
+            *dSt = *dSt + *(dSt + 1);
+            break;
+        case SUB:
+            pSt--;
+            dSt--;
+            *pSt = *pSt - *(pSt + 1);
+            *dSt = *dSt - *(dSt + 1);
+            break;
+        case MUL:
+            pSt--;
+            dSt--;
+            *dSt = *dSt * *(pSt + 1) + *pSt * *(dSt + 1);
+            *pSt = *pSt * *(pSt + 1);
+            break;
+        case DIV:
+            pSt--;
+            dSt--;
+            *pSt = *pSt / *(pSt + 1);
+            *dSt = (*dSt - *pSt * *(dSt + 1)) / *(pSt + 1);
+            break;
+        case POW:
+            pSt--;
+            dSt--;
+            val = pow(*pSt, *(pSt + 1));
+            dval = 0;
+            if (*dSt != 0) { /* the base is not constant */
+                dval = *(pSt + 1) * pow(*pSt, *(pSt + 1) - 1) * *dSt;
+            }
+            if (*(dSt + 1) != 0) { /* the exponent is not constant */
+                dval += val * log(*pSt) * *(dSt + 1);
+            }
+            *pSt = val;
+            *dSt = dval;
+            break;
+        case SGN:
+            *pSt = (*pSt >= 0) ? 1 : -1;
+            *dSt = 0;
+            break;
+        case SIN:
+            *dSt *= cos(*pSt);
+            *pSt = sin(*pSt);
+            break;
+        case COS:
+            *dSt *= -sin(*pSt);
+            *pSt = cos(*pSt);
+            break;
+        case TAN:
+            *pSt = tan(*pSt);
+            *dSt *= 1 + *pSt * *pSt;
+            break;
+        case ASIN:
+            *dSt /= sqrt(1 - *pSt * *pSt);
+            *pSt = asin(*pSt);
+            break;
+        case ACOS:
+            *dSt /= -sqrt(1 - *pSt * *pSt);
+            *pSt = acos(*pSt);
+            break;
+        case ATAN:
+            *dSt /= 1 + *pSt * *pSt;
+            *pSt = atan(*pSt);
+            break;
+        case SINH:
+            *dSt *= cosh(*pSt);
+            *pSt = sinh(*pSt);
+            break;
+        case COSH:
+            *dSt *= sinh(*pSt);
+            *pSt = cosh(*pSt);
+            break;
+        case TANH:
+            *pSt = tanh(*pSt);
+            *dSt *= 1 - *pSt * *pSt;
+            break;
+        case ERF:
+            *dSt *= M_2_SQRTPI * exp(-*pSt * *pSt);
+            *pSt = erf(*pSt);
+            break;
+        case EXP:
+            *pSt = exp(*pSt);
+            *dSt *= *pSt;
+            break;
+        case LOG:
+            *dSt /= *pSt;
+            *pSt = log(*pSt);
+            break;
+        case LG:
+            *dSt /= *pSt * M_LN10;
+            *pSt = log10(*pSt);
+            break;
+        case SQRT:
+            *pSt = sqrt(*pSt);
+            *dSt /= 2 * *pSt;
+            break;
+        case SQR:
+            *dSt *= 2 * *pSt;
+            *pSt = *pSt * *pSt;
+            break;
+        case NEG:
+            *pSt = -*pSt;
+            *dSt = -*dSt;
+            break;
+        case REV:
+            *pSt = 1.0 / *pSt;
+            *dSt *= -*pSt * *pSt;
+            break;
+        case INC:
+            *pSt += 1;
+            break;
+        case DEC:
+            *pSt -= 1;
+            break;
+        case ABS:
+            if (*pSt < 0) {
+                *pSt = -*pSt;
+                *dSt = -*dSt;
+            }
+            break;
+        case RET:
+            ws.errorCode = *pSt;
+            return NO;
+            break;
+        case CHKL:
+            pSt--;
+            if (*pSt < *(pSt + 1)) {
+                return NO;
+            }
+            pSt--;
+            dSt -= 2;
+            break;
+        case CHKG:
+            pSt--;
+            if (*pSt > *(pSt + 1)) {
+                return NO;
+            }
+            pSt--;
+            dSt -= 2;
+            break;
+        case DOPD:
+        case OPD:
+            typ = (*code++).t;
+            ind = (*code++).i;
+
+            switch (typ) {
+            case VAR:
+                val = x[ind];
+                dval = dx ? dx[ind] : 0;
+                break;
+            case AUX:
+                val = a[ind];
+                dval = da ? da[ind] : 0;
+                break;
+            case PAR:
+                val = p[ind];
+                dval = dp ? dp[ind] : 0;
+                break;
+            case CON:
+                val = c[ind];
+                dval = 0;
+                break;
+            case FLG:
+                val = f[ind] > 0.5 ? 1 : 0;
+                dval = 0;
+                break;
+            case RES:
+                val = r[ind];
+                dval = dr[ind];
+                break;
+            case TMP:
+                val = Tmp[ind];
+                dval = TTmp[ind];
+                break;
+            case DRES:
+                val = jac[iDvt * nStride + ind];
+                dval = djac[iDvt * nStride + ind];
+                break;
+            case DJAC:
+                val = jac[iDvt * nRowStride + ind];
+                dval = djac[iDvt * nRowStride + ind];
+                break;
+            case DTMP:
+                val = DTmp[ind];
+                dval = TDTmp[ind];
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            *(++pSt) = val;
+            *(++dSt) = dval;
+            break;
+        case NUM:
+            ind = (*code++).i;
+            *(++pSt) = Num[ind];
+            *(++dSt) = 0;
+            break;
+        case LDF:
+            ind = (*code++).i;
+            *(++pSt) = f[ind] > 0.5 ? 1 : 0;
+            *(++dSt) = 0;
+            break;
+        case ASS:
+        case NASS:
+        case CLR:
+            typ = (*code++).t;
+            ind = (*code++).i;
+            if (opr == ASS) {
+                val = *(pSt--);
+                dval = *(dSt--);
+            } else if (opr == NASS) {
+                val = -(*(pSt--));
+                dval = -(*(dSt--));
+            } else {
+                val = 0.0;
+                dval = 0.0;
+            }
+            switch (typ) {
+
+            case RES:
+                r[ind] = val;
+                dr[ind] = dval;
+                break;
+            case TMP:
+                Tmp[ind] = val;
+                TTmp[ind] = dval;
+                break;
+            case DRES:
+                jac[iDvt * nStride + ind] = val;
+                djac[iDvt * nStride + ind] = dval;
+                break;
+            case DJAC:
+                jac[iDvt * nRowStride + ind] = val;
+                djac[iDvt * nRowStride + ind] = dval;
+                break;
+            case DTMP:
+                DTmp[ind] = val;
+                TDTmp[ind] = dval;
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            break;
+        case GCLR:
+            ind = (*code++).i;
+            vec_set(Grad + ind, 0.0, nc);
+            vec_set(TGrad + ind, 0.0, nc);
+            break;
+        case GADD:
+            ind = (*code++).i;
+            val = *(pSt--);
+            dval = *(dSt--);
+            vec_axpy(TGrad + ind, val, TGrad + (*code).i, nc);
+            vec_axpy(TGrad + ind, dval, Grad + (*code).i, nc);
+            vec_axpy(Grad + ind, val, Grad + (*code++).i, nc);
+            break;
+        case GSEED:
+            ind = (*code++).i;
+            Grad[ind] = Grad[ind] + *(pSt--);
+            TGrad[ind] = TGrad[ind] + *(dSt--);
+            break;
+        case IF:
+            dSt--;
+            if (*(pSt--) == 0) {
+                code = (*code).c;
+            } else {
+                code += 2;
+            }
+            break;
+        case EOD:
+            if (Vector[kod]) {
+                [self scatterGradients:Grad
+                                 width:1
+                                  kind:kod
+                                  into:jac
+                                stride:1
+                                 count:1];
+                [self scatterGradients:TGrad
+                                 width:1
+                                  kind:kod
+                                  into:djac
+                                stride:1
+                                 count:1];
+            }
+            if (sel) {
+                q++; /* next listed column */
+                iDvt = (q < nSel) ? sel[q] : nc;
+                code = Column[kod][iDvt];
+            } else {
+                iDvt++;
+            }
+            break;
+        case SOK:
+            kod++;
+            iDvt = 0;
+            if (kod == 1) {
+                code = kindStart[3]; /* skip straight to parameter
+                                        derivatives */
+                kod++;
+                break;
+            }
+            if (jpf == NO) {
+                return YES;
+            }
+            jac = jp;
+            djac = djp;
+            nc = nPar;
+            sel = Column[kod] ? pc : NULL; /* only forward mode is skipped */
+            nSel = npc;
+            if (sel) {
+                q = 0; /* first listed column */
+                iDvt = (nSel > 0) ? sel[0] : nc;
+                code = Column[kod][iDvt];
+            }
+            break;
+        case SOP:
+            break;
+        case SOD:
+            if (jpf == NO) {
+                return YES; /* no parameter derivatives */
+            }
+            break;
+        case JMP:
+            code = (*code).c;
+            break;
+        }
+    }
+    return YES;
+}
+
+/**
+ @brief Product of the Jacobians and a direction
+
+ @discussion    The tangents of the residuals in a direction of the
+ variables, auxiliaries and parameters are computed with the residuals, in
+ a single evaluation of the function code: J·v, where J = [Jx Ja Jp].
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param vx direction of the variables, NULL for zero
+ @param va direction of the auxiliary variables, NULL for zero
+ @param vp direction of the parameters, NULL for zero
+ @param jv product of the Jacobians and the direction, per residual
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)evaluateJacobianVectorForVar:(const double *)x
+                                 aux:(const double *)a
+                                 par:(const double *)p
+                                 con:(const double *)c
+                                flag:(const double *)f
+                                 res:(double *)r
+                              varDir:(const double *)vx
+                              auxDir:(const double *)va
+                              parDir:(const double *)vp
+                              resDir:(double *)jv
+                           workspace:(PXModelWorkspace *)ws {
+
+    return [self tangentForVar:x
+                           aux:a
+                           par:p
+                           con:c
+                          flag:f
+                        varDir:vx
+                        auxDir:va
+                        parDir:vp
+                           res:r
+                        resDir:jv
+                      jacPFlag:NO
+                    parColumns:NULL
+                      parCount:0
+                          JacP:NULL
+                       JacPDir:NULL
+                     workspace:ws];
+}
+
+/**
+ @brief Product of a vector of the residuals and the Jacobians
+
+ @discussion    The function code is evaluated once, and the operations
+ that are executed are recorded on a tape. A single backward sweep over the
+ tape gives the adjoints of the variables, auxiliaries and parameters for
+ the weights of the residuals: Jᵀ·w, for J = [Jx Ja Jp]. The parameter
+ stage is always evaluated, for the adjoints of the parameters.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param w weights of the residuals
+ @param gx product for the variables, NULL if not needed
+ @param ga product for the auxiliary variables, NULL if not needed
+ @param gp product for the parameters, NULL if not needed
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)evaluateVectorJacobianForVar:(const double *)x
+                                 aux:(const double *)a
+                                 par:(const double *)p
+                                 con:(const double *)c
+                                flag:(const double *)f
+                                 res:(double *)r
+                             weights:(const double *)w
+                              varAdj:(double *)gx
+                              auxAdj:(double *)ga
+                              parAdj:(double *)gp
+                           workspace:(PXModelWorkspace *)ws {
+    /** interpreter code pointer */
+    CODE *code = kindStart[0];
+    CODE *at; /* start of the current instruction */
+
+    /** operand stack pointer */
+    double *pSt = [ws stack];
+
+    double *Tmp = [ws tmp]; /* temporaries */
+
+    TAPE *tape = (TAPE *)[ws tape];
+    TAPE *t = tape;                                 /* end of the tape */
+    double *pAd = (double *)(tape + nCode + 1);     /* adjoint stack */
+    double *ATmp = pAd + nDepth + 1;                /* adjoints of the  */
+    double *ARes = ATmp + nTmp;                     /* temporaries, ... */
+    double *AVar = ARes + nRes;
+    double *AAux = AVar + nVar;
+    double *APar = AAux + nAux;
+
+    OPR opr;    /* operator      */
+    TYP typ;    /* type of operand */
+    int ind;    /* operand index */
+    double val; /* operand value */
+    double g;   /* adjoint of the result */
+    double u, v; /* operands on the tape */
+    double *adj; /* adjoint of an assigned value */
+
+    ws.errorCode = 0;
+
+    /* evaluation of the function code onto the tape */
+    for (opr = INVAL; opr != SOK;) {
+        at = code;
+        opr = (*code++).o;
+        t->code = at;
+        switch (opr) {
+        default:
+            ws.errorCode = -1;
+            return NO; /* error */
+        case INVAL:
+        case SOK:
+            opr = SOK; /* end of the function code */
+            continue;
+        case AND:
+        case OR:
+        case LT:
+        case GT:
+        case LE:
+        case GE:
+        case EQ:
+        case NE:
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case POW:
+            u = *(pSt - 1);
+            v = *pSt;
+            t->a = u;
+            t->b = v;
+            pSt--;
+            switch (opr) {
+            case AND:
+                *pSt = (u != 0 && v != 0) ? 1 : 0;
+                break;
+            case OR:
+                *pSt = (u != 0 || v != 0) ? 1 : 0;
+                break;
+            case LT:
+                *pSt = (u < v) ? 1 : 0;
+                break;
+            case GT:
+                *pSt = (u > v) ? 1 : 0;
+                break;
+            case LE:
+                *pSt = (u <= v) ? 1 : 0;
+                break;
+            case GE:
+                *pSt = (u >= v) ? 1 : 0;
+                break;
+            case EQ:
+                *pSt = (u == v) ? 1 : 0;
+                break;
+            case NE:
+                *pSt = (u != v) ? 1 : 0;
+                break;
+            case ADD:
+                *pSt = u + v;
+                break;
+            case SUB:
+                *pSt = u - v;
+                break;
+            case MUL:
+                *pSt = u * v;
+                break;
+            case DIV:
+                *pSt = u / v;
+                break;
+            default:
+                *pSt = pow(u, v);
+                break;
+            }
+            break;
+        case NOT:
+            t->a = *pSt;
+            *pSt = (*pSt == 0) ? 1 : 0;
+            break;
+        case SGN:
+            t->a = *pSt;
+            *pSt = (*pSt >= 0) ? 1 : -1;
+            break;
+        case SIN:
+            t->a = *pSt;
+            *pSt = sin(*pSt);
+            break;
+        case COS:
+            t->a = *pSt;
+            *pSt = cos(*pSt);
+            break;
+        case TAN:
+            t->a = *pSt;
+            *pSt = tan(*pSt);
+            break;
+        case ASIN:
+            t->a = *pSt;
+            *pSt = asin(*pSt);
+            break;
+        case ACOS:
+            t->a = *pSt;
+            *pSt = acos(*pSt);
+            break;
+        case ATAN:
+            t->a = *pSt;
+            *pSt = atan(*pSt);
+            break;
+        case SINH:
+            t->a = *pSt;
+            *pSt = sinh(*pSt);
+            break;
+        case COSH:
+            t->a = *pSt;
+            *pSt = cosh(*pSt);
+            break;
+        case TANH:
+            t->a = *pSt;
+            *pSt = tanh(*pSt);
+            break;
+        case ERF:
+            t->a = *pSt;
+            *pSt = erf(*pSt);
+            break;
+        case EXP:
+            t->a = *pSt;
+            *pSt = exp(*pSt);
+            break;
+        case LOG:
+            t->a = *pSt;
+            *pSt = log(*pSt);
+            break;
+        case LG:
+            t->a = *pSt;
+            *pSt = log10(*pSt);
+            break;
+        case SQRT:
+            t->a = *pSt;
+            *pSt = sqrt(*pSt);
+            break;
+        case SQR:
+            t->a = *pSt;
+            *pSt = *pSt * *pSt;
+            break;
+        case NEG:
+            t->a = *pSt;
+            *pSt = -*pSt;
+            break;
+        case REV:
+            t->a = *pSt;
+            *pSt = 1.0 / *pSt;
+            break;
+        case INC:
+            t->a = *pSt;
+            *pSt += 1;
+            break;
+        case DEC:
+            t->a = *pSt;
+            *pSt -= 1;
+            break;
+        case ABS:
+            t->a = *pSt;
+            if (*pSt < 0) {
+                *pSt = -*pSt;
+            }
+            break;
+        case RET:
+            ws.errorCode = *pSt;
+            return NO;
+            break;
+        case CHKL:
+            pSt--;
+            if (*pSt < *(pSt + 1)) {
+                return NO;
+            }
+            pSt--;
+            break;
+        case CHKG:
+            pSt--;
+            if (*pSt > *(pSt + 1)) {
+                return NO;
+            }
+            pSt--;
+            break;
+        case OPD:
+            typ = (*code++).t;
+            ind = (*code++).i;
+
+            switch (typ) {
+            case VAR:
+                val = x[ind];
+                break;
+            case AUX:
+                val = a[ind];
+                break;
+            case PAR:
+                val = p[ind];
+                break;
+            case CON:
+                val = c[ind];
+                break;
+            case FLG:
+                val = f[ind] > 0.5 ? 1 : 0;
+                break;
+            case RES:
+                val = r[ind];
+                break;
+            case TMP:
+                val = Tmp[ind];
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            *(++pSt) = val;
+            break;
+        case NUM:
+            ind = (*code++).i;
+            *(++pSt) = Num[ind];
+            break;
+        case LDF:
+            ind = (*code++).i;
+            *(++pSt) = f[ind] > 0.5 ? 1 : 0;
+            break;
+        case ASS:
+        case NASS:
+        case CLR:
+            typ = (*code++).t;
+            ind = (*code++).i;
+            if (opr == ASS) {
+                val = *(pSt--);
+            } else if (opr == NASS) {
+                val = -(*(pSt--));
+            } else {
+                val = 0.0;
+            }
+            switch (typ) {
+            case RES:
+                r[ind] = val;
+                break;
+            case TMP:
+                Tmp[ind] = val;
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            break;
+        case IF:
+            if (*(pSt--) == 0) {
+                code = (*code).c;
+            } else {
+                code += 2;
+            }
+            break;
+        case SOP:
+            continue; /* not taped */
+        case SOD:
+            opr = SOK; /* end of the function code */
+            continue;
+        case JMP:
+            code = (*code).c;
+            continue;
+        }
+        t++;
+    }
+
+    /* backward sweep over the tape */
+    vec_set(ATmp, 0.0, nTmp);
+    vec_copy(ARes, w, nRes);
+    vec_set(AVar, 0.0, nVar + nAux + nPar);
+    while (t > tape) {
+        t--;
+        opr = (*t->code).o;
+        u = t->a;
+        v = t->b;
+        switch (opr) {
+        default: /* comparisons and logic, no derivative */
+            *pAd = 0;
+            *(++pAd) = 0;
+            break;
+        case ADD:
+            g = *pAd;
+            *(++pAd) = g;
+            break;
+        case SUB:
+            g = *pAd;
+            *(++pAd) = -g;
+            break;
+        case MUL:
+            g = *pAd;
+            *pAd = g * v;
+            *(++pAd) = g * u;
+            break;
+        case DIV:
+            g = *pAd / v;
+            *pAd = g;
+            *(++pAd) = -g * u / v;
+            break;
+        case POW:
+            g = *pAd;
+            *pAd = g * v * pow(u, v - 1);
+            *(++pAd) = (u > 0) ? g * pow(u, v) * log(u) : 0;
+            break;
+        case NOT:
+        case SGN:
+            *pAd = 0;
+            break;
+        case SIN:
+            *pAd *= cos(u);
+            break;
+        case COS:
+            *pAd *= -sin(u);
+            break;
+        case TAN:
+            *pAd *= 1 + tan(u) * tan(u);
+            break;
+        case ASIN:
+            *pAd /= sqrt(1 - u * u);
+            break;
+        case ACOS:
+            *pAd /= -sqrt(1 - u * u);
+            break;
+        case ATAN:
+            *pAd /= 1 + u * u;
+            break;
+        case SINH:
+            *pAd *= cosh(u);
+            break;
+        case COSH:
+            *pAd *= sinh(u);
+            break;
+        case TANH:
+            *pAd *= 1 - tanh(u) * tanh(u);
+            break;
+        case ERF:
+            *pAd *= M_2_SQRTPI * exp(-u * u);
+            break;
+        case EXP:
+            *pAd *= exp(u);
+            break;
+        case LOG:
+            *pAd /= u;
+            break;
+        case LG:
+            *pAd /= u * M_LN10;
+            break;
+        case SQRT:
+            *pAd /= 2 * sqrt(u);
+            break;
+        case SQR:
+            *pAd *= 2 * u;
+            break;
+        case NEG:
+            *pAd = -*pAd;
+            break;
+        case REV:
+            *pAd /= -u * u;
+            break;
+        case INC:
+        case DEC:
+            break;
+        case ABS:
+            if (u < 0) {
+                *pAd = -*pAd;
+            }
+            break;
+        case CHKL:
+        case CHKG:
+            *(++pAd) = 0;
+            *(++pAd) = 0;
+            break;
+        case IF:
+            *(++pAd) = 0;
+            break;
+        case OPD:
+            typ = t->code[1].t;
+            ind = t->code[2].i;
+            g = *(pAd--);
+            switch (typ) {
+            case VAR:
+                AVar[ind] += g;
+                break;
+            case AUX:
+                AAux[ind] += g;
+                break;
+            case PAR:
+                APar[ind] += g;
+                break;
+            case RES:
+                ARes[ind] += g;
+                break;
+            case TMP:
+                ATmp[ind] += g;
+                break;
+            default:
+                break;
+            }
+            break;
+        case NUM:
+        case LDF:
+            pAd--;
+            break;
+        case ASS:
+        case NASS:
+        case CLR:
+            typ = t->code[1].t;
+            ind = t->code[2].i;
+            adj = (typ == RES) ? ARes + ind : ATmp + ind;
+            if (opr == ASS) {
+                *(++pAd) = *adj;
+            } else if (opr == NASS) {
+                *(++pAd) = -*adj;
+            }
+            *adj = 0; /* the value before the assignment is not used */
+            break;
+        }
+    }
+
+    if (gx) {
+        vec_copy(gx, AVar, nVar);
+    }
+    if (ga) {
+        vec_copy(ga, AAux, nAux);
+    }
+    if (gp) {
+        vec_copy(gp, APar, nPar);
+    }
+    return YES;
+}
+
+/**
+ @brief Product of the Hessians for the parameters and a direction
+
+ @discussion    Entry (i, r) of the product is the derivative of residual r
+ to parameter i, differentiated in the direction v of the parameters:
+ the sum over k of d2 r / dp_i dp_k * v_k. The product has the layout of
+ the Jacobian for the parameters, and is computed in a single evaluation,
+ together with the residuals and the Jacobian.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param v direction of the parameters
+ @param jp Jacobian for parameters
+ @param hv product of the Hessians and the direction
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)evaluateHessianVectorForVar:(const double *)x
+                                aux:(const double *)a
+                                par:(const double *)p
+                                con:(const double *)c
+                               flag:(const double *)f
+                                res:(double *)r
+                          direction:(const double *)v
+                               JacP:(double *)jp
+                           HessVecP:(double *)hv
+                          workspace:(PXModelWorkspace *)ws {
+
+    return [self tangentForVar:x
+                           aux:a
+                           par:p
+                           con:c
+                          flag:f
+                        varDir:NULL
+                        auxDir:NULL
+                        parDir:v
+                           res:r
+                        resDir:NULL
+                      jacPFlag:YES
+                    parColumns:NULL
+                      parCount:0
+                          JacP:jp
+                       JacPDir:hv
+                     workspace:ws];
+}
+
+/**
+ @brief Hessians of the residuals for the parameters
+
+ @discussion    The Hessians are symmetric; of each only the upper triangle
+ is stored, packed by column. The second derivatives of all residuals to
+ parameters i <= k are at h + (k * (k + 1) / 2 + i) * nRes. <br>
+ Column k of the triangle is the tangent of the Jacobian in the direction
+ of parameter k. Its evaluation is limited to the parameters i <= k that
+ share a residual with k, for derivatives in forward mode; the other
+ entries are structural zeros. Requires a dense layout.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jp Jacobian for parameters
+ @param h Hessians for the parameters, upper triangles
+ @param ws workspace of the calling thread
+ @return YES/NO for success
+ */
+- (BOOL)evaluateHessianForVar:(const double *)x
+                          aux:(const double *)a
+                          par:(const double *)p
+                          con:(const double *)c
+                         flag:(const double *)f
+                          res:(double *)r
+                         JacP:(double *)jp
+                        HessP:(double *)h
+                    workspace:(PXModelWorkspace *)ws {
+
+    double *seed; /* direction of a single parameter */
+    double *djp;  /* tangents of the Jacobian */
+    double *hk;   /* column k of the triangles */
+    int *cols = [ws columns] + nVar;
+    int n;
+    BOOL done = NO; /* residuals evaluated */
+
+    if (_layout != PXJacobianDense) {
+        ws.errorCode = -1;
+        return NO;
+    }
+    seed = [ws tangent] + [self tangentSize] - nRes * nPar - nPar;
+    djp = seed + nPar;
+
+    /* without a pair, a column of the Jacobian is a structural zero */
+    vec_set(jp, 0.0, nRes * nPar);
+    vec_set(seed, 0.0, nPar);
+    for (int k = 0; k < nPar; k++) {
+        hk = h + (size_t)k * (k + 1) / 2 * nRes;
+        vec_set(hk, 0.0, (k + 1) * nRes);
+        n = 0;
+        for (int m = PairStart[k]; m < PairStart[k + 1]; m++) {
+            cols[n++] = PairCol[m];
+        }
+        if (n == 0) {
+            continue;
+        }
+        seed[k] = 1;
+        if (![self tangentForVar:x
+                             aux:a
+                             par:p
+                             con:c
+                            flag:f
+                          varDir:NULL
+                          auxDir:NULL
+                          parDir:seed
+                             res:r
+                          resDir:NULL
+                        jacPFlag:YES
+                      parColumns:cols
+                        parCount:n
+                            JacP:jp
+                         JacPDir:djp
+                       workspace:ws]) {
+            return NO;
+        }
+        seed[k] = 0;
+        done = YES;
+        for (int m = 0; m < n; m++) {
+            vec_copy(hk + cols[m] * nRes, djp + cols[m] * nRes, nRes);
+        }
+    }
+    if (!done) {
+        return [self evaluateForVar:x
+                                aux:a
+                                par:p
+                                con:c
+                               flag:f
+                                res:r
+                           jacXFlag:NO
+                         varColumns:NULL
+                           varCount:0
+                               JacX:NULL
+                               JacA:NULL
+                           jacPFlag:NO
+                         parColumns:NULL
+                           parCount:0
+                               JacP:NULL
+                          workspace:ws];
+    }
+    return YES;
+}
+
+/**
+ @brief Execution of direct-threaded register code
+
+ @discussion    Each handler ends with a jump to the handler of the next
+ operator. Operands are read and written through a table of base pointers,
+ one per type of operand, the numerical constants, the register file and
+ the spill slots. Called with handlers, the handler table is returned and nothing
+ is evaluated. <br>
+ While the workspace is profiling, the profiled copy is run: each T_SEG
+ adds the time since the last one to its segment, reading the clock once
+ per segment rather than per instruction.
+
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xc list of variables, NULL for all variables
+ @param nxc length of the list of variables
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pc list of parameters, NULL for all parameters
+ @param npc length of the list of parameters
+ @param jp Jacobian for parameters
+ @param ws workspace of the calling thread
+ @param handlers return of the handler table, or NULL to evaluate
+ @return YES/NO for success
+ */
+- (BOOL)evaluateThreadedForVar:(const double *)x
+                           aux:(const double *)a
+                           par:(const double *)p
+                           con:(const double *)c
+                          flag:(const double *)f
+                           res:(double *)r
+                      jacXFlag:(const BOOL)jxf
+                    varColumns:(const int *)xc
+                      varCount:(int)nxc
+                          JacX:(double *)jx
+                          JacA:(double *)ja
+                      jacPFlag:(const BOOL)jpf
+                    parColumns:(const int *)pc
+                      parCount:(int)npc
+                          JacP:(double *)jp
+                     workspace:(PXModelWorkspace *)ws
+                      handlers:(const void *const **)handlers {
+#ifdef THREADED_CODE
+    static const void *const Handler[T_NOPR] = {
+        [T_END] = &&L_END,   [T_AND] = &&L_AND,   [T_OR] = &&L_OR,
+        [T_LT] = &&L_LT,     [T_GT] = &&L_GT,     [T_LE] = &&L_LE,
+        [T_GE] = &&L_GE,     [T_EQ] = &&L_EQ,     [T_NE] = &&L_NE,
+        [T_ADD] = &&L_ADD,   [T_SUB] = &&L_SUB,   [T_MUL] = &&L_MUL,
+        [T_DIV] = &&L_DIV,   [T_POW] = &&L_POW,   [T_NOT] = &&L_NOT,
+        [T_NEG] = &&L_NEG,   [T_REV] = &&L_REV,   [T_SQR] = &&L_SQR,
+        [T_INC] = &&L_INC,   [T_DEC] = &&L_DEC,   [T_SIN] = &&L_SIN,
+        [T_COS] = &&L_COS,   [T_TAN] = &&L_TAN,   [T_ASIN] = &&L_ASIN,
+        [T_ACOS] = &&L_ACOS, [T_ATAN] = &&L_ATAN, [T_SINH] = &&L_SINH,
+        [T_COSH] = &&L_COSH, [T_TANH] = &&L_TANH, [T_ERF] = &&L_ERF,
+        [T_EXP] = &&L_EXP,   [T_LOG] = &&L_LOG,   [T_LG] = &&L_LG,
+        [T_SQRT] = &&L_SQRT, [T_ABS] = &&L_ABS,   [T_SGN] = &&L_SGN,
+        [T_MOV] = &&L_MOV,   [T_FLG] = &&L_FLG,   [T_CLR] = &&L_CLR,
+        [T_GCLR] = &&L_GCLR, [T_GADD] = &&L_GADD, [T_GSEED] = &&L_GSEED,
+        [T_RET] = &&L_RET,   [T_CHKL] = &&L_CHKL, [T_CHKG] = &&L_CHKG,
+        [T_IF] = &&L_IF,     [T_JMP] = &&L_JMP,   [T_EOD] = &&L_EOD,
+        [T_SOK] = &&L_SOK,   [T_SOP] = &&L_SOP,   [T_SOD] = &&L_SOD,
+        [T_SEG] = &&L_SEG};
+
+    if (handlers) {
+        *handlers = Handler;
+        return YES;
+    }
+
+/** dispatch of the next operator */
+#define NEXT goto *(*code++).h
+
+/** end of the evaluation, the time of the current segment is added */
+#define FINISH(ok)                                                             \
+    do {                                                                       \
+        if (prof && seg >= 0) {                                                \
+            prof[2 * seg + 1] += profileClock() - t0;                          \
+        }                                                                      \
+        return (ok);                                                           \
+    } while (0)
+
+/** operand k of the current operator */
+#define OP(k) B[code[k].i & BASE_MASK][code[k].i >> BASE_BITS]
+
+    /** profile, NULL when not profiling */
+    double *prof = (ws.profiling && pStart) ? [ws profile] : NULL;
+    int seg = -1;     /* current segment of the profile */
+    double t0 = 0, t; /* its start, current time        */
+
+    /** interpreter code pointer */
+    CODE *code = prof ? (ws.staged ? pPoint : pStart)
+                      : (ws.staged ? tPoint : tStart);
+    CODE *kind3 = prof ? pKind3 : tKind3;      /* start of par. derivs. */
+    CODE ***column = prof ? PColumn : TColumn; /* start of each deriv.  */
+
+    double R[NREG]; /* register file */
+
+    double *Grad = [ws gradient]; /* gradients */
+
+    int kod = 0;      /* kind of derivatives              */
+    int iDvt = 0;     /* index of current deriv. variable */
+    double *jac = jx; /* pointer to current Jacobian      */
+    int nc = 0;       /* columns of the current kind      */
+    const int *sel = NULL; /* listed columns of the kind, or NULL */
+    int nSel = 0;     /* number of listed columns         */
+    int q = 0;        /* position in the list             */
+
+    double val; /* operand value */
+
+    /** operand base pointers */
+    double *B[NBASE];
+    B[VAR] = (double *)x;
+    B[AUX] = (double *)a;
+    B[PAR] = (double *)p;
+    B[CON] = (double *)c;
+    B[FLG] = NULL; /* flags are read by T_FLG */
+    B[RES] = r;
+    B[TMP] = [ws tmp];
+    B[DRES] = jac;
+    B[DTMP] = [ws dTmp];
+    B[DJAC] = jac;
+    B[NUMB] = Num;
+    B[REGB] = R;
+    B[SPLB] = [ws stack];
+
+    ws.errorCode = 0;
+    if (prof && prof[2 * nSegment] == 0) {
+        prof[2 * nSegment] = profileClockTime();
+    }
+
+    NEXT;
+
+L_END:
+    FINISH(YES); /* finished */
+L_AND:
+    OP(0) = (OP(1) != 0 && OP(2) != 0) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_OR:
+    OP(0) = (OP(1) != 0 || OP(2) != 0) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_LT:
+    OP(0) = (OP(1) < OP(2)) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_GT:
+    OP(0) = (OP(1) > OP(2)) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_LE:
+    OP(0) = (OP(1) <= OP(2)) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_GE:
+    OP(0) = (OP(1) >= OP(2)) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_EQ:
+    OP(0) = (OP(1) == OP(2)) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_NE:
+    OP(0) = (OP(1) != OP(2)) ? 1 : 0;
+    code += 3;
+    NEXT;
+L_ADD:
+    OP(0) = OP(1) + OP(2);
+    code += 3;
+    NEXT;
+L_SUB:
+    OP(0) = OP(1) - OP(2);
+    code += 3;
+    NEXT;
+L_MUL:
+    OP(0) = OP(1) * OP(2);
+    code += 3;
+    NEXT;
+L_DIV:
+    OP(0) = OP(1) / OP(2);
+    code += 3;
+    NEXT;
+L_POW:
+    OP(0) = pow(OP(1), OP(2));
+    code += 3;
+    NEXT;
+L_NOT:
+    OP(0) = (OP(1) == 0) ? 1 : 0;
+    code += 2;
+    NEXT;
+L_SGN:
+    OP(0) = (OP(1) >= 0) ? 1 : -1;
+    code += 2;
+    NEXT;
+L_SIN:
+    OP(0) = sin(OP(1));
+    code += 2;
+    NEXT;
+L_COS:
+    OP(0) = cos(OP(1));
+    code += 2;
+    NEXT;
+L_TAN:
+    OP(0) = tan(OP(1));
+    code += 2;
+    NEXT;
+L_ASIN:
+    OP(0) = asin(OP(1));
+    code += 2;
+    NEXT;
+L_ACOS:
+    OP(0) = acos(OP(1));
+    code += 2;
+    NEXT;
+L_ATAN:
+    OP(0) = atan(OP(1));
+    code += 2;
+    NEXT;
+L_SINH:
+    OP(0) = sinh(OP(1));
+    code += 2;
+    NEXT;
+L_COSH:
+    OP(0) = cosh(OP(1));
+    code += 2;
+    NEXT;
+L_TANH:
+    OP(0) = tanh(OP(1));
+    code += 2;
+    NEXT;
+L_ERF:
+    OP(0) = erf(OP(1));
+    code += 2;
+    NEXT;
+L_EXP:
+    OP(0) = exp(OP(1));
+    code += 2;
+    NEXT;
+L_LOG:
+    OP(0) = log(OP(1));
+    code += 2;
+    NEXT;
+L_LG:
+    OP(0) = log10(OP(1));
+    code += 2;
+    NEXT;
+L_SQRT:
+    OP(0) = sqrt(OP(1));
+    code += 2;
+    NEXT;
+L_SQR:
+    val = OP(1);
+    OP(0) = val * val;
+    code += 2;
+    NEXT;
+L_NEG:
+    OP(0) = -OP(1);
+    code += 2;
+    NEXT;
+L_REV:
+    OP(0) = 1.0 / OP(1);
+    code += 2;
+    NEXT;
+L_INC:
+    OP(0) = OP(1) + 1;
+    code += 2;
+    NEXT;
+L_DEC:
+    OP(0) = OP(1) - 1;
+    code += 2;
+    NEXT;
+L_ABS:
+    val = OP(1);
+    OP(0) = (val < 0) ? -val : val;
+    code += 2;
+    NEXT;
+L_MOV:
+    OP(0) = OP(1);
+    code += 2;
+    NEXT;
+L_FLG:
+    OP(0) = f[code[1].i] > 0.5 ? 1 : 0;
+    code += 2;
+    NEXT;
+L_CLR:
+    OP(0) = 0.0;
+    code += 1;
+    NEXT;
+L_GCLR:
+    vec_set(Grad + code[0].i, 0.0, nc);
+    code += 1;
+    NEXT;
+L_GADD:
+    vec_axpy(Grad + code[1].i, OP(0), Grad + code[2].i, nc);
+    code += 3;
+    NEXT;
+L_GSEED:
+    Grad[code[1].i] = Grad[code[1].i] + OP(0);
+    code += 2;
+    NEXT;
+L_RET:
+    ws.errorCode = OP(0);
+    FINISH(NO);
+L_CHKL:
+    if (OP(0) < OP(1)) {
+        FINISH(NO);
+    }
+    code += 2;
+    NEXT;
+L_CHKG:
+    if (OP(0) > OP(1)) {
+        FINISH(NO);
+    }
+    code += 2;
+    NEXT;
+L_IF:
+    if (OP(0) == 0) {
+        code = code[1].c;
+    } else {
+        code += 2;
+    }
+    NEXT;
+L_JMP:
+    code = (*code).c;
+    NEXT;
+L_EOD:
+    if (Vector[kod]) {
+        [self scatterGradients:Grad
+                         width:1
+                          kind:kod
+                          into:jac
+                        stride:1
+                         count:1];
+    }
+    if (sel) {
+        q++; /* next listed column */
+        iDvt = (q < nSel) ? sel[q] : nc;
+        code = column[kod][iDvt];
+    } else {
+        iDvt++;
+    }
+    B[DRES] = jac + iDvt * nStride;
+    B[DJAC] = jac + iDvt * nRowStride;
+    NEXT;
+L_SOK:
+    kod++;
+    iDvt = 0;
+    jac = (kod == 1) ? jx : (kod == 2) ? ja : jp;
+    nc = (kod == 1) ? nVar : (kod == 2) ? nAux : nPar;
+    if (kod == 1 && jxf == NO) {
+        code = kind3; /* skip straight to parameter derivatives */
+        kod++;
+        NEXT;
+    }
+    if (kod == 3 && jpf == NO) {
+        FINISH(YES);
+    }
+    sel = NULL;
+    if (column[kod] && kod != 2) { /* only forward mode is skipped */
+        sel = (kod == 1) ? xc : pc;
+        nSel = (kod == 1) ? nxc : npc;
+    }
+    if (sel) {
+        q = 0; /* first listed column */
+        iDvt = (nSel > 0) ? sel[0] : nc;
+        code = column[kod][iDvt];
+    }
+    B[DRES] = jac + iDvt * nStride;
+    B[DJAC] = jac + iDvt * nRowStride;
+    NEXT;
+L_SOP:
+    if (!x) {
+        FINISH(YES); /* parameter stage only */
+    }
+    NEXT;
+L_SOD:
+    if (jxf == NO && jpf == NO) {
+        FINISH(YES); /* residuals only */
+    }
+    NEXT;
+L_SEG:
+    t = profileClock();
+    if (seg >= 0) {
+        prof[2 * seg + 1] += t - t0;
+    }
+    seg = code[0].i;
+    prof[2 * seg] += 1;
+    t0 = t;
+    code += 1;
+    NEXT;
+
+#undef FINISH
+#undef OP
+#undef NEXT
+#else
+    return NO;
+#endif
+}
+
+/**
+ @brief Batched execution of interpreter code
+
+ @discussion    The points are stored per quantity: x[i * nPoints + k] is
+ variable i of point k, likewise for a, r, and for the Jacobians, where
+ jx[(j * nRes + i) * nPoints + k] is the derivative of residual i to
+ variable j at point k; with a sparse layout jx[n * nPoints + k] is nonzero
+ n of the pattern at point k. <br>
+ Parameters, constants and flags are shared by all points. <br>
+ Each operator is applied to a block of points before the next operator is
+ fetched. A point that fails a limit check or raises an error is dropped from
+ the block and reported in status; its outputs are undefined.
+
+ @param nPoints number of points
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xf flags per variable
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pf flags per parameter
+ @param jp Jacobian for parameters
+ @param status PXPointStatus per point
+ @param ec optional error code per point, as raised by error()
+ @param ws workspace of the calling thread
+ @return YES/NO for success of all points
+ */
+- (BOOL)evaluatePoints:(int)nPoints
+                forVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(const BOOL *)xf
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(const BOOL *)pf
+                  JacP:(double *)jp
+                status:(int *)status
+            errorCodes:(int *)ec
+             workspace:(PXModelWorkspace *)ws {
+
+    BOOL ok = YES;
+    int nxc, npc;
+    int *cols = [ws columns];
+    const int *xc = flaggedColumns(xf, nVar, cols, &nxc);
+    const int *pc = flaggedColumns(pf, nPar, cols + nVar, &npc);
+
+    ws.errorCode = 0;
+
+    for (int p0 = 0; p0 < nPoints; p0 += LANES) {
+        int n = MIN(LANES, nPoints - p0);
+        if (![self evaluateLanesFrom:p0
+                               count:n
+                              stride:nPoints
+                              forVar:x
+                                 aux:a
+                                 par:p
+                                 con:c
+                                flag:f
+                                 res:r
+                            jacXFlag:jxf
+                          varColumns:xc
+                            varCount:nxc
+                                JacX:jx
+                                JacA:ja
+                            jacPFlag:jpf
+                          parColumns:pc
+                            parCount:npc
+                                JacP:jp
+                              status:status
+                          errorCodes:ec
+                               stage:(p0 == 0)
+                           workspace:ws]) {
+            ok = NO;
+        }
+    }
+    return ok;
+}
+
+/**
+ @brief Parallel batched execution of interpreter code
+
+ @discussion    The data layout and the reporting per point are those of the
+ batched execution. The points are cut into chunks that the workers take
+ one at a time from a shared counter, so that a worker that finishes early
+ takes over the remaining chunks. Each worker has its own workspace; the
+ outputs of different chunks do not overlap.
+
+ @param nPoints number of points
+ @param x variables
+ @param a auxillary variables
+ @param p parameters
+ @param c constants
+ @param f flags
+ @param r residuals
+ @param jxf flag evaluate Jacobian for variables
+ @param xf flags per variable
+ @param jx Jacobian for variables
+ @param ja Jacobian for auxillary variables
+ @param jpf flag evaluate Jacobian for parameters
+ @param pf flags per parameter
+ @param jp Jacobian for parameters
+ @param status PXPointStatus per point
+ @param ec optional error code per point, as raised by error()
+ @param nWorkers number of worker threads, 0 for one per active processor
+ @return YES/NO for success of all points
+ */
+- (BOOL)evaluatePoints:(int)nPoints
+                forVar:(const double *)x
+                   aux:(const double *)a
+                   par:(const double *)p
+                   con:(const double *)c
+                  flag:(const double *)f
+                   res:(double *)r
+              jacXFlag:(const BOOL)jxf
+              varFlags:(const BOOL *)xf
+                  JacX:(double *)jx
+                  JacA:(double *)ja
+              jacPFlag:(const BOOL)jpf
+              parFlags:(const BOOL *)pf
+                  JacP:(double *)jp
+                status:(int *)status
+            errorCodes:(int *)ec
+               workers:(int)nWorkers {
+
+    int nChunks = (nPoints + CHUNK - 1) / CHUNK;
+
+    if (nWorkers <= 0) {
+        nWorkers = (int)[[NSProcessInfo processInfo] activeProcessorCount];
+    }
+    nWorkers = MIN(nWorkers, nChunks);
+    if (nWorkers <= 1) {
+        PXModelWorkspace *ws =
+            [[PXModelWorkspace alloc] initWithProgram:self];
+        return [self evaluatePoints:nPoints
+                             forVar:x
+                                aux:a
+                                par:p
+                                con:c
+                               flag:f
+                                res:r
+                           jacXFlag:jxf
+                           varFlags:xf
+                               JacX:jx
+                               JacA:ja
+                           jacPFlag:jpf
+                           parFlags:pf
+                               JacP:jp
+                             status:status
+                         errorCodes:ec
+                          workspace:ws];
+    }
+
+    atomic_int nextChunk;  /* next chunk to be taken */
+    atomic_int nFailed;    /* number of chunks with failed points */
+    atomic_init(&nextChunk, 0);
+    atomic_init(&nFailed, 0);
+    atomic_int *pNext = &nextChunk;
+    atomic_int *pFailed = &nFailed;
+
+    dispatch_queue_t queue =
+        dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+
+    dispatch_apply(nWorkers, queue, ^(size_t worker) {
+        PXModelWorkspace *ws = [[PXModelWorkspace alloc] initWithProgram:self];
+        BOOL stage = YES; /* parameter stage of the first block only */
+        int k, nxc, npc;
+        int *cols = [ws columns];
+        const int *xc = flaggedColumns(xf, nVar, cols, &nxc);
+        const int *pc = flaggedColumns(pf, nPar, cols + nVar, &npc);
+        while ((k = atomic_fetch_add(pNext, 1)) < nChunks) {
+            int end = MIN((k + 1) * CHUNK, nPoints);
+            for (int p0 = k * CHUNK; p0 < end; p0 += LANES) {
+                if (![self evaluateLanesFrom:p0
+                                       count:MIN(LANES, end - p0)
+                                      stride:nPoints
+                                      forVar:x
+                                         aux:a
+                                         par:p
+                                         con:c
+                                        flag:f
+                                         res:r
+                                    jacXFlag:jxf
+                                  varColumns:xc
+                                    varCount:nxc
+                                        JacX:jx
+                                        JacA:ja
+                                    jacPFlag:jpf
+                                  parColumns:pc
+                                    parCount:npc
+                                        JacP:jp
+                                      status:status
+                                  errorCodes:ec
+                                       stage:stage
+                                   workspace:ws]) {
+                    atomic_fetch_add(pFailed, 1);
+                }
+                stage = NO;
+            }
+        }
+    });
+
+    return (atomic_load(&nFailed) == 0) ? YES : NO;
+}
+
+/**
+ @brief Execution of interpreter code for a block of points
+
+ @discussion    The operand stack, the temporaries and their derivatives hold
+ one value per lane. Conditionals on which the lanes agree are executed as in
+ the scalar interpreter, otherwise both branches are executed under a lane
+ mask. The parameters are shared by all points, so the parameter stage is
+ evaluated for the first block of a batch, and the temporaries of the stage
+ keep their values for the next blocks.
+
+ @param p0 first point of the block
+ @param n number of points in the block, at most LANES
+ @param ld number of points in the batch, stride of the arrays
+ @param stage evaluate the parameter stage
+ @param ws workspace of the calling thread
+ @return YES/NO for success of all points in the block
+ */
+- (BOOL)evaluateLanesFrom:(int)p0
+                    count:(int)n
+                   stride:(int)ld
+                   forVar:(const double *)x
+                      aux:(const double *)a
+                      par:(const double *)p
+                      con:(const double *)c
+                     flag:(const double *)f
+                      res:(double *)r
+                 jacXFlag:(const BOOL)jxf
+               varColumns:(const int *)xc
+                 varCount:(int)nxc
+                     JacX:(double *)jx
+                     JacA:(double *)ja
+                 jacPFlag:(const BOOL)jpf
+               parColumns:(const int *)pc
+                 parCount:(int)npc
+                     JacP:(double *)jp
+                   status:(int *)status
+               errorCodes:(int *)ec
+                    stage:(BOOL)stage
+                workspace:(PXModelWorkspace *)ws {
+    /** interpreter code pointer */
+    CODE *code = stage ? kindStart[0] : pointStart;
+
+    /** operand stack pointer, top lane vector */
+    double *pSt = [ws laneStack];
+
+    double *LTmp = [ws laneTmp];       /* lane temporaries      */
+    double *LDTmp = [ws laneDTmp];     /* lane deriv. of temps. */
+    double *LGrad = [ws laneGradient]; /* lane gradients        */
+
+    int kod = 0;      /* kind of derivatives              */
+    int iDvt = 0;     /* index of current deriv. variable */
+    double *jac = jx; /* pointer to current Jacobian      */
+    int nc = 0;       /* columns of the current kind      */
+    const int *sel = NULL; /* listed columns of the kind, or NULL */
+    int nSel = 0;     /* number of listed columns         */
+    int q = 0;        /* position in the list             */
+
+    OPR opr;            /* operator                         */
+    TYP typ;            /* type of operand                  */
+    int ind;            /* operand index                    */
+    double val;         /* operand value                    */
+    const double *src;  /* operand lanes                    */
+    double *dst;        /* destination lanes                */
+    int nFail = 0;      /* number of failed points          */
+    int nThen, nElse;   /* lanes per branch of conditional  */
+
+    unsigned char Alive[LANES]; /* lanes without failure */
+    unsigned char Mask[LANES];  /* lanes being executed */
+
+    LANE_FRAME Frame[MAXLEVEL + 1]; /* diverging conditionals */
+    LANE_FRAME *fr;
+    int level = 0;
+
+    for (int l = 0; l < n; l++) {
+        Alive[l] = Mask[l] = 1;
+        status[p0 + l] = PXPointStatusOK;
+        if (ec) {
+            ec[p0 + l] = 0;
+        }
+    }
+
+    for (;;) {
+        while (level > 0 && code == Frame[level].stop) {
+            fr = &Frame[level];
+            if (fr->stop == fr->jmp) { /* continue with else branch */
+                for (int l = 0; l < n; l++) {
+                    Mask[l] = fr->save[l] & !fr->cond[l] & Alive[l];
+                }
+                code = fr->els;
+                fr->stop = fr->end;
+            } else { /* conditional finished */
+                for (int l = 0; l < n; l++) {
+                    Mask[l] = fr->save[l] & Alive[l];
+                }
+                level--;
+            }
+        }
+
+        opr = (*code++).o;
+        switch (opr) {
+        default:
+            for (int l = 0; l < n; l++) {
+                if (Alive[l]) {
+                    status[p0 + l] = PXPointStatusInvalid;
+                }
+            }
+            ws.errorCode = -1;
+            return NO; /* error */
+        case INVAL:
+            return (nFail == 0) ? YES : NO; /* finished */
+        case AND:
+            pSt -= LANES;
+            vec_and(pSt, pSt + LANES, n);
+            break;
+        case OR:
+            pSt -= LANES;
+            vec_or(pSt, pSt + LANES, n);
+            break;
+        case NOT:
+            vec_not(pSt, n);
+            break;
+        case LT:
+            pSt -= LANES;
+            vec_lt(pSt, pSt + LANES, n);
+            break;
+        case GT:
+            pSt -= LANES;
+            vec_gt(pSt, pSt + LANES, n);
+            break;
+        case LE:
+            pSt -= LANES;
+            vec_le(pSt, pSt + LANES, n);
+            break;
+        case GE:
+            pSt -= LANES;
+            vec_ge(pSt, pSt + LANES, n);
+            break;
+        case EQ:
+            pSt -= LANES;
+            vec_eq(pSt, pSt + LANES, n);
+            break;
+        case NE:
+            pSt -= LANES;
+            vec_ne(pSt, pSt + LANES, n);
+            break;
+        case ADD:
+            pSt -= LANES;
+            vec_add(pSt, pSt + LANES, n);
+            break;
+        case SUB:
+            pSt -= LANES;
+            vec_sub(pSt, pSt + LANES, n);
+            break;
+        case MUL:
+            pSt -= LANES;
+            vec_mul(pSt, pSt + LANES, n);
+            break;
+        case DIV:
+            pSt -= LANES;
+            vec_div(pSt, pSt + LANES, n);
+            break;
+        case POW:
+            pSt -= LANES;
+            vec_pow(pSt, pSt + LANES, n);
+            break;
+        case SGN:
+            vec_sgn(pSt, n);
+            break;
+        case SIN:
+            vec_sin(pSt, n);
+            break;
+        case COS:
+            vec_cos(pSt, n);
+            break;
+        case TAN:
+            vec_tan(pSt, n);
+            break;
+        case ASIN:
+            vec_asin(pSt, n);
+            break;
+        case ACOS:
+            vec_acos(pSt, n);
+            break;
+        case ATAN:
+            vec_atan(pSt, n);
+            break;
+        case SINH:
+            vec_sinh(pSt, n);
+            break;
+        case COSH:
+            vec_cosh(pSt, n);
+            break;
+        case TANH:
+            vec_tanh(pSt, n);
+            break;
+        case ERF:
+            vec_erf(pSt, n);
+            break;
+        case EXP:
+            vec_exp(pSt, n);
+            break;
+        case LOG:
+            vec_log(pSt, n);
+            break;
+        case LG:
+            vec_log10(pSt, n);
+            break;
+        case SQRT:
+            vec_sqrt(pSt, n);
+            break;
+        case SQR:
+            vec_sqr(pSt, n);
+            break;
+        case NEG:
+            vec_neg(pSt, n);
+            break;
+        case REV:
+            vec_rev(pSt, n);
+            break;
+        case INC:
+            vec_inc(pSt, n);
+            break;
+        case DEC:
+            vec_dec(pSt, n);
+            break;
+        case ABS:
+            vec_abs(pSt, n);
+            break;
+        case RET:
+            for (int l = 0; l < n; l++) {
+                if (Mask[l]) {
+                    status[p0 + l] = PXPointStatusError;
+                    if (ec) {
+                        ec[p0 + l] = pSt[l];
+                    }
+                    Alive[l] = Mask[l] = 0;
+                    nFail++;
+                }
+            }
+            pSt -= LANES;
+            break;
+        case CHKL:
+        case CHKG:
+            pSt -= LANES;
+            for (int l = 0; l < n; l++) {
+                if (Mask[l] && ((opr == CHKL) ? (pSt[l] < pSt[LANES + l])
+                                              : (pSt[l] > pSt[LANES + l]))) {
+                    status[p0 + l] = PXPointStatusLimit;
+                    Alive[l] = Mask[l] = 0;
+                    nFail++;
+                }
+            }
+            pSt -= LANES;
+            break;
+        case DOPD:
+        case OPD:
+            typ = (*code++).t;
+            ind = (*code++).i;
+            pSt += LANES;
+
+            switch (typ) {
+            case VAR:
+                src = x + ind * ld + p0;
+                break;
+            case AUX:
+                src = a + ind * ld + p0;
+                break;
+            case RES:
+                src = r + ind * ld + p0;
+                break;
+            case TMP:
+                src = LTmp + ind * LANES;
+                break;
+            case DRES:
+                src = jac + (iDvt * nStride + ind) * ld + p0;
+                break;
+            case DJAC:
+                src = jac + (iDvt * nRowStride + ind) * ld + p0;
+                break;
+            case DTMP:
+                src = LDTmp + ind * LANES;
+                break;
+            case PAR:
+                src = NULL;
+                val = p[ind];
+                break;
+            case CON:
+                src = NULL;
+                val = c[ind];
+                break;
+            case FLG:
+                src = NULL;
+                val = f[ind] > 0.5 ? 1 : 0;
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            if (src) {
+                vec_copy(pSt, src, n);
+            } else {
+                vec_set(pSt, val, n);
+            }
+            break;
+        case NUM:
+            ind = (*code++).i;
+            pSt += LANES;
+            vec_set(pSt, Num[ind], n);
+            break;
+        case LDF:
+            ind = (*code++).i;
+            pSt += LANES;
+            vec_set(pSt, f[ind] > 0.5 ? 1 : 0, n);
+            break;
+        case ASS:
+        case NASS:
+        case CLR:
+            typ = (*code++).t;
+            ind = (*code++).i;
+            switch (typ) {
+            case RES:
+                dst = r + ind * ld + p0;
+                break;
+            case TMP:
+                dst = LTmp + ind * LANES;
+                break;
+            case DRES:
+                dst = jac + (iDvt * nStride + ind) * ld + p0;
+                break;
+            case DJAC:
+                dst = jac + (iDvt * nRowStride + ind) * ld + p0;
+                break;
+            case DTMP:
+                dst = LDTmp + ind * LANES;
+                break;
+            default:
+                ws.errorCode = -1;
+                return NO;
+                break;
+            }
+            if (opr == ASS) {
+                for (int l = 0; l < n; l++) {
+                    if (Mask[l]) {
+                        dst[l] = pSt[l];
+                    }
+                }
+                pSt -= LANES;
+            } else if (opr == NASS) {
+                for (int l = 0; l < n; l++) {
+                    if (Mask[l]) {
+                        dst[l] = -pSt[l];
+                    }
+                }
+                pSt -= LANES;
+            } else {
+                for (int l = 0; l < n; l++) {
+                    if (Mask[l]) {
+                        dst[l] = 0.0;
+                    }
+                }
+            }
+            break;
+        case GCLR:
+            dst = LGrad + (*code++).i * LANES;
+            for (int j = 0; j < nc; j++, dst += LANES) {
+                for (int l = 0; l < n; l++) {
+                    if (Mask[l]) {
+                        dst[l] = 0.0;
+                    }
+                }
+            }
+            break;
+        case GADD:
+            dst = LGrad + (*code++).i * LANES;
+            src = LGrad + (*code++).i * LANES;
+            for (int j = 0; j < nc; j++, dst += LANES, src += LANES) {
+                for (int l = 0; l < n; l++) {
+                    if (Mask[l]) {
+                        val = pSt[l] * src[l];
+                        dst[l] = dst[l] + val;
+                    }
+                }
+            }
+            pSt -= LANES;
+            break;
+        case GSEED:
+            dst = LGrad + (*code++).i * LANES;
+            for (int l = 0; l < n; l++) {
+                if (Mask[l]) {
+                    dst[l] = dst[l] + pSt[l];
+                }
+            }
+            pSt -= LANES;
+            break;
+        case IF:
+            nThen = nElse = 0;
+            for (int l = 0; l < n; l++) {
+                if (Mask[l]) {
+                    if (pSt[l] != 0) {
+                        nThen++;
+                    } else {
+                        nElse++;
+                    }
+                }
+            }
+            if (nElse == 0) {
+                if (nThen == 0) { /* no lanes left */
+                    code = (*(code + 1)).c;
+                } else { /* all lanes take the if branch */
+                    code += 2;
+                }
+            } else if (nThen == 0) { /* all lanes take the else branch */
+                code = (*code).c;
+            } else { /* lanes diverge */
+                assert(level < MAXLEVEL);
+                fr = &Frame[++level];
+                fr->els = (*code).c;
+                fr->end = (*(code + 1)).c;
+                fr->jmp = (fr->els != fr->end) ? fr->els - 2 : NULL;
+                fr->stop = fr->jmp ? fr->jmp : fr->end;
+                for (int l = 0; l < n; l++) {
+                    fr->save[l] = Mask[l];
+                    fr->cond[l] = (pSt[l] != 0) ? 1 : 0;
+                    Mask[l] &= fr->cond[l];
+                }
+                code += 2;
+            }
+            pSt -= LANES;
+            break;
+        case EOD:
+            if (Vector[kod]) {
+                [self scatterGradients:LGrad
+                                 width:LANES
+                                  kind:kod
+                                  into:jac + p0
+                                stride:ld
+                                 count:n];
+            }
+            if (sel) {
+                q++; /* next listed column */
+                iDvt = (q < nSel) ? sel[q] : nc;
+                code = Column[kod][iDvt];
+            } else {
+                iDvt++;
+            }
+            break;
+        case SOK:
+            kod++;
+            iDvt = 0;
+            jac = (kod == 1) ? jx : (kod == 2) ? ja : jp;
+            nc = (kod == 1) ? nVar : (kod == 2) ? nAux : nPar;
+            if (kod == 1 && jxf == NO) {
+                code = kindStart[3]; /* skip straight to parameter
+                                        derivatives */
+                kod++;
+                break;
+            }
+            if (kod == 3 && jpf == NO) {
+                return (nFail == 0) ? YES : NO;
+            }
+            sel = NULL;
+            if (Column[kod] && kod != 2) { /* only forward mode is skipped */
+                sel = (kod == 1) ? xc : pc;
+                nSel = (kod == 1) ? nxc : npc;
+            }
+            if (sel) {
+                q = 0; /* first listed column */
+                iDvt = (nSel > 0) ? sel[0] : nc;
+                code = Column[kod][iDvt];
+            }
+            break;
+        case SOP:
+            break;
+        case SOD:
+            if (jxf == NO && jpf == NO) {
+                return (nFail == 0) ? YES : NO; /* residuals only */
+            }
+            break;
+        case JMP:
+            code = (*code).c;
+            break;
+        }
+    }
+    return (nFail == 0) ? YES : NO;
+}
+
+/* ========================================================================== */
+
+/**
+ @brief Number of instructions of the linked code in a segment of the
+ profile
+
+ @param s segment
+ @return number of instructions
+ */
+- (int)instructionsOfSegment:(int)s {
+    CODE *lc = kindStart[0];
+    int n = 0;
+
+    for (int k = SegFirst[s]; k < SegFirst[s + 1];
+         k += LINKED_LENGTH(lc[k].o)) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ @brief Lines of the model file by their cost in a profile
+
+ @discussion    The time of a segment is corrected for the time of reading
+ the clock, and goes to the line of its first instruction. Each entry holds
+ the line, 0 for code that belongs to no single statement, the number of
+ instructions executed and their time in seconds, in total and in the
+ function code and the derivatives to the variables, auxillary variables
+ and parameters. Lines that were not executed are left out. A model code
+ without a source map has line 0 only.
+
+ @param ws profiled workspace
+ @return entries "line", "count", "time", "function", "var", "aux" and
+ "par", by decreasing time
+ */
+- (NSArray<NSDictionary<NSString *, NSNumber *> *> *)profileLinesOfWorkspace:
+    (PXModelWorkspace *)ws {
+    NSMutableArray *lines = [[NSMutableArray alloc] init];
+    double *prof = [ws profile];
+    double clock, *count, *time;
+    int l;
+
+    if (!prof || !SegFirst) {
+        return lines;
+    }
+    count = (double *)calloc(5 * nLine, sizeof(double));
+    if (!count) {
+        return lines;
+    }
+    time = count + nLine; /* by kind (index as kod) and line */
+    clock = prof[2 * nSegment];
+    for (int s = 0; s < nSegment; s++) {
+        l = Line[SegFirst[s]];
+        count[l] += prof[2 * s] * [self instructionsOfSegment:s];
+        time[SegKind[s] * nLine + l] +=
+            fmax(prof[2 * s + 1] - clock * prof[2 * s], 0);
+    }
+    for (l = 0; l < nLine; l++) {
+        if (count[l] == 0) {
+            continue;
+        }
+        [lines addObject:@{
+            @"line" : @(l),
+            @"count" : @(count[l]),
+            @"time" : @(time[l] + time[nLine + l] + time[2 * nLine + l] +
+                        time[3 * nLine + l]),
+            @"function" : @(time[l]),
+            @"var" : @(time[nLine + l]),
+            @"aux" : @(time[2 * nLine + l]),
+            @"par" : @(time[3 * nLine + l])
+        }];
+    }
+    free(count);
+    [lines sortUsingDescriptors:@[ [NSSortDescriptor
+                                    sortDescriptorWithKey:@"time"
+                                                ascending:NO] ]];
+    return lines;
+}
+
+/**
+ @brief Operators by their cost in a profile
+
+ @discussion    As profileLinesOfWorkspace:, per operator of the linked
+ code. The time of a segment is shared equally by its instructions.
+
+ @param ws profiled workspace
+ @return entries "operator", "count" and "time", by decreasing time
+ */
+- (NSArray<NSDictionary<NSString *, NSNumber *> *> *)
+    profileOperatorsOfWorkspace:(PXModelWorkspace *)ws {
+    NSMutableArray *operators = [[NSMutableArray alloc] init];
+    double *prof = [ws profile];
+    CODE *lc = kindStart[0];
+    double clock, time, count[PROF_OPR] = {0}, times[PROF_OPR] = {0};
+
+    if (!prof || !SegFirst) {
+        return operators;
+    }
+    clock = prof[2 * nSegment];
+    for (int s = 0; s < nSegment; s++) {
+        time = fmax(prof[2 * s + 1] - clock * prof[2 * s], 0) /
+               [self instructionsOfSegment:s];
+        for (int k = SegFirst[s]; k < SegFirst[s + 1];
+             k += LINKED_LENGTH(lc[k].o)) {
+            count[lc[k].o] += prof[2 * s];
+            times[lc[k].o] += time;
+        }
+    }
+    for (int o = 0; o < PROF_OPR; o++) {
+        if (count[o] == 0) {
+            continue;
+        }
+        [operators addObject:@{
+            @"operator" : @(o),
+            @"count" : @(count[o]),
+            @"time" : @(times[o])
+        }];
+    }
+    [operators sortUsingDescriptors:@[ [NSSortDescriptor
+                                        sortDescriptorWithKey:@"time"
+                                                    ascending:NO] ]];
+    return operators;
+}
+
+@end
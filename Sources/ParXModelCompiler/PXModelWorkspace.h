@@ -0,0 +1,56 @@
+//
+// PXModelWorkspace.h
+// ParXModelCompiler
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef _PXModelWorkspace_h
+#define _PXModelWorkspace_h
+
+#import "prx_def.h"
+
+@class PXModelProgram;
+
+@interface PXModelWorkspace : NSObject
+
+@property int errorCode;
+@property BOOL staged;
+@property BOOL profiling;
+
+- (nullable PXModelWorkspace *)initWithProgram:
+    (nonnull PXModelProgram *)program;
+
+- (nonnull double *)stack;
+- (nullable double *)tmp;
+- (nullable double *)dTmp;
+- (nullable double *)gradient;
+- (nonnull int *)columns;
+- (nonnull double *)tangent;
+- (nonnull void *)tape;
+- (nullable double *)profile;
+- (nonnull double *)stageInputs;
+- (void)resetProfile;
+
+- (nonnull double *)laneStack;
+- (nullable double *)laneTmp;
+- (nullable double *)laneDTmp;
+- (nullable double *)laneGradient;
+
+@end
+
+#endif
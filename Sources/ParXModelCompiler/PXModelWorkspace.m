@@ -0,0 +1,279 @@
+//
+// PXModelWorkspace.m
+// ParXModelCompiler
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+#import "PXModelWorkspace.h"
+#import "PXModelProgram.h"
+
+/**
+ @brief Scratch storage for the evaluation of a PXModelProgram
+
+ @discussion    A workspace must not be used by two threads at the same time.
+ The lane buffers for batched evaluation, the tangents for second
+ derivatives, the tape for adjoints and the profile are allocated on first
+ use. <br>
+ While staged is set, the temporaries hold the parameter stage of the
+ parameters, constants and flags last passed to evaluateStageForPar: of the
+ program, kept in the stage inputs, and evaluations with the same values
+ skip the stage; other values evaluate it again. Reset it to evaluate the
+ stage with every evaluation again. <br>
+ While profiling is set, the evaluations of the program count and time
+ the segments of its register code in the profile, which adds up until it
+ is reset.
+ */
+@implementation PXModelWorkspace {
+
+    /** number of temporaries */
+    int nTmp;
+
+    /** maximum depth of the operand stack */
+    int nDepth;
+
+    /** size of the gradients, for derivatives in vector mode */
+    int nGrad;
+
+    /** number of variables and parameters */
+    int nCol;
+
+    /** size of the tangents, for second derivatives */
+    int nTan;
+
+    /** size in bytes of the tape, for adjoints */
+    size_t nTape;
+
+    /** size of the profile */
+    int nProf;
+
+    /** size of the inputs of the parameter stage */
+    int nStage;
+
+    /** operand stack */
+    double *Stack;
+
+    /** pointer to temporaries store */
+    double *Tmp;
+
+    /** pointer to deriv. of temporaries */
+    double *DTmp;
+
+    /** gradients of temporaries and residuals */
+    double *Grad;
+
+    /** lists of columns, of the variables then of the parameters */
+    int *Col;
+
+    /** parameters, constants and flags of the parameter stage */
+    double *StageIn;
+
+    /** tangents of the values, allocated on first use */
+    double *Tan;
+
+    /** tape of the function code and adjoints, allocated on first use */
+    void *Tape;
+
+    /** counts and times of the profiled segments, allocated on first
+     * use */
+    double *Prof;
+
+    /** lane operand stack for batches */
+    double *LStack;
+
+    /** lane temporaries for batches */
+    double *LTmp;
+
+    /** lane deriv. of temporaries for batches */
+    double *LDTmp;
+
+    /** lane gradients for batches */
+    double *LGrad;
+}
+
+/**
+ @brief Initialize for a linked program
+
+ @param program linked interpreter code
+ */
+- (PXModelWorkspace *)initWithProgram:(PXModelProgram *)program {
+
+    self = [super init];
+    if (self) {
+        nTmp = [program numberOfTemp];
+        nDepth = [program stackDepth];
+        nGrad = [program gradientSize];
+        nCol = [program numberOfColumns];
+        nTan = [program tangentSize];
+        nTape = [program tapeSize];
+        nProf = [program profileSize];
+        nStage = [program stageInputSize];
+
+        if (nTmp > 0) {
+            Tmp = (double *)calloc(nTmp, sizeof(double));
+            DTmp = (double *)calloc(nTmp, sizeof(double));
+        } else {
+            Tmp = NULL;
+            DTmp = NULL;
+        }
+
+        if (nGrad > 0) {
+            Grad = (double *)calloc(nGrad, sizeof(double));
+        } else {
+            Grad = NULL;
+        }
+
+        Stack = (double *)calloc(nDepth + 1, sizeof(double));
+        Col = (int *)calloc(nCol + 1, sizeof(int));
+        StageIn = (double *)calloc(nStage + 1, sizeof(double));
+
+        Tan = NULL;
+        Tape = NULL;
+        Prof = NULL;
+        LStack = NULL; /* lane buffers are allocated on first use */
+        LTmp = NULL;
+        LDTmp = NULL;
+        LGrad = NULL;
+
+        _errorCode = 0;
+        _staged = NO;
+        _profiling = NO;
+    }
+    return self;
+}
+
+- (void)dealloc {
+
+    free(Tmp);
+    free(DTmp);
+    free(Grad);
+    free(Stack);
+    free(Col);
+    free(StageIn);
+    free(Tan);
+    free(Tape);
+    free(Prof);
+    free(LStack);
+    free(LTmp);
+    free(LDTmp);
+    free(LGrad);
+}
+
+- (double *)stack {
+    return Stack;
+}
+
+- (double *)tmp {
+    return Tmp;
+}
+
+- (double *)dTmp {
+    return DTmp;
+}
+
+- (double *)gradient {
+    return Grad;
+}
+
+- (int *)columns {
+    return Col;
+}
+
+- (double *)stageInputs {
+    return StageIn;
+}
+
+- (double *)tangent {
+    if (!Tan) {
+        Tan = (double *)calloc(nTan + 1, sizeof(double));
+    }
+    return Tan;
+}
+
+- (void *)tape {
+    if (!Tape) {
+        Tape = calloc(nTape + sizeof(double), 1);
+    }
+    return Tape;
+}
+
+/**
+ @brief Profile of the evaluations
+
+ @return profile, NULL when never profiled
+ */
+- (double *)profile {
+    if (!Prof && _profiling) {
+        Prof = (double *)calloc(nProf + 1, sizeof(double));
+    }
+    return Prof;
+}
+
+/**
+ @brief Clear the counts and times of the profile
+ */
+- (void)resetProfile {
+    if (Prof) {
+        memset(Prof, 0, nProf * sizeof(double));
+    }
+}
+
+/**
+ @brief Allocate the lane buffers for batched evaluation
+ */
+- (void)allocateLanes {
+
+    LStack = (double *)calloc((nDepth + 1) * LANES, sizeof(double));
+    if (nTmp > 0) {
+        LTmp = (double *)calloc(nTmp * LANES, sizeof(double));
+        LDTmp = (double *)calloc(nTmp * LANES, sizeof(double));
+    }
+    if (nGrad > 0) {
+        LGrad = (double *)calloc(nGrad * LANES, sizeof(double));
+    }
+}
+
+- (double *)laneStack {
+    if (!LStack) {
+        [self allocateLanes];
+    }
+    return LStack;
+}
+
+- (double *)laneTmp {
+    if (!LStack) {
+        [self allocateLanes];
+    }
+    return LTmp;
+}
+
+- (double *)laneDTmp {
+    if (!LStack) {
+        [self allocateLanes];
+    }
+    return LDTmp;
+}
+
+- (double *)laneGradient {
+    if (!LStack) {
+        [self allocateLanes];
+    }
+    return LGrad;
+}
+
+@end
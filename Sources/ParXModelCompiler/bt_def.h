@@ -49,7 +49,7 @@ struct BT_HEAD {
 
 extern struct BT_HEAD *bt_define_tree(struct MEM_TREE *,
                                       int (*)(void *, void *));
-extern int bt_traverse(struct BT_HEAD *, int (*)(char *));
+extern int bt_traverse(struct BT_HEAD *, int (*)(char *, void *), void *);
 
 extern int bt_insert(struct BT_HEAD *head, char *rec);
 
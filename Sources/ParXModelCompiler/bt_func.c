@@ -26,9 +26,18 @@
 #define E_BALANCE 1
 #define SYS_S_MEM (-3)
 
+/* state of an insertion, passed down the recursion */
+struct BT_INSERT {
+    struct BT_HEAD *hh;         /* binary tree */
+    int (*cmp)(void *, void *); /* compare function */
+    char *crec;                 /* record to insert */
+    int vflag;                  /* height of partial tree has changed */
+    int mem_ovfl;               /* memory overflow */
+};
+
 /* local functions */
-static int traverse(struct BT_ITEM *, int (*act)(char *));
-static struct BT_ITEM *insert(struct BT_ITEM *);
+static int traverse(struct BT_ITEM *, int (*act)(char *, void *), void *);
+static struct BT_ITEM *insert(struct BT_INSERT *, struct BT_ITEM *);
 
 /**
  @brief initialize a binary tree
@@ -59,13 +68,15 @@ struct BT_HEAD *bt_define_tree(struct MEM_TREE *tptr,
 
  @param head   root of binary tree
  @param action function to perform
+ @param ctx    context passed to the function
  @return status, 0 is ok
  **/
-int bt_traverse(struct BT_HEAD *head, int (*action)(char *)) {
-    int (*act)(char *);
+int bt_traverse(struct BT_HEAD *head, int (*action)(char *, void *),
+                void *ctx) {
+    int (*act)(char *, void *);
 
     act = action;
-    return (traverse(head->wu, act));
+    return (traverse(head->wu, act, ctx));
 }
 
 /**
@@ -75,36 +86,31 @@ int bt_traverse(struct BT_HEAD *head, int (*action)(char *)) {
 
  @param p   leaf of binary tree
  @param act function to perform
+ @param ctx context passed to the function
  @return status, 0 is ok
  **/
-static int traverse(struct BT_ITEM *p, int (*act)(char *)) {
+static int traverse(struct BT_ITEM *p, int (*act)(char *, void *),
+                    void *ctx) {
     int stat;
 
     if (p == NULL) {
         return 0;
     }
-    stat = traverse(p->li, act);
+    stat = traverse(p->li, act, ctx);
     if (stat) {
         return stat;
     }
-    stat = (*act)(p->inh);
+    stat = (*act)(p->inh, ctx);
     if (stat) {
         return stat;
     }
-    stat = traverse(p->re, act);
+    stat = traverse(p->re, act, ctx);
     if (stat) {
         return stat;
     }
     return 0;
 }
 
-/* local data */
-static struct BT_HEAD *hh;
-static int (*cmp)(void *, void *);
-static char *crec;
-static int vflag;
-static int mem_ovfl;
-
 /**
  @brief insert a node in a binary tree
 
@@ -114,20 +120,22 @@ static int mem_ovfl;
  */
 int bt_insert(struct BT_HEAD *head, char *rec) {
     struct BT_ITEM *p;
+    struct BT_INSERT ins;
 
-    hh = head;
-    cmp = hh->cmp;
-    crec = rec;
-    mem_ovfl = 0;
-    p = insert(hh->wu);
+    ins.hh = head;
+    ins.cmp = head->cmp;
+    ins.crec = rec;
+    ins.vflag = 0;
+    ins.mem_ovfl = 0;
+    p = insert(&ins, head->wu);
     if (p == NULL) {
-        if (mem_ovfl) {
+        if (ins.mem_ovfl) {
             return SYS_S_MEM;
         } else {
             return BT_S_EXISTS;
         }
     }
-    hh->wu = p;
+    head->wu = p;
     return 0;
 }
 
@@ -136,42 +144,44 @@ int bt_insert(struct BT_HEAD *head, char *rec) {
 
  @discussion internal recursive function
 
+ @param ins state of the insertion
  @param p   leaf of binary tree
  @return pointer to parent leaf
  */
 static struct BT_ITEM *
-insert(struct BT_ITEM *p) { /* recursive helper function */
+insert(struct BT_INSERT *ins, struct BT_ITEM *p) { /* recursive helper */
     struct BT_ITEM *p1, *p2;
     int f;
 
-    vflag = 0; /* same level */
+    ins->vflag = 0; /* same level */
     if (p == NULL) {
         /* create new element */
-        if (hh->fp != NULL) {
-            p1 = hh->fp;
-            hh->fp = (hh->fp)->li;
+        if (ins->hh->fp != NULL) {
+            p1 = ins->hh->fp;
+            ins->hh->fp = (ins->hh->fp)->li;
         } else {
-            p1 = (struct BT_ITEM *)mem_slot(hh->tptr, sizeof(struct BT_ITEM));
+            p1 = (struct BT_ITEM *)mem_slot(ins->hh->tptr,
+                                            sizeof(struct BT_ITEM));
             if (p1 == NULL) {
-                mem_ovfl = 1;
+                ins->mem_ovfl = 1;
                 return NULL;
             }
         }
         p1->li = NULL;
         p1->re = NULL;
-        p1->inh = crec;
+        p1->inh = ins->crec;
         p1->fl = 0;
-        vflag = 1;
+        ins->vflag = 1;
         return p1;
     }
-    if ((*cmp)(crec, p->inh) == 0) {
+    if ((*ins->cmp)(ins->crec, p->inh) == 0) {
         return NULL;
     }
-    if ((*cmp)(crec, p->inh) < 0) {
-        p1 = insert(p->li);
+    if ((*ins->cmp)(ins->crec, p->inh) < 0) {
+        p1 = insert(ins, p->li);
         f = -1;
     } else {
-        p1 = insert(p->re);
+        p1 = insert(ins, p->re);
         f = 1;
     }
     if (p1 == NULL) {
@@ -182,7 +192,7 @@ insert(struct BT_ITEM *p) { /* recursive helper function */
     } else {
         p->li = p1;
     }
-    if (vflag == 0) {
+    if (ins->vflag == 0) {
         return p; /* same level */
     }
     if (p->fl == 0) {
@@ -194,7 +204,7 @@ insert(struct BT_ITEM *p) { /* recursive helper function */
     if (p->fl > 0) { /* partial tree is right heavy */
         if (f < 0) {
             p->fl = 0;
-            vflag = 0;
+            ins->vflag = 0;
             return p;
         }
         if (p1->fl > 0) {
@@ -202,7 +212,7 @@ insert(struct BT_ITEM *p) { /* recursive helper function */
             p1->li = p;
             p->fl = 0;
             p1->fl = 0;
-            vflag = 0;
+            ins->vflag = 0;
             return p1;
         } else {
             p2 = p1->li;
@@ -223,7 +233,7 @@ insert(struct BT_ITEM *p) { /* recursive helper function */
     } else { /* partial tree is left heavy */
         if (f > 0) {
             p->fl = 0;
-            vflag = 0;
+            ins->vflag = 0;
             return p;
         }
         if (p1->fl < 0) {
@@ -231,7 +241,7 @@ insert(struct BT_ITEM *p) { /* recursive helper function */
             p1->re = p;
             p->fl = 0;
             p1->fl = 0;
-            vflag = 0;
+            ins->vflag = 0;
             return p1;
         } else {
             p2 = p1->re;
@@ -251,7 +261,7 @@ insert(struct BT_ITEM *p) { /* recursive helper function */
         }
     }
     p2->fl = 0;
-    vflag = 0;
+    ins->vflag = 0;
     return p2;
 }
 
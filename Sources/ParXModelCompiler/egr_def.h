@@ -0,0 +1,69 @@
+//
+// egr_def.h
+// ParXModelCompiler
+//
+// Header file for the equality saturation of expressions
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef _EGR_DEF_H
+#define _EGR_DEF_H
+
+#include "prx_def.h"
+
+/* default budget of the rewriting of one expression */
+#define EGR_MAXNODES 2000
+#define EGR_MAXITER 8
+#define EGR_MAXTIME 0 /* no time limit, the result is deterministic */
+/* relative cost of an operator in the parameter stage */
+#define EGR_STAGE 0.01
+
+/* budget of the rewriting, rewriting stops when one is exceeded */
+struct EGR_BUDGET {
+    int maxNodes;   /* number of e-nodes */
+    int maxIter;    /* number of rounds of rewriting */
+    double maxTime; /* processor time of the thread in seconds, 0 - none */
+};
+
+/* node of an extracted expression, operands come before their operator */
+struct EGR_TERM {
+    OPR opr;
+    int o1, o2;     /* terms of the operands, -1 for none */
+    PRX_NODE *leaf; /* operand, or subexpression that is not rewritten */
+    double val;     /* value of a number */
+};
+
+/*
+ * The e-graph holds classes of expressions of equal value. An expression
+ * is added with egr_expression, the classes are grown by the rewrite
+ * rules in egr_saturate, and egr_extract gives the expression of a class
+ * with the lowest cost per egr_cost.
+ */
+
+struct EGR_GRAPH;
+
+extern struct EGR_GRAPH *egr_new(const struct EGR_BUDGET *budget);
+extern void egr_free(struct EGR_GRAPH *g);
+extern int egr_expression(struct EGR_GRAPH *g, PRX_NODE *p,
+                          const int *tmpStage);
+extern int egr_saturate(struct EGR_GRAPH *g);
+extern double egr_cost(OPR opr);
+extern double egr_extract(struct EGR_GRAPH *g, int cls,
+                          struct EGR_TERM **term, int *nTerm);
+
+#endif
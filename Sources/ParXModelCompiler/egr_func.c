@@ -0,0 +1,951 @@
+//
+// egr_func.c
+// ParXModelCompiler
+//
+// Equality saturation of expressions, with extraction by cost
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include <time.h>
+
+#include "egr_def.h"
+#include "pev_def.h"
+
+/* e-node: an operator on classes, or a leaf */
+struct EGR_NODE {
+    OPR opr;
+    int a, b;       /* classes of the operands, -1 for none */
+    PRX_NODE *leaf; /* leaf that is not a number */
+    double val;     /* value of a number */
+    int cls;        /* class it was created in */
+    int next;       /* next e-node of the class, in this round */
+    int stage;      /* leaf of the parameter stage */
+};
+
+/* translated node of the parse tree */
+struct EGR_MEMO {
+    PRX_NODE *p;
+    int cls;
+};
+
+struct EGR_GRAPH {
+    struct EGR_BUDGET budget;
+    struct EGR_NODE *node; /* e-nodes, in order of creation */
+    int *parent;           /* union-find of the classes */
+    int nNode, mNode;      /* number of e-nodes, allocated */
+    int *hash;             /* e-nodes by operator and operands, -1 free */
+    int mHash;             /* size of the hash table, a power of 2 */
+    struct EGR_MEMO *memo; /* parse tree nodes by address, p NULL free */
+    int nMemo, mMemo;
+    int *head;             /* first e-node per class, in this round */
+    double *num;           /* value of a class, in this round */
+    char *isNum;           /* class has a number, in this round */
+    int nHead;             /* classes indexed in this round */
+    int nUnion;            /* classes merged in this round */
+    int error;             /* out of memory */
+    const int *tmpStage;   /* temporaries of the parameter stage */
+    char *stage;           /* class has a value of the parameter stage */
+    double *cost;          /* lowest cost per class, in extraction */
+    int *best;             /* e-node of lowest cost per class */
+    int *term;             /* term per class, in extraction */
+};
+
+/**
+ @brief number of operands of an operator that is rewritten
+
+ @param opr operator
+ @return 1 or 2, 0 for a leaf
+ */
+static int arity(OPR opr) {
+    switch (opr) {
+    case AND:
+    case OR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NE:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+        return 2;
+    case NOT:
+    case NEG:
+    case REV:
+    case SQR:
+    case INC:
+    case DEC:
+    case SIN:
+    case COS:
+    case TAN:
+    case ASIN:
+    case ACOS:
+    case ATAN:
+    case SINH:
+    case COSH:
+    case TANH:
+    case ERF:
+    case EXP:
+    case LOG:
+    case LG:
+    case SQRT:
+    case ABS:
+    case SGN:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ @brief cost of an operator in the interpreter, in units of an addition
+
+ @param opr operator
+ @return cost
+ */
+double egr_cost(OPR opr) {
+    switch (opr) {
+    case MUL:
+    case SQR:
+        return 2;
+    case DIV:
+    case REV:
+        return 8;
+    case SQRT:
+        return 12;
+    case EXP:
+    case LOG:
+    case LG:
+        return 30;
+    case SIN:
+    case COS:
+    case TAN:
+    case ASIN:
+    case ACOS:
+    case ATAN:
+    case SINH:
+    case COSH:
+    case TANH:
+    case ERF:
+        return 40;
+    case POW:
+        return 60;
+    default:
+        return 1;
+    }
+}
+
+/* ========================================================================== */
+
+static int find(struct EGR_GRAPH *g, int c) {
+    while (g->parent[c] != c) {
+        g->parent[c] = g->parent[g->parent[c]];
+        c = g->parent[c];
+    }
+    return c;
+}
+
+static unsigned hash_key(OPR opr, int a, int b, PRX_NODE *leaf, double val) {
+    uint64_t h, v;
+
+    memcpy(&v, &val, sizeof(v));
+    h = (uint64_t)opr * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)(a + 1) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= (uint64_t)(b + 1) * 0x165667B19E3779F9ULL;
+    h ^= (uint64_t)(uintptr_t)leaf * 0x27D4EB2F165667C5ULL;
+    h ^= v * 0x94D049BB133111EBULL;
+    return (unsigned)(h ^ (h >> 29) ^ (h >> 47));
+}
+
+/**
+ @brief e-node with an operator and operand classes
+
+ @param g graph
+ @return index of the e-node, -1 when absent
+ */
+static int lookup(struct EGR_GRAPH *g, OPR opr, int a, int b, PRX_NODE *leaf,
+                  double val) {
+    struct EGR_NODE *e;
+    unsigned mask = (unsigned)g->mHash - 1;
+    unsigned k = hash_key(opr, a, b, leaf, val) & mask;
+
+    for (; g->hash[k] >= 0; k = (k + 1) & mask) {
+        e = g->node + g->hash[k];
+        if (e->opr == opr && e->leaf == leaf && e->val == val &&
+            (e->a < 0 ? -1 : find(g, e->a)) == a &&
+            (e->b < 0 ? -1 : find(g, e->b)) == b) {
+            return g->hash[k];
+        }
+    }
+    return -1;
+}
+
+static void insert(struct EGR_GRAPH *g, int i) {
+    struct EGR_NODE *e = g->node + i;
+    unsigned mask = (unsigned)g->mHash - 1;
+    unsigned k = hash_key(e->opr, e->a, e->b, e->leaf, e->val) & mask;
+
+    while (g->hash[k] >= 0) {
+        k = (k + 1) & mask;
+    }
+    g->hash[k] = i;
+}
+
+/**
+ @brief hash table with the e-nodes, by their canonical operands
+
+ @param g graph
+ @return number of e-nodes found equal to an earlier one
+ */
+static int rehash(struct EGR_GRAPH *g) {
+    struct EGR_NODE *e;
+    int j, merged = 0;
+
+    for (int k = 0; k < g->mHash; k++) {
+        g->hash[k] = -1;
+    }
+    for (int i = 0; i < g->nNode; i++) {
+        e = g->node + i;
+        if (e->a >= 0) {
+            e->a = find(g, e->a);
+        }
+        if (e->b >= 0) {
+            e->b = find(g, e->b);
+        }
+        j = lookup(g, e->opr, e->a, e->b, e->leaf, e->val);
+        if (j < 0) {
+            insert(g, i);
+        } else if (find(g, g->node[j].cls) != find(g, e->cls)) {
+            g->parent[find(g, e->cls)] = find(g, g->node[j].cls);
+            merged++;
+        }
+    }
+    return merged;
+}
+
+static int grow(struct EGR_GRAPH *g) {
+    int m = 2 * g->mNode;
+    void *p;
+
+    if (!(p = realloc(g->node, m * sizeof(struct EGR_NODE)))) {
+        return 0;
+    }
+    g->node = p;
+    if (!(p = realloc(g->parent, m * sizeof(int)))) {
+        return 0;
+    }
+    g->parent = p;
+    free(g->hash);
+    g->mHash = 4 * m;
+    if (!(g->hash = malloc(g->mHash * sizeof(int)))) {
+        return 0;
+    }
+    g->mNode = m;
+    rehash(g);
+    return 1;
+}
+
+/**
+ @brief class of an e-node, added when new
+
+ @param g graph
+ @param opr operator
+ @param a class of the first operand, -1 for none
+ @param b class of the second operand, -1 for none
+ @param leaf leaf that is not a number, NULL for others
+ @param val value of a number
+ @return class, -1 on error
+ */
+static int add(struct EGR_GRAPH *g, OPR opr, int a, int b, PRX_NODE *leaf,
+               double val) {
+    struct EGR_NODE *e;
+    int i;
+
+    if (g->error) {
+        return -1;
+    }
+    a = (a < 0) ? -1 : find(g, a);
+    b = (b < 0) ? -1 : find(g, b);
+    i = lookup(g, opr, a, b, leaf, val);
+    if (i >= 0) {
+        return find(g, g->node[i].cls);
+    }
+    if (g->nNode == g->mNode && !grow(g)) {
+        g->error = 1;
+        return -1;
+    }
+    i = g->nNode++;
+    e = g->node + i;
+    e->opr = opr;
+    e->a = a;
+    e->b = b;
+    e->leaf = leaf;
+    e->val = val;
+    e->cls = i;
+    e->next = -1;
+    e->stage = (opr == NUM);
+    g->parent[i] = i;
+    insert(g, i);
+    return i;
+}
+
+static int mk(struct EGR_GRAPH *g, OPR opr, int a, int b) {
+    if (a < 0 || (arity(opr) == 2 && b < 0)) {
+        return -1;
+    }
+    return add(g, opr, a, b, NULL, 0.0);
+}
+
+static int num(struct EGR_GRAPH *g, double val) {
+    if (!isfinite(val)) {
+        return -1;
+    }
+    return add(g, NUM, -1, -1, NULL, val == 0 ? 0.0 : val);
+}
+
+/* the classes c and x are equal */
+static void same(struct EGR_GRAPH *g, int c, int x) {
+    if (x < 0) {
+        return;
+    }
+    c = find(g, c);
+    x = find(g, x);
+    if (c != x) {
+        g->parent[c > x ? c : x] = c < x ? c : x;
+        g->nUnion++;
+    }
+}
+
+/* ========================================================================== */
+
+/**
+ @brief new e-graph
+
+ @param budget budget of the rewriting, NULL for the default
+ @return graph, NULL on error
+ */
+struct EGR_GRAPH *egr_new(const struct EGR_BUDGET *budget) {
+    struct EGR_GRAPH *g = calloc(1, sizeof(struct EGR_GRAPH));
+
+    if (!g) {
+        return NULL;
+    }
+    if (budget) {
+        g->budget = *budget;
+    } else {
+        g->budget.maxNodes = EGR_MAXNODES;
+        g->budget.maxIter = EGR_MAXITER;
+        g->budget.maxTime = EGR_MAXTIME;
+    }
+    g->mNode = 64;
+    g->mHash = 4 * g->mNode;
+    g->mMemo = 64;
+    g->node = malloc(g->mNode * sizeof(struct EGR_NODE));
+    g->parent = malloc(g->mNode * sizeof(int));
+    g->hash = malloc(g->mHash * sizeof(int));
+    g->memo = calloc(g->mMemo, sizeof(struct EGR_MEMO));
+    if (!g->node || !g->parent || !g->hash || !g->memo) {
+        egr_free(g);
+        return NULL;
+    }
+    for (int k = 0; k < g->mHash; k++) {
+        g->hash[k] = -1;
+    }
+    return g;
+}
+
+void egr_free(struct EGR_GRAPH *g) {
+    if (!g) {
+        return;
+    }
+    free(g->node);
+    free(g->parent);
+    free(g->hash);
+    free(g->memo);
+    free(g->head);
+    free(g->num);
+    free(g->isNum);
+    free(g->stage);
+    free(g->cost);
+    free(g->best);
+    free(g->term);
+    free(g);
+}
+
+static struct EGR_MEMO *memo_slot(struct EGR_GRAPH *g, PRX_NODE *p) {
+    unsigned mask = (unsigned)g->mMemo - 1;
+    unsigned k = hash_key(INVAL, 0, 0, p, 0.0) & mask;
+
+    while (g->memo[k].p && g->memo[k].p != p) {
+        k = (k + 1) & mask;
+    }
+    return g->memo + k;
+}
+
+static int memo_grow(struct EGR_GRAPH *g) {
+    struct EGR_MEMO *old = g->memo;
+    int m = g->mMemo;
+
+    if (!(g->memo = calloc(2 * m, sizeof(struct EGR_MEMO)))) {
+        g->memo = old;
+        return 0;
+    }
+    g->mMemo = 2 * m;
+    for (int k = 0; k < m; k++) {
+        if (old[k].p) {
+            *memo_slot(g, old[k].p) = old[k];
+        }
+    }
+    free(old);
+    return 1;
+}
+
+/**
+ @brief leaf of the parameter stage
+
+ @param g graph
+ @param p operand
+ @return 1 - value of the parameter stage, 0 - other
+ */
+static int is_stage(struct EGR_GRAPH *g, PRX_NODE *p) {
+    if (p->opr != OPD) {
+        return 0;
+    }
+    switch (p->c.optr->typ) {
+    case PAR:
+    case CON:
+    case FLG:
+        return 1;
+    case TMP:
+        return g->tmpStage && g->tmpStage[p->c.optr->ind];
+    default:
+        return 0;
+    }
+}
+
+static int translate(struct EGR_GRAPH *g, PRX_NODE *p) {
+    struct EGR_MEMO *m;
+    int a, b = -1, cls;
+
+    while (p->opr == EQU) {
+        p = p->o1;
+    }
+    m = memo_slot(g, p);
+    if (m->p) {
+        return m->cls;
+    }
+    if (!arity(p->opr)) {
+        if (p->opr == NUM) {
+            cls = num(g, p->c.nptr->val);
+        } else if ((cls = add(g, p->opr, -1, -1, p, 0.0)) >= 0) {
+            g->node[cls].stage = is_stage(g, p);
+        }
+    } else {
+        if ((a = translate(g, p->o1)) < 0) {
+            return -1;
+        }
+        if (arity(p->opr) == 2 && (b = translate(g, p->c.o2)) < 0) {
+            return -1;
+        }
+        cls = mk(g, p->opr, a, b);
+    }
+    if (cls < 0) {
+        return -1;
+    }
+    if (2 * (g->nMemo + 1) > g->mMemo && !memo_grow(g)) {
+        g->error = 1;
+        return -1;
+    }
+    m = memo_slot(g, p);
+    m->p = p;
+    m->cls = cls;
+    g->nMemo++;
+    return cls;
+}
+
+/**
+ @brief class of an expression, added to the graph
+
+ @discussion Numbers are leaves by value. Operands, and operators that are
+ not rewritten, are leaves by their node. Shared subexpressions are added
+ once.
+
+ @param g graph
+ @param p expression
+ @param tmpStage per temporary: 1 - assigned in the parameter stage, NULL
+ for no parameter stage
+ @return class, -1 on error
+ */
+int egr_expression(struct EGR_GRAPH *g, PRX_NODE *p, const int *tmpStage) {
+    g->tmpStage = tmpStage;
+    return translate(g, p);
+}
+
+/* ========================================================================== */
+
+/**
+ @brief members and numbers of the classes, for the rules of this round
+
+ @param g graph
+ @return 0 - error, 1 - success
+ */
+static int index_classes(struct EGR_GRAPH *g) {
+    int r;
+
+    free(g->head);
+    free(g->num);
+    free(g->isNum);
+    g->nHead = g->nNode;
+    g->head = malloc(g->nHead * sizeof(int));
+    g->num = malloc(g->nHead * sizeof(double));
+    g->isNum = calloc(g->nHead, 1);
+    if (!g->head || !g->num || !g->isNum) {
+        return 0;
+    }
+    for (int c = 0; c < g->nHead; c++) {
+        g->head[c] = -1;
+    }
+    for (int i = g->nHead - 1; i >= 0; i--) {
+        r = find(g, g->node[i].cls);
+        g->node[i].next = g->head[r];
+        g->head[r] = i;
+        if (g->node[i].opr == NUM) {
+            g->isNum[r] = 1;
+            g->num[r] = g->node[i].val;
+        }
+    }
+    return 1;
+}
+
+static int first(struct EGR_GRAPH *g, int c) {
+    c = find(g, c);
+    return c < g->nHead ? g->head[c] : -1;
+}
+
+static int is_num(struct EGR_GRAPH *g, int c, double *v) {
+    c = find(g, c);
+    if (c < g->nHead && g->isNum[c]) {
+        *v = g->num[c];
+        return 1;
+    }
+    return 0;
+}
+
+static int is_val(struct EGR_GRAPH *g, int c, double val) {
+    double v;
+
+    return is_num(g, c, &v) && v == val;
+}
+
+#define MEMBERS(m, x) for (int m = first(g, x); m >= 0; m = g->node[m].next)
+#define OP(m) (g->node[m].opr)
+#define A(m) (g->node[m].a)
+#define B(m) (g->node[m].b)
+#define EQ(x, y) (find(g, x) == find(g, y))
+
+/**
+ @brief common factors and denominators of a sum or difference
+
+ @param g graph
+ @param c class of the sum or difference
+ @param opr ADD or SUB
+ @param a first term
+ @param b second term
+ */
+static void factor(struct EGR_GRAPH *g, int c, OPR opr, int a, int b) {
+    MEMBERS(m, a) {
+        if (OP(m) != MUL && OP(m) != DIV) {
+            continue;
+        }
+        MEMBERS(n, b) {
+            if (OP(n) != OP(m)) {
+                continue;
+            }
+            if (OP(m) == MUL && EQ(A(m), A(n))) {
+                /* a*b + a*c = a*(b + c) */
+                same(g, c, mk(g, MUL, A(m), mk(g, opr, B(m), B(n))));
+            } else if (OP(m) == DIV && EQ(B(m), B(n))) {
+                /* a/c + b/c = (a + b)/c */
+                same(g, c, mk(g, DIV, mk(g, opr, A(m), A(n)), B(m)));
+            }
+        }
+    }
+}
+
+/**
+ @brief rewrite rules for an e-node
+
+ @discussion The rules hold for all finite operands, as the rules of the
+ simplification of single nodes; a division cancels only by a nonzero
+ number, as x/x and (a*x)/x differ from 1 and a at x = 0. Together they reach the factorizations
+ and cancellations those cannot see: sums and products in any order,
+ common factors and denominators, and reciprocals and negations moved to
+ where they cancel.
+
+ @param g graph
+ @param i e-node
+ */
+static void rewrite(struct EGR_GRAPH *g, int i) {
+    OPR opr = g->node[i].opr;
+    int c = find(g, g->node[i].cls);
+    int a, b;
+    double x, y, v;
+
+    if (!arity(opr)) {
+        return;
+    }
+    a = find(g, g->node[i].a);
+    b = (arity(opr) == 2) ? find(g, g->node[i].b) : -1;
+
+    if (is_num(g, a, &x) && (b < 0 || is_num(g, b, &y))) {
+        if (pev_evaluate(opr, x, b < 0 ? 0 : y, &v)) {
+            same(g, c, num(g, v));
+        }
+        return;
+    }
+
+    switch (opr) {
+    case NEG:
+        MEMBERS(m, a) {
+            if (OP(m) == NEG) {
+                same(g, c, A(m));
+            } else if (OP(m) == SUB) {
+                same(g, c, mk(g, SUB, B(m), A(m)));
+            }
+        }
+        break;
+    case ADD:
+        same(g, c, mk(g, ADD, b, a));
+        if (is_val(g, b, 0)) {
+            same(g, c, a);
+        }
+        if (a == b) {
+            same(g, c, mk(g, MUL, num(g, 2), a));
+        }
+        MEMBERS(m, b) {
+            if (OP(m) == NEG) {
+                same(g, c, mk(g, SUB, a, A(m)));
+            } else if (OP(m) == ADD && is_num(g, a, &x) &&
+                       is_num(g, A(m), &y)) {
+                same(g, c, mk(g, ADD, num(g, x + y), B(m)));
+            }
+        }
+        factor(g, c, ADD, a, b);
+        break;
+    case SUB:
+        if (a == b) {
+            same(g, c, num(g, 0));
+        }
+        if (is_val(g, b, 0)) {
+            same(g, c, a);
+        }
+        if (is_val(g, a, 0)) {
+            same(g, c, mk(g, NEG, b, -1));
+        }
+        MEMBERS(m, b) {
+            if (OP(m) == NEG) {
+                same(g, c, mk(g, ADD, a, A(m)));
+            }
+        }
+        factor(g, c, SUB, a, b);
+        break;
+    case MUL:
+        same(g, c, mk(g, MUL, b, a));
+        if (is_val(g, a, 1)) {
+            same(g, c, b);
+        } else if (is_val(g, a, 0)) {
+            same(g, c, a);
+        } else if (is_val(g, a, -1)) {
+            same(g, c, mk(g, NEG, b, -1));
+        }
+        if (a == b) {
+            same(g, c, mk(g, SQR, a, -1));
+        }
+        MEMBERS(m, a) {
+            if (OP(m) == NEG) {
+                same(g, c, mk(g, NEG, mk(g, MUL, A(m), b), -1));
+            } else if (OP(m) == EXP) {
+                MEMBERS(n, b) {
+                    if (OP(n) == EXP) {
+                        same(g, c, mk(g, EXP, mk(g, ADD, A(m), A(n)), -1));
+                    }
+                }
+            }
+        }
+        MEMBERS(m, b) {
+            if (OP(m) == REV) {
+                same(g, c, mk(g, DIV, a, A(m)));
+            } else if (OP(m) == DIV) {
+                same(g, c, mk(g, DIV, mk(g, MUL, a, A(m)), B(m)));
+            } else if (OP(m) == MUL && is_num(g, a, &x) &&
+                       is_num(g, A(m), &y)) {
+                same(g, c, mk(g, MUL, num(g, x * y), B(m)));
+            }
+        }
+        break;
+    case DIV:
+        if (is_val(g, b, 1)) {
+            same(g, c, a);
+        }
+        if (is_val(g, a, 0)) {
+            same(g, c, a);
+        } else if (is_val(g, a, 1)) {
+            same(g, c, mk(g, REV, b, -1));
+        }
+        if (a == b && is_num(g, b, &x) && x != 0) {
+            same(g, c, num(g, 1));
+        }
+        MEMBERS(m, a) {
+            if (OP(m) == MUL && EQ(B(m), b) && is_num(g, b, &x) && x != 0) {
+                same(g, c, A(m));
+            } else if (OP(m) == NEG) {
+                same(g, c, mk(g, NEG, mk(g, DIV, A(m), b), -1));
+            } else if (OP(m) == DIV) {
+                same(g, c, mk(g, DIV, A(m), mk(g, MUL, B(m), b)));
+            } else if (OP(m) == EXP) {
+                MEMBERS(n, b) {
+                    if (OP(n) == EXP) {
+                        same(g, c, mk(g, EXP, mk(g, SUB, A(m), A(n)), -1));
+                    }
+                }
+            }
+        }
+        MEMBERS(m, b) {
+            if (OP(m) == NEG) {
+                same(g, c, mk(g, NEG, mk(g, DIV, a, A(m)), -1));
+            } else if (OP(m) == REV) {
+                same(g, c, mk(g, MUL, a, A(m)));
+            }
+        }
+        break;
+    case REV:
+        MEMBERS(m, a) {
+            if (OP(m) == REV) {
+                same(g, c, A(m));
+            } else if (OP(m) == DIV) {
+                same(g, c, mk(g, DIV, B(m), A(m)));
+            }
+        }
+        break;
+    case POW:
+        if (is_val(g, b, 1)) {
+            same(g, c, a);
+        } else if (is_val(g, b, 2)) {
+            same(g, c, mk(g, SQR, a, -1));
+        } else if (is_val(g, b, 0.5)) {
+            same(g, c, mk(g, SQRT, a, -1));
+        }
+        break;
+    case EXP:
+        MEMBERS(m, a) {
+            if (OP(m) == LOG) {
+                same(g, c, A(m));
+            }
+        }
+        break;
+    case LOG:
+        MEMBERS(m, a) {
+            if (OP(m) == EXP) {
+                same(g, c, A(m));
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* processor time of the calling thread in seconds */
+static double thread_time(void) {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) {
+        return 0;
+    }
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/**
+ @brief rewriting until no rule adds to the graph, or the budget is spent
+
+ @discussion The default budget counts e-nodes and rounds only, so the
+ result does not depend on the load of the machine. A time limit, if
+ set, is the processor time of the calling thread.
+
+ @param g graph
+ @return number of rounds, -1 on error
+ */
+int egr_saturate(struct EGR_GRAPH *g) {
+    double start = g->budget.maxTime > 0 ? thread_time() : 0;
+    int n, iter;
+
+    for (iter = 0; iter < g->budget.maxIter; iter++) {
+        if (g->nNode >= g->budget.maxNodes ||
+            (g->budget.maxTime > 0 &&
+             thread_time() - start > g->budget.maxTime)) {
+            break;
+        }
+        if (!index_classes(g)) {
+            g->error = 1;
+            break;
+        }
+        n = g->nNode;
+        g->nUnion = 0;
+        for (int i = 0; i < n && g->nNode < g->budget.maxNodes; i++) {
+            rewrite(g, i);
+        }
+        while (rehash(g)) {
+            /* e-nodes made equal by the merged classes are merged */
+        }
+        if (g->error || (g->nNode == n && !g->nUnion)) {
+            break;
+        }
+    }
+    return g->error ? -1 : iter;
+}
+
+/* ========================================================================== */
+
+static int emit(struct EGR_GRAPH *g, int c, struct EGR_TERM *term, int *nTerm) {
+    struct EGR_NODE *e;
+    struct EGR_TERM *t;
+    int o1 = -1, o2 = -1;
+
+    c = find(g, c);
+    if (g->term[c] >= 0) {
+        return g->term[c];
+    }
+    e = g->node + g->best[c];
+    if (e->a >= 0) {
+        o1 = emit(g, e->a, term, nTerm);
+    }
+    if (e->b >= 0) {
+        o2 = emit(g, e->b, term, nTerm);
+    }
+    t = term + *nTerm;
+    t->opr = e->opr;
+    t->o1 = o1;
+    t->o2 = o2;
+    t->leaf = e->leaf;
+    t->val = e->val;
+    return g->term[c] = (*nTerm)++;
+}
+
+/**
+ @brief classes with a value of the parameter stage
+
+ @param g graph
+ @return 0 - error, 1 - success
+ */
+static int mark_stage(struct EGR_GRAPH *g) {
+    struct EGR_NODE *e;
+    int changed, r;
+
+    free(g->stage);
+    if (!(g->stage = calloc(g->nNode, 1))) {
+        return 0;
+    }
+    do {
+        changed = 0;
+        for (int i = 0; i < g->nNode; i++) {
+            e = g->node + i;
+            r = find(g, e->cls);
+            if (!g->stage[r] &&
+                (e->stage || (arity(e->opr) && g->stage[find(g, e->a)] &&
+                              (e->b < 0 || g->stage[find(g, e->b)])))) {
+                g->stage[r] = 1;
+                changed = 1;
+            }
+        }
+    } while (changed);
+    return 1;
+}
+
+/**
+ @brief expression of lowest cost in a class
+
+ @discussion The cost of an expression is the sum of the costs of its
+ operators, a subexpression counted at each use. An operator on values of
+ the parameter stage is evaluated once per set of parameters, and costs
+ EGR_STAGE times as much. An e-node costs more than each of its operands,
+ so the chosen e-nodes form no cycle.
+
+ @param g graph
+ @param cls class
+ @param term terms of the expression, the last is its root, output,
+ NULL for the cost only; free after use
+ @param nTerm number of terms, output
+ @return cost, -1 on error
+ */
+double egr_extract(struct EGR_GRAPH *g, int cls, struct EGR_TERM **term,
+                   int *nTerm) {
+    struct EGR_NODE *e;
+    int changed, r;
+    double cost;
+
+    free(g->cost);
+    free(g->best);
+    free(g->term);
+    g->cost = malloc(g->nNode * sizeof(double));
+    g->best = malloc(g->nNode * sizeof(int));
+    g->term = malloc(g->nNode * sizeof(int));
+    if (g->error || !g->cost || !g->best || !g->term || !mark_stage(g)) {
+        return -1;
+    }
+    for (int c = 0; c < g->nNode; c++) {
+        g->cost[c] = HUGE_VAL;
+        g->term[c] = -1;
+    }
+    do {
+        changed = 0;
+        for (int i = 0; i < g->nNode; i++) {
+            e = g->node + i;
+            cost = egr_cost(e->opr);
+            if (e->a >= 0 && g->stage[find(g, e->a)] &&
+                (e->b < 0 || g->stage[find(g, e->b)])) {
+                cost *= EGR_STAGE;
+            }
+            if (e->a >= 0) {
+                cost += g->cost[find(g, e->a)];
+            }
+            if (e->b >= 0) {
+                cost += g->cost[find(g, e->b)];
+            }
+            r = find(g, e->cls);
+            if (cost < g->cost[r]) {
+                g->cost[r] = cost;
+                g->best[r] = i;
+                changed = 1;
+            }
+        }
+    } while (changed);
+
+    r = find(g, cls);
+    if (term) {
+        *nTerm = 0;
+        if (!(*term = malloc(g->nNode * sizeof(struct EGR_TERM)))) {
+            return -1;
+        }
+        emit(g, r, *term, nTerm);
+    }
+    return g->cost[r];
+}
@@ -0,0 +1,60 @@
+//
+// gen_def.h
+// ParXModelCompiler
+//
+// Header file for C source generation from interpreter code
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef _GEN_DEF_H
+#define _GEN_DEF_H
+
+#include <stdio.h>
+#include "prx_def.h"
+
+/* model code and its dimensions */
+struct GEN_MODEL {
+    const CODE *code;   /* interpreter code, ends with STOP */
+    int nCode;          /* length of code */
+    const double *num;  /* numerical constants */
+    int nNum;           /* number of numerical constants */
+    int nRes, nVar, nAux, nPar, nCon, nFlg, nTmp;
+    int reverse[3];     /* derivatives of a kind in reverse mode */
+    int vector[3];      /* derivatives of a kind in vector mode */
+};
+
+/*
+ * The generated function has the signature
+ *
+ * int name(const double *x, const double *a, const double *p,
+ *          const double *c, const double *f, double *r,
+ *          int jxf, const unsigned char *xf, double *jx, double *ja,
+ *          int jpf, const unsigned char *pf, double *jp, int *ec,
+ *          double *g);
+ *
+ * with the arguments of the interpreter, NULL flags xf or pf selecting all
+ * columns, and the error code of error() returned in ec. The scratch g
+ * holds gen_scratch_length doubles, it may be NULL when that is 0. It
+ * returns 1 on success, 0 on failure.
+ */
+
+extern int gen_scratch_length(const struct GEN_MODEL *model);
+extern int gen_c_source(FILE *out, const char *name,
+                        const struct GEN_MODEL *model);
+
+#endif
@@ -0,0 +1,764 @@
+//
+// gen_func.c
+// ParXModelCompiler
+//
+// C source generation from interpreter code
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <stdarg.h>
+#include "gen_def.h"
+
+/* growing text buffer */
+struct GEN_BUF {
+    char *s;
+    size_t len;
+    size_t cap;
+};
+
+/* state of the generation */
+struct GEN_STATE {
+    const struct GEN_MODEL *m;
+    struct GEN_BUF body; /* function body */
+    char **St;           /* operand stack of C expressions, St[0] unused */
+    int sp;              /* operand stack pointer */
+    int nSpill;          /* number of spill locals */
+    int indent;          /* indentation level */
+    int kod;             /* kind of derivatives */
+    int col;             /* index of current deriv. variable, or residual
+                            in reverse mode */
+    int nVec;            /* length of a gradient in vector mode */
+    int ok;              /* no error so far */
+};
+
+/**
+ @brief formatted output appended to a buffer
+
+ @param b buffer
+ @param fmt format
+ @param ap arguments
+ @return 0 - error, 1 - success
+ */
+static int buf_vprintf(struct GEN_BUF *b, const char *fmt, va_list ap) {
+    va_list aq;
+    int n;
+
+    va_copy(aq, ap);
+    n = vsnprintf(NULL, 0, fmt, aq);
+    va_end(aq);
+    if (n < 0) {
+        return 0;
+    }
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = 2 * (b->len + n + 1);
+        char *s = realloc(b->s, cap);
+        if (s == NULL) {
+            return 0;
+        }
+        b->s = s;
+        b->cap = cap;
+    }
+    vsnprintf(b->s + b->len, n + 1, fmt, ap);
+    b->len += n;
+    return 1;
+}
+
+/**
+ @brief formatted output appended to a buffer
+
+ @param b buffer
+ @param fmt format
+ @return 0 - error, 1 - success
+ */
+static int buf_printf(struct GEN_BUF *b, const char *fmt, ...) {
+    va_list ap;
+    int ok;
+
+    va_start(ap, fmt);
+    ok = buf_vprintf(b, fmt, ap);
+    va_end(ap);
+    return ok;
+}
+
+/**
+ @brief formatted output to a new string
+
+ @param fmt format
+ @return allocated string, NULL on error
+ */
+static char *str_printf(const char *fmt, ...) {
+    struct GEN_BUF b = {NULL, 0, 0};
+    va_list ap;
+
+    va_start(ap, fmt);
+    if (!buf_vprintf(&b, fmt, ap)) {
+        free(b.s);
+        b.s = NULL;
+    }
+    va_end(ap);
+    return b.s;
+}
+
+/**
+ @brief output of an indented line of the function body
+
+ @param g generator state
+ @param fmt format
+ */
+static void emit(struct GEN_STATE *g, const char *fmt, ...) {
+    va_list ap;
+
+    if (!g->ok) {
+        return;
+    }
+    for (int i = 0; i <= g->indent; i++) {
+        g->ok = g->ok && buf_printf(&g->body, "    ");
+    }
+    va_start(ap, fmt);
+    g->ok = g->ok && buf_vprintf(&g->body, fmt, ap);
+    va_end(ap);
+    g->ok = g->ok && buf_printf(&g->body, "\n");
+}
+
+/**
+ @brief push an expression on the operand stack
+
+ @param g generator state
+ @param s allocated expression, NULL marks an error
+ */
+static void push(struct GEN_STATE *g, char *s) {
+    if (s == NULL) {
+        g->ok = 0;
+        return;
+    }
+    g->St[++g->sp] = s;
+}
+
+/**
+ @brief pop an expression from the operand stack
+
+ @param g generator state
+ @return allocated expression, NULL on stack underflow
+ */
+static char *pop(struct GEN_STATE *g) {
+    if (g->sp <= 0) {
+        g->ok = 0;
+        return NULL;
+    }
+    return g->St[g->sp--];
+}
+
+/**
+ @brief store the pending expressions on the stack in spill locals
+
+ @discussion    Expressions on the stack are only evaluated when they are
+ used. Before a statement that writes or branches, the expressions that
+ remain on the stack are evaluated, so that they see the values of
+ that moment.
+
+ @param g generator state
+ */
+static void spill(struct GEN_STATE *g) {
+    for (int i = 1; i <= g->sp; i++) {
+        char *s = g->St[i];
+        if (s[0] == 's' && isdigit((unsigned char)s[1])) {
+            continue; /* spill local already */
+        }
+        emit(g, "s%d = %s;", g->nSpill, s);
+        free(s);
+        g->St[i] = str_printf("s%d", g->nSpill++);
+        if (g->St[i] == NULL) {
+            g->ok = 0;
+        }
+    }
+}
+
+/**
+ @brief C expression for a numerical constant
+
+ @param val value
+ @return allocated expression
+ */
+static char *number(double val) {
+    char s[40];
+
+    if (isnan(val)) {
+        return str_printf("NAN");
+    }
+    if (isinf(val)) {
+        return str_printf(val > 0 ? "HUGE_VAL" : "(-HUGE_VAL)");
+    }
+    snprintf(s, sizeof(s), "%.17g", val);
+    if (strpbrk(s, ".eE") == NULL) {
+        strcat(s, ".0"); /* keep it a double constant */
+    }
+    return str_printf(val < 0 ? "(%s)" : "%s", s);
+}
+
+/**
+ @brief C expression for an operand
+
+ @param g generator state
+ @param typ type of operand
+ @param ind index of operand
+ @param store operand is assigned to
+ @return allocated expression, NULL for an invalid operand
+ */
+static char *operand(struct GEN_STATE *g, TYP typ, int ind, int store) {
+    const struct GEN_MODEL *m = g->m;
+    const char *jac;
+    int n;
+
+    if (ind < 0) {
+        return NULL;
+    }
+    if (store && typ != RES && typ != TMP && typ != DRES && typ != DTMP &&
+        typ != DJAC) {
+        return NULL;
+    }
+    switch (typ) {
+    case VAR:
+        return (ind < m->nVar) ? str_printf("x[%d]", ind) : NULL;
+    case AUX:
+        return (ind < m->nAux) ? str_printf("a[%d]", ind) : NULL;
+    case PAR:
+        return (ind < m->nPar) ? str_printf("p[%d]", ind) : NULL;
+    case CON:
+        return (ind < m->nCon) ? str_printf("c[%d]", ind) : NULL;
+    case FLG:
+        return (ind < m->nFlg) ? str_printf("(f[%d] > 0.5 ? 1.0 : 0.0)", ind)
+                               : NULL;
+    case RES:
+        return (ind < m->nRes) ? str_printf("r[%d]", ind) : NULL;
+    case TMP:
+        return (ind < m->nTmp) ? str_printf("t%d", ind) : NULL;
+    case DTMP:
+        return (ind < m->nTmp) ? str_printf("d%d", ind) : NULL;
+    case DRES:
+        jac = (g->kod == 1) ? "jx" : (g->kod == 2) ? "ja" : "jp";
+        return (g->kod > 0 && !m->reverse[g->kod - 1] && ind < m->nRes)
+                   ? str_printf("%s[%d]", jac, g->col * m->nRes + ind)
+                   : NULL;
+    case DJAC:
+        jac = (g->kod == 1) ? "jx" : (g->kod == 2) ? "ja" : "jp";
+        n = (g->kod == 1) ? m->nVar : (g->kod == 2) ? m->nAux : m->nPar;
+        return (g->kod > 0 && m->reverse[g->kod - 1] && ind < n)
+                   ? str_printf("%s[%d]", jac, ind * m->nRes + g->col)
+                   : NULL;
+    default:
+        return NULL;
+    }
+}
+
+/**
+ @brief open the block of the current derivative column, or of the current
+ residual of a kind in reverse mode, or of a kind in vector mode
+
+ @param g generator state
+ */
+static void open_column(struct GEN_STATE *g) {
+    const struct GEN_MODEL *m = g->m;
+
+    if (g->kod > 0 && g->kod <= 3 && m->reverse[g->kod - 1]) {
+        if (g->col < m->nRes) { /* all columns of a residual */
+            emit(g, "{");
+            g->indent++;
+        }
+        return;
+    }
+    if (g->kod > 0 && g->kod <= 3 && m->vector[g->kod - 1]) {
+        if (g->col == 0) { /* all columns in a single pass */
+            emit(g, "{");
+            g->indent++;
+        }
+        return;
+    }
+    switch (g->kod) {
+    case 1:
+        if (g->col < m->nVar) {
+            emit(g, "if (!xf || xf[%d]) {", g->col);
+            g->indent++;
+        }
+        break;
+    case 2:
+        if (g->col < m->nAux) {
+            emit(g, "{");
+            g->indent++;
+        }
+        break;
+    case 3:
+        if (g->col < m->nPar) {
+            emit(g, "if (!pf || pf[%d]) {", g->col);
+            g->indent++;
+        }
+        break;
+    default:
+        g->ok = 0;
+        break;
+    }
+}
+
+/**
+ @brief number of columns of the current kind of derivatives
+
+ @param g generator state
+ @return number of columns
+ */
+static int columns(struct GEN_STATE *g) {
+    const struct GEN_MODEL *m = g->m;
+
+    return (g->kod == 1) ? m->nVar : (g->kod == 2) ? m->nAux : m->nPar;
+}
+
+/**
+ @brief offset of the gradient of a temporary or residual in vector mode
+
+ @param g generator state
+ @param typ DTMP or DRES
+ @param ind index of the temporary or residual
+ @return offset in the gradients, -1 for an invalid operand
+ */
+static int gradient(struct GEN_STATE *g, TYP typ, int ind) {
+    const struct GEN_MODEL *m = g->m;
+
+    if (g->kod == 0 || !m->vector[g->kod - 1] || ind < 0) {
+        return -1;
+    }
+    if (typ == DTMP && ind < m->nTmp) {
+        return ind * g->nVec;
+    }
+    if (typ == DRES && ind < m->nRes) {
+        return (m->nTmp + ind) * g->nVec;
+    }
+    return -1;
+}
+
+/**
+ @brief C expression format of an operator
+
+ @param opr operator
+ @param nOpd number of operands, output
+ @return format, NULL if opr is not an expression operator
+ */
+static const char *operator_format(OPR opr, int *nOpd) {
+    *nOpd = 2;
+    switch (opr) {
+    case AND:
+        return "(%s != 0 && %s != 0 ? 1.0 : 0.0)";
+    case OR:
+        return "(%s != 0 || %s != 0 ? 1.0 : 0.0)";
+    case LT:
+        return "(%s < %s ? 1.0 : 0.0)";
+    case GT:
+        return "(%s > %s ? 1.0 : 0.0)";
+    case LE:
+        return "(%s <= %s ? 1.0 : 0.0)";
+    case GE:
+        return "(%s >= %s ? 1.0 : 0.0)";
+    case EQ:
+        return "(%s == %s ? 1.0 : 0.0)";
+    case NE:
+        return "(%s != %s ? 1.0 : 0.0)";
+    case ADD:
+        return "(%s + %s)";
+    case SUB:
+        return "(%s - %s)";
+    case MUL:
+        return "(%s * %s)";
+    case DIV:
+        return "(%s / %s)";
+    case POW:
+        return "pow(%s, %s)";
+    default:
+        break;
+    }
+    *nOpd = 1;
+    switch (opr) {
+    case NOT:
+        return "(%s == 0 ? 1.0 : 0.0)";
+    case NEG:
+        return "(-%s)";
+    case REV:
+        return "(1.0 / %s)";
+    case SQR:
+        return "prx_sqr(%s)";
+    case INC:
+        return "(%s + 1.0)";
+    case DEC:
+        return "(%s - 1.0)";
+    case SGN:
+        return "prx_sgn(%s)";
+    case ABS:
+        return "fabs(%s)";
+    case SIN:
+        return "sin(%s)";
+    case COS:
+        return "cos(%s)";
+    case TAN:
+        return "tan(%s)";
+    case ASIN:
+        return "asin(%s)";
+    case ACOS:
+        return "acos(%s)";
+    case ATAN:
+        return "atan(%s)";
+    case SINH:
+        return "sinh(%s)";
+    case COSH:
+        return "cosh(%s)";
+    case TANH:
+        return "tanh(%s)";
+    case ERF:
+        return "erf(%s)";
+    case EXP:
+        return "exp(%s)";
+    case LOG:
+        return "log(%s)";
+    case LG:
+        return "log10(%s)";
+    case SQRT:
+        return "sqrt(%s)";
+    default:
+        break;
+    }
+    *nOpd = 0;
+    return NULL;
+}
+
+/**
+ @brief translation of the interpreter code into a function body
+
+ @param g generator state
+ @return 0 - error, 1 - success
+ */
+static int gen_body(struct GEN_STATE *g) {
+    const struct GEN_MODEL *m = g->m;
+    const CODE *code = m->code;
+    const char *fmt;
+    char *s1, *s2, *dst;
+    OPR opr;
+    TYP typ;
+    int ind, nOpd;
+    int off, nCol;
+    const char *jac;
+
+    for (int i = 0; i < m->nCode && g->ok; i++) {
+        opr = code[i].o;
+
+        fmt = operator_format(opr, &nOpd);
+        if (nOpd == 2) {
+            s2 = pop(g);
+            s1 = pop(g);
+            if (s1 && s2) {
+                push(g, str_printf(fmt, s1, s2));
+            }
+            free(s1);
+            free(s2);
+            continue;
+        }
+        if (nOpd == 1) {
+            s1 = pop(g);
+            if (s1) {
+                push(g, str_printf(fmt, s1));
+            }
+            free(s1);
+            continue;
+        }
+
+        switch (opr) {
+        case OPD:
+        case DOPD:
+            typ = code[++i].t;
+            ind = code[++i].i;
+            push(g, operand(g, typ, ind, 0));
+            break;
+        case NUM:
+            ind = code[++i].i;
+            push(g, (ind >= 0 && ind < m->nNum) ? number(m->num[ind]) : NULL);
+            break;
+        case LDF:
+            ind = code[++i].i;
+            push(g, (ind >= 0 && ind < m->nFlg)
+                        ? str_printf("(f[%d] > 0.5 ? 1.0 : 0.0)", ind)
+                        : NULL);
+            break;
+        case ASS:
+        case NASS:
+        case CLR:
+            typ = code[++i].t;
+            ind = code[++i].i;
+            dst = operand(g, typ, ind, 1);
+            s1 = (opr == CLR) ? NULL : pop(g);
+            spill(g);
+            if (dst == NULL || (opr != CLR && s1 == NULL)) {
+                g->ok = 0;
+            } else if (opr == ASS) {
+                emit(g, "%s = %s;", dst, s1);
+            } else if (opr == NASS) {
+                emit(g, "%s = -%s;", dst, s1);
+            } else {
+                emit(g, "%s = 0.0;", dst);
+            }
+            free(dst);
+            free(s1);
+            break;
+        case GCLR:
+            typ = code[++i].t;
+            off = gradient(g, typ, code[++i].i);
+            nCol = columns(g);
+            spill(g);
+            if (off < 0) {
+                g->ok = 0;
+            } else {
+                emit(g, "for (int j = 0; j < %d; j++) g[%d + j] = 0.0;", nCol,
+                     off);
+            }
+            break;
+        case GADD:
+            typ = code[++i].t;
+            off = gradient(g, typ, code[++i].i);
+            nCol = columns(g);
+            typ = code[++i].t;
+            ind = code[++i].i;
+            s1 = pop(g);
+            spill(g);
+            if (off < 0 || s1 == NULL) {
+                g->ok = 0;
+            } else if (typ == DTMP && gradient(g, typ, ind) >= 0) {
+                emit(g, "{");
+                g->indent++;
+                emit(g, "const double s = %s;", s1);
+                emit(g, "for (int j = 0; j < %d; j++) {", nCol);
+                emit(g, "    g[%d + j] = g[%d + j] + s * g[%d + j];", off, off,
+                     gradient(g, typ, ind));
+                emit(g, "}");
+                g->indent--;
+                emit(g, "}");
+            } else if ((int)typ == g->kod - 1 && ind >= 0 && ind < nCol) {
+                emit(g, "g[%d] = g[%d] + %s;", off + ind, off + ind, s1);
+            } else {
+                g->ok = 0;
+            }
+            free(s1);
+            break;
+        case IF:
+            s1 = pop(g);
+            spill(g);
+            if (s1) {
+                emit(g, "if (%s != 0) {", s1);
+                g->indent++;
+            }
+            free(s1);
+            break;
+        case ELSE:
+            spill(g);
+            g->indent--;
+            emit(g, "} else {");
+            g->indent++;
+            break;
+        case FI:
+            spill(g);
+            g->indent--;
+            emit(g, "}");
+            break;
+        case RET:
+            s1 = pop(g);
+            spill(g);
+            if (s1) {
+                emit(g, "*ec = (int)%s;", s1);
+                emit(g, "return 0;");
+            }
+            free(s1);
+            break;
+        case CHKL:
+        case CHKG:
+            s2 = pop(g);
+            s1 = pop(g);
+            spill(g);
+            if (s1 && s2) {
+                emit(g, "if (%s %c %s) return 0;", s1,
+                     (opr == CHKL) ? '<' : '>', s2);
+            }
+            free(s1);
+            free(s2);
+            break;
+        case SOP: /* end of the parameter stage, evaluated every call */
+            if (g->sp != 0 || g->indent != 0 || g->kod != 0) {
+                return 0;
+            }
+            break;
+        case SOD: /* shared subexpressions of the derivatives follow */
+            if (g->sp != 0 || g->indent != 0 || g->kod != 0) {
+                return 0;
+            }
+            emit(g, "if (!jxf && !jpf) return 1;");
+            break;
+        case SOK:
+            if (g->sp != 0 || g->indent != 0 || g->kod >= 3) {
+                return 0;
+            }
+            g->kod++;
+            g->col = 0;
+            if (g->kod == 1) {
+                emit(g, "if (!jxf) goto par;");
+            } else if (g->kod == 3) {
+                g->ok = g->ok && buf_printf(&g->body, "par:\n");
+                emit(g, "if (!jpf) return 1;");
+            }
+            open_column(g);
+            break;
+        case EOD:
+            if (g->sp != 0 || g->indent != 1 || g->kod == 0) {
+                return 0;
+            }
+            if (m->vector[g->kod - 1]) { /* rows of the Jacobian */
+                jac = (g->kod == 1) ? "jx" : (g->kod == 2) ? "ja" : "jp";
+                for (int r = 0; r < m->nRes; r++) {
+                    emit(g, "for (int j = 0; j < %d; j++)", columns(g));
+                    emit(g, "    %s[j * %d + %d] = g[%d + j];", jac, m->nRes, r,
+                         gradient(g, DRES, r));
+                }
+            }
+            g->indent--;
+            emit(g, "}");
+            g->col++;
+            open_column(g);
+            break;
+        case STOP:
+            if (g->sp != 0 || g->indent != 0 || g->kod != 3) {
+                return 0;
+            }
+            emit(g, "return 1;");
+            return g->ok;
+        default:
+            return 0;
+        }
+    }
+    return 0; /* no STOP */
+}
+
+/**
+ @brief length of a gradient in vector mode
+
+ @param model model code and dimensions
+ @return largest number of columns of a kind in vector mode, 0 if none
+ */
+static int vector_length(const struct GEN_MODEL *model) {
+    int nVec = 0;
+
+    for (int k = 0; k < 3; k++) {
+        int nCol = (k == 0) ? model->nVar : (k == 1) ? model->nAux
+                                                     : model->nPar;
+        if (model->vector[k] && nCol > nVec) {
+            nVec = nCol;
+        }
+    }
+    return nVec;
+}
+
+/**
+ @brief length of the scratch argument of the generated function
+
+ @param model model code and dimensions
+ @return number of doubles, 0 if no kind is in vector mode
+ */
+int gen_scratch_length(const struct GEN_MODEL *model) {
+    return (model->nTmp + model->nRes) * vector_length(model);
+}
+
+/**
+ @brief generate a C function equivalent to the interpreter code
+
+ @discussion    Temporaries and their derivatives become local variables,
+ conditionals become if/else statements, and operand loads become array
+ accesses with constant indices. The derivatives of each kind are
+ generated column by column, guarded by the same flags as in the
+ interpreter, where NULL flags select all columns. A kind in reverse mode is generated residual by residual,
+ for all columns. A kind in vector mode is generated in a single pass over
+ the gradients of the temporaries and residuals, kept in the scratch
+ argument of gen_scratch_length doubles rather than on the stack, which
+ would not hold them for large models on secondary threads. <br>
+ A single function serves the residuals and every kind of derivatives, as
+ the derivatives read the temporaries of the function code: the flags
+ select the kinds, and a call for the residuals only returns before the
+ derivatives.
+
+ @param out output file
+ @param name name of the function
+ @param model model code and dimensions
+ @return 0 - error, 1 - success
+ */
+int gen_c_source(FILE *out, const char *name, const struct GEN_MODEL *model) {
+    struct GEN_STATE g;
+    int ok;
+
+    g.m = model;
+    g.body.s = NULL;
+    g.body.len = g.body.cap = 0;
+    g.St = (char **)calloc(model->nCode + 1, sizeof(char *));
+    g.sp = 0;
+    g.nSpill = 0;
+    g.indent = 0;
+    g.kod = 0;
+    g.col = 0;
+    g.nVec = vector_length(model);
+    g.ok = (g.St != NULL);
+
+    ok = g.ok && gen_body(&g);
+
+    if (ok) {
+        fprintf(out, "/* %s, generated by the ParX model compiler */\n\n",
+                FILEID);
+        fprintf(out, "#include <math.h>\n\n");
+        fprintf(out, "static inline double prx_sqr(double v) {\n"
+                     "    return v * v;\n"
+                     "}\n\n");
+        fprintf(out, "static inline double prx_sgn(double v) {\n"
+                     "    return (v >= 0) ? 1.0 : -1.0;\n"
+                     "}\n\n");
+        fprintf(out,
+                "int %s(const double *x, const double *a, const double *p,\n"
+                "    const double *c, const double *f, double *r,\n"
+                "    int jxf, const unsigned char *xf, double *jx, "
+                "double *ja,\n"
+                "    int jpf, const unsigned char *pf, double *jp, "
+                "int *ec,\n"
+                "    double *g) {\n",
+                name);
+        for (int i = 0; i < model->nTmp; i++) {
+            fprintf(out, "    double t%d = 0.0, d%d = 0.0;\n", i, i);
+        }
+        for (int i = 0; i < g.nSpill; i++) {
+            fprintf(out, "    double s%d;\n", i);
+        }
+        if (g.nVec > 0) {
+            fprintf(out, "    for (int j = 0; j < %d; j++) g[j] = 0.0;\n",
+                    gen_scratch_length(model));
+        }
+        fprintf(out, "\n%s}\n", g.body.s);
+        ok = !ferror(out);
+    }
+
+    while (g.sp > 0) {
+        free(g.St[g.sp--]);
+    }
+    free(g.St);
+    free(g.body.s);
+
+    return ok;
+}
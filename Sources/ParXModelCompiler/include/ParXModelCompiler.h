@@ -23,4 +23,7 @@
 
 #import "../PXModelCompiler.h"
 #import "../PXModelCode.h"
+#import "../PXModelProgram.h"
+#import "../PXModelWorkspace.h"
 #import "../PXModelInterpreter.h"
+#import "../PXModelNative.h"
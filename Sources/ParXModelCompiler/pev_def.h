@@ -0,0 +1,55 @@
+//
+// pev_def.h
+// ParXModelCompiler
+//
+// Header file for the partial evaluation of interpreter code
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef _PEV_DEF_H
+#define _PEV_DEF_H
+
+#include "prx_def.h"
+
+/* interpreter code, or its specialization */
+struct PEV_CODE {
+    CODE *code;  /* interpreter code, ends with STOP */
+    int nCode;   /* length of code */
+    double *num; /* numerical constants */
+    int nNum;    /* number of numerical constants */
+    int *map;    /* specialization: its offset per offset of the input */
+};
+
+/*
+ * The specialized code reads no constants or flags: their values are
+ * numerical constants, appended to those of the model code. It is
+ * evaluated with the same arguments as the model code. Its map gives for
+ * every offset of the model code, up to and including its length, the
+ * offset of the specialized code that follows from it, so that a source
+ * map can be carried over. The map of the model code itself is not used.
+ */
+
+extern int pev_specialize(const struct PEV_CODE *in, int nCon, int nFlg,
+                          int nTmp, const double *c, const double *f,
+                          struct PEV_CODE *out);
+extern void pev_free(struct PEV_CODE *pc);
+extern int pev_evaluate(OPR opr, double a, double b, double *v);
+extern int pev_length(OPR opr);
+extern int pev_depth(const CODE *code, int nCode);
+
+#endif
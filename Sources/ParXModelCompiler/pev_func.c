@@ -0,0 +1,831 @@
+//
+// pev_func.c
+// ParXModelCompiler
+//
+// Partial evaluation of interpreter code for given constants and flags
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pev_def.h"
+
+/* operand on the stack */
+struct PEV_OPD {
+    int start;  /* position of its code in the output */
+    int known;  /* value is known */
+    double val; /* known value */
+};
+
+/* conditional of the input code */
+enum PEV_BRANCH {
+    PEV_DYNAMIC, /* condition is evaluated at run time */
+    PEV_THEN,    /* condition is true, the else branch is removed */
+    PEV_ELSE     /* condition is false, the if branch is removed */
+};
+
+/* state of the partial evaluation */
+struct PEV_STATE {
+    const struct PEV_CODE *in;
+    int nCon, nFlg, nTmp;
+    const double *c, *f;
+    CODE *out;                        /* specialized code */
+    int nOut;                         /* length of specialized code */
+    int *map;                         /* output offset per input offset */
+    int nMap;                         /* input offsets mapped so far */
+    double *num;                      /* numerical constants */
+    int nNum;                         /* number of numerical constants */
+    int capNum;                       /* allocated numerical constants */
+    struct PEV_OPD *St;               /* operand stack, St[0] unused */
+    int sp;                           /* operand stack pointer */
+    int *TmpKnown;                    /* value of a temporary is known */
+    double *TmpVal;                   /* known value of a temporary */
+    enum PEV_BRANCH Level[MAXLEVEL + 1]; /* conditionals of the input */
+    int level;                        /* nesting level of conditionals */
+    int nDynamic;                     /* enclosing run time conditionals */
+    int barrier;                      /* end of the last statement */
+    int ok;                           /* no error so far */
+};
+
+/**
+ @brief number of cells of an operator in the input code
+
+ @param opr operator
+ @return number of cells
+ */
+int pev_length(OPR opr) {
+    switch (opr) {
+    case OPD:
+    case DOPD:
+    case ASS:
+    case NASS:
+    case CLR:
+    case GCLR:
+        return 3;
+    case NUM:
+    case LDF:
+        return 2;
+    case GADD:
+        return 5;
+    default:
+        return 1;
+    }
+}
+
+/**
+ @brief maximum depth of the operand stack of interpreter code
+
+ @param code interpreter code
+ @param nCode length of code
+ @return maximum depth, -1 when an operator lacks its operands
+ */
+int pev_depth(const CODE *code, int nCode) {
+    int depth = 0, max = 0;
+
+    for (int i = 0; i < nCode && code[i].o != STOP;
+         i += pev_length(code[i].o)) {
+        switch (code[i].o) {
+        case OPD:
+        case DOPD:
+        case NUM:
+        case LDF:
+            depth++;
+            break;
+        case AND:
+        case OR:
+        case LT:
+        case GT:
+        case LE:
+        case GE:
+        case EQ:
+        case NE:
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case POW:
+        case ASS:
+        case NASS:
+        case GADD:
+        case IF:
+            depth--;
+            break;
+        case CHKL:
+        case CHKG:
+            depth -= 2;
+            break;
+        default:
+            break;
+        }
+        if (depth < 0) {
+            return -1;
+        }
+        if (depth > max) {
+            max = depth;
+        }
+    }
+    return max;
+}
+
+/**
+ @brief value of an operator for known operands, as in the interpreter
+
+ @param opr operator
+ @param a first operand
+ @param b second operand, of a binary operator
+ @param v value
+ @return 0 - not folded, 1 - folded
+ */
+int pev_evaluate(OPR opr, double a, double b, double *v) {
+    switch (opr) {
+    case AND:
+        *v = (a != 0 && b != 0) ? 1 : 0;
+        break;
+    case OR:
+        *v = (a != 0 || b != 0) ? 1 : 0;
+        break;
+    case NOT:
+        *v = (a == 0) ? 1 : 0;
+        break;
+    case LT:
+        *v = (a < b) ? 1 : 0;
+        break;
+    case GT:
+        *v = (a > b) ? 1 : 0;
+        break;
+    case LE:
+        *v = (a <= b) ? 1 : 0;
+        break;
+    case GE:
+        *v = (a >= b) ? 1 : 0;
+        break;
+    case EQ:
+        *v = (a == b) ? 1 : 0;
+        break;
+    case NE:
+        *v = (a != b) ? 1 : 0;
+        break;
+    case ADD:
+        *v = a + b;
+        break;
+    case SUB:
+        *v = a - b;
+        break;
+    case MUL:
+        *v = a * b;
+        break;
+    case DIV:
+        *v = a / b;
+        break;
+    case POW:
+        *v = pow(a, b);
+        break;
+    case SGN:
+        *v = (a >= 0) ? 1 : -1;
+        break;
+    case SIN:
+        *v = sin(a);
+        break;
+    case COS:
+        *v = cos(a);
+        break;
+    case TAN:
+        *v = tan(a);
+        break;
+    case ASIN:
+        *v = asin(a);
+        break;
+    case ACOS:
+        *v = acos(a);
+        break;
+    case ATAN:
+        *v = atan(a);
+        break;
+    case SINH:
+        *v = sinh(a);
+        break;
+    case COSH:
+        *v = cosh(a);
+        break;
+    case TANH:
+        *v = tanh(a);
+        break;
+    case ERF:
+        *v = erf(a);
+        break;
+    case EXP:
+        *v = exp(a);
+        break;
+    case LOG:
+        *v = log(a);
+        break;
+    case LG:
+        *v = log10(a);
+        break;
+    case SQRT:
+        *v = sqrt(a);
+        break;
+    case SQR:
+        *v = a * a;
+        break;
+    case NEG:
+        *v = -a;
+        break;
+    case REV:
+        *v = 1.0 / a;
+        break;
+    case INC:
+        *v = a + 1;
+        break;
+    case DEC:
+        *v = a - 1;
+        break;
+    case ABS:
+        *v = (a < 0) ? -a : a;
+        break;
+    default:
+        return 0;
+    }
+    return isfinite(*v); /* errors are left to run time */
+}
+
+/**
+ @brief index of a numerical constant, added when new
+
+ @param g state
+ @param val value
+ @return index, -1 on error
+ */
+static int number_index(struct PEV_STATE *g, double val) {
+    double *num;
+
+    for (int i = 0; i < g->nNum; i++) {
+        if (memcmp(&g->num[i], &val, sizeof(double)) == 0) {
+            return i;
+        }
+    }
+    if (g->nNum == g->capNum) {
+        num = (double *)realloc(g->num, 2 * (g->capNum + 1) * sizeof(double));
+        if (num == NULL) {
+            g->ok = 0;
+            return -1;
+        }
+        g->num = num;
+        g->capNum = 2 * (g->capNum + 1);
+    }
+    g->num[g->nNum] = val;
+    return g->nNum++;
+}
+
+/**
+ @brief replace the code from a position by a numerical constant
+
+ @param g state
+ @param start position in the output
+ @param val value
+ */
+static void push_number(struct PEV_STATE *g, int start, double val) {
+    int ind = number_index(g, val);
+
+    g->nOut = start;
+    g->out[g->nOut++].o = NUM;
+    g->out[g->nOut++].i = ind;
+    g->sp++;
+    g->St[g->sp].start = start;
+    g->St[g->sp].known = 1;
+    g->St[g->sp].val = val;
+}
+
+/**
+ @brief push an operand of which the value is not known
+
+ @param g state
+ @param start position of its code in the output
+ */
+static void push_code(struct PEV_STATE *g, int start) {
+    g->sp++;
+    g->St[g->sp].start = start;
+    g->St[g->sp].known = 0;
+    g->St[g->sp].val = 0;
+}
+
+/**
+ @brief replace a binary operation by one of its operands
+
+ @param g state
+ @param a first operand
+ @param b second operand
+ @param keep operand that is the result, a or b
+ */
+static void keep_operand(struct PEV_STATE *g, const struct PEV_OPD *a,
+                         const struct PEV_OPD *b, const struct PEV_OPD *keep) {
+    if (keep == a) {
+        g->nOut = b->start;
+    } else {
+        memmove(g->out + a->start, g->out + b->start,
+                (g->nOut - b->start) * sizeof(CODE));
+        g->nOut -= b->start - a->start;
+    }
+    g->sp++;
+    g->St[g->sp] = *keep;
+    g->St[g->sp].start = a->start;
+}
+
+/**
+ @brief binary operator
+
+ @discussion    Known operands are folded. With a single known operand the
+ same simplifications are made as by the compiler: the identity of an
+ operator leaves the other operand, and a multiplication by 0 is 0.
+
+ @param g state
+ @param opr operator
+ */
+static void binary(struct PEV_STATE *g, OPR opr) {
+    struct PEV_OPD a, b;
+    double v;
+
+    if (g->sp < 2) {
+        g->ok = 0;
+        return;
+    }
+    b = g->St[g->sp--];
+    a = g->St[g->sp--];
+    if (a.start < g->barrier) { /* operands separated by a statement */
+        g->out[g->nOut++].o = opr;
+        push_code(g, a.start);
+        return;
+    }
+    if (a.known && b.known && pev_evaluate(opr, a.val, b.val, &v)) {
+        push_number(g, a.start, v);
+        return;
+    }
+    switch (opr) {
+    case AND:
+        if ((a.known && a.val == 0) || (b.known && b.val == 0)) {
+            push_number(g, a.start, 0);
+            return;
+        }
+        break;
+    case OR:
+        if ((a.known && a.val != 0) || (b.known && b.val != 0)) {
+            push_number(g, a.start, 1);
+            return;
+        }
+        break;
+    case ADD:
+        if (a.known && a.val == 0) {
+            keep_operand(g, &a, &b, &b);
+            return;
+        }
+        if (b.known && b.val == 0) {
+            keep_operand(g, &a, &b, &a);
+            return;
+        }
+        break;
+    case SUB:
+        if (b.known && b.val == 0) {
+            keep_operand(g, &a, &b, &a);
+            return;
+        }
+        break;
+    case MUL:
+        if ((a.known && a.val == 0) || (b.known && b.val == 0)) {
+            push_number(g, a.start, 0);
+            return;
+        }
+        if (a.known && a.val == 1) {
+            keep_operand(g, &a, &b, &b);
+            return;
+        }
+        if (b.known && b.val == 1) {
+            keep_operand(g, &a, &b, &a);
+            return;
+        }
+        if (b.known && b.val == -1) {
+            g->nOut = b.start;
+            g->out[g->nOut++].o = NEG;
+            push_code(g, a.start);
+            return;
+        }
+        break;
+    case DIV:
+        if (a.known && a.val == 0) {
+            push_number(g, a.start, 0);
+            return;
+        }
+        if (b.known && b.val == 1) {
+            keep_operand(g, &a, &b, &a);
+            return;
+        }
+        break;
+    case POW:
+        if ((b.known && b.val == 0) || (a.known && a.val == 1)) {
+            push_number(g, a.start, 1);
+            return;
+        }
+        if (a.known && a.val == 0) {
+            push_number(g, a.start, 0);
+            return;
+        }
+        if (b.known && b.val == 1) {
+            keep_operand(g, &a, &b, &a);
+            return;
+        }
+        if (b.known && b.val == 2) {
+            g->nOut = b.start;
+            g->out[g->nOut++].o = SQR;
+            push_code(g, a.start);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    g->out[g->nOut++].o = opr;
+    push_code(g, a.start);
+}
+
+/**
+ @brief unary operator
+
+ @param g state
+ @param opr operator
+ */
+static void unary(struct PEV_STATE *g, OPR opr) {
+    struct PEV_OPD a;
+    double v;
+
+    if (g->sp < 1) {
+        g->ok = 0;
+        return;
+    }
+    a = g->St[g->sp--];
+    if (a.start >= g->barrier && a.known &&
+        pev_evaluate(opr, a.val, 0, &v)) {
+        push_number(g, a.start, v);
+        return;
+    }
+    g->out[g->nOut++].o = opr;
+    push_code(g, a.start);
+}
+
+/**
+ @brief skip the input code of a removed branch
+
+ @param g state
+ @param i position of the if or else of the branch, on return the
+ position of the else or fi that ends it
+ @return ELSE or FI, INVAL on error
+ */
+static OPR skip_branch(struct PEV_STATE *g, int *i) {
+    const CODE *code = g->in->code;
+    int depth = 0;
+    OPR opr;
+
+    for (int k = *i + 1; k < g->in->nCode; k += pev_length(opr)) {
+        opr = code[k].o;
+        if (opr == IF) {
+            depth++;
+        } else if (opr == ELSE && depth == 0) {
+            *i = k;
+            return ELSE;
+        } else if (opr == FI) {
+            if (depth == 0) {
+                *i = k;
+                return FI;
+            }
+            depth--;
+        } else if (opr >= STOP) {
+            break;
+        }
+    }
+    g->ok = 0;
+    return INVAL;
+}
+
+/**
+ @brief copy of an operator and its operand cells
+
+ @param g state
+ @param i position in the input code
+ @param n number of cells
+ */
+static void copy_cells(struct PEV_STATE *g, int i, int n) {
+    for (int k = 0; k < n; k++) {
+        g->out[g->nOut++] = g->in->code[i + k];
+    }
+}
+
+/**
+ @brief partial evaluation of the code
+
+ @param g state
+ @return 0 - error, 1 - success
+ */
+static int pev_body(struct PEV_STATE *g) {
+    const CODE *code = g->in->code;
+    struct PEV_OPD a, b;
+    OPR opr = INVAL;
+    TYP typ;
+    int ind, known;
+    double val;
+
+    for (int i = 0; i < g->in->nCode && g->ok; i++) {
+        while (g->nMap <= i) { /* including the code of a removed branch */
+            g->map[g->nMap++] = g->nOut;
+        }
+        opr = code[i].o;
+        if (opr >= STOP) {
+            break;
+        }
+        switch (opr) {
+        case AND:
+        case OR:
+        case LT:
+        case GT:
+        case LE:
+        case GE:
+        case EQ:
+        case NE:
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case POW:
+            binary(g, opr);
+            break;
+        case NOT:
+        case NEG:
+        case REV:
+        case SQR:
+        case INC:
+        case DEC:
+        case SIN:
+        case COS:
+        case TAN:
+        case ASIN:
+        case ACOS:
+        case ATAN:
+        case SINH:
+        case COSH:
+        case TANH:
+        case ERF:
+        case EXP:
+        case LOG:
+        case LG:
+        case SQRT:
+        case ABS:
+        case SGN:
+            unary(g, opr);
+            break;
+        case OPD:
+        case DOPD:
+            typ = code[i + 1].t;
+            ind = code[i + 2].i;
+            if (opr == OPD && typ == CON && ind < g->nCon) {
+                push_number(g, g->nOut, g->c[ind]);
+            } else if (opr == OPD && typ == FLG && ind < g->nFlg) {
+                push_number(g, g->nOut, g->f[ind] > 0.5 ? 1 : 0);
+            } else if (opr == OPD && typ == TMP && ind < g->nTmp &&
+                       g->TmpKnown[ind]) {
+                push_number(g, g->nOut, g->TmpVal[ind]);
+            } else {
+                push_code(g, g->nOut);
+                copy_cells(g, i, 3);
+            }
+            i += 2;
+            break;
+        case NUM:
+            ind = code[++i].i;
+            if (ind < 0 || ind >= g->in->nNum) {
+                return 0;
+            }
+            push_code(g, g->nOut);
+            copy_cells(g, i - 1, 2);
+            g->St[g->sp].known = 1;
+            g->St[g->sp].val = g->in->num[ind];
+            break;
+        case LDF:
+            ind = code[++i].i;
+            if (ind < 0 || ind >= g->nFlg) {
+                return 0;
+            }
+            push_number(g, g->nOut, g->f[ind] > 0.5 ? 1 : 0);
+            break;
+        case ASS:
+        case NASS:
+        case CLR:
+            typ = code[i + 1].t;
+            ind = code[i + 2].i;
+            known = (g->nDynamic == 0);
+            val = 0;
+            if (opr != CLR) {
+                if (g->sp < 1) {
+                    return 0;
+                }
+                a = g->St[g->sp--];
+                known = known && a.known;
+                val = (opr == ASS) ? a.val : -a.val;
+            }
+            if (typ == TMP && ind < g->nTmp) {
+                g->TmpKnown[ind] = known;
+                g->TmpVal[ind] = val;
+            }
+            copy_cells(g, i, 3);
+            g->barrier = g->nOut;
+            i += 2;
+            break;
+        case GCLR:
+        case GADD:
+            if (opr == GADD && g->sp-- < 1) {
+                return 0;
+            }
+            copy_cells(g, i, pev_length(opr));
+            g->barrier = g->nOut;
+            i += pev_length(opr) - 1;
+            break;
+        case CHKL:
+        case CHKG:
+            if (g->sp < 2) {
+                return 0;
+            }
+            b = g->St[g->sp--];
+            a = g->St[g->sp--];
+            if (a.start >= g->barrier && a.known && b.known &&
+                ((opr == CHKL) ? !(a.val < b.val) : !(a.val > b.val))) {
+                g->nOut = a.start; /* the check always passes */
+                break;
+            }
+            g->out[g->nOut++].o = opr;
+            g->barrier = g->nOut;
+            break;
+        case RET:
+            if (g->sp-- < 1) {
+                return 0;
+            }
+            g->out[g->nOut++].o = opr;
+            g->barrier = g->nOut;
+            break;
+        case IF:
+            if (g->sp < 1 || g->level >= MAXLEVEL) {
+                return 0;
+            }
+            a = g->St[g->sp--];
+            if (a.known && a.start >= g->barrier) {
+                g->nOut = a.start;
+                if (a.val != 0) {
+                    g->Level[++g->level] = PEV_THEN;
+                } else if (skip_branch(g, &i) == ELSE) {
+                    g->Level[++g->level] = PEV_ELSE;
+                }
+                break;
+            }
+            g->out[g->nOut++].o = IF;
+            g->Level[++g->level] = PEV_DYNAMIC;
+            g->nDynamic++;
+            g->barrier = g->nOut;
+            break;
+        case ELSE:
+            if (g->level < 1 || g->Level[g->level] == PEV_ELSE) {
+                return 0;
+            }
+            if (g->Level[g->level] == PEV_THEN) {
+                if (skip_branch(g, &i) != FI) {
+                    return 0;
+                }
+                g->level--;
+                break;
+            }
+            g->out[g->nOut++].o = ELSE;
+            g->barrier = g->nOut;
+            break;
+        case FI:
+            if (g->level < 1) {
+                return 0;
+            }
+            if (g->Level[g->level] == PEV_DYNAMIC) {
+                g->out[g->nOut++].o = FI;
+                g->nDynamic--;
+                g->barrier = g->nOut;
+            }
+            g->level--;
+            break;
+        case EOD:
+        case SOK:
+        case SOP:
+        case SOD:
+            g->out[g->nOut++].o = opr;
+            g->barrier = g->nOut;
+            break;
+        default:
+            return 0;
+        }
+    }
+    if (opr != STOP || g->level != 0) {
+        return 0;
+    }
+    g->out[g->nOut++].o = STOP;
+    while (g->nMap <= g->in->nCode) {
+        g->map[g->nMap++] = g->nOut;
+    }
+    return g->ok;
+}
+
+/**
+ @brief specialization of interpreter code for given constants and flags
+
+ @discussion    The constants and flags are replaced by their values, and
+ operators with known operands are folded into numerical constants. A
+ temporary that is assigned a known value outside any conditional is
+ replaced by its value where it is used. A conditional with a known
+ condition is replaced by the branch that is taken, which removes the
+ code of the other branch, including its derivatives. Values that are
+ not finite are not folded, so that they occur at run time as before.
+ The map of the specialization relates its offsets to those of the input.
+
+ @param in interpreter code
+ @param nCon number of constants
+ @param nFlg number of flags
+ @param nTmp number of temporaries
+ @param c constants
+ @param f flags
+ @param out specialized code, to be released by pev_free
+ @return 0 - error, 1 - success
+ */
+int pev_specialize(const struct PEV_CODE *in, int nCon, int nFlg, int nTmp,
+                   const double *c, const double *f, struct PEV_CODE *out) {
+    struct PEV_STATE g;
+    int ok;
+
+    g.in = in;
+    g.nCon = nCon;
+    g.nFlg = nFlg;
+    g.nTmp = nTmp;
+    g.c = c;
+    g.f = f;
+    g.out = (CODE *)malloc((in->nCode + 1) * sizeof(CODE));
+    g.nOut = 0;
+    g.map = (int *)malloc((in->nCode + 1) * sizeof(int));
+    g.nMap = 0;
+    g.capNum = in->nNum + 16;
+    g.num = (double *)malloc(g.capNum * sizeof(double));
+    g.nNum = in->nNum;
+    g.St = (struct PEV_OPD *)malloc((in->nCode + 1) * sizeof(struct PEV_OPD));
+    g.sp = 0;
+    g.TmpKnown = (int *)calloc(nTmp + 1, sizeof(int));
+    g.TmpVal = (double *)calloc(nTmp + 1, sizeof(double));
+    g.level = 0;
+    g.nDynamic = 0;
+    g.barrier = 0;
+    g.ok = g.out && g.map && g.num && g.St && g.TmpKnown && g.TmpVal;
+
+    if (g.ok && in->nNum > 0) {
+        memcpy(g.num, in->num, in->nNum * sizeof(double));
+    }
+    ok = g.ok && pev_body(&g);
+
+    free(g.St);
+    free(g.TmpKnown);
+    free(g.TmpVal);
+    if (!ok) {
+        free(g.out);
+        free(g.map);
+        free(g.num);
+        return 0;
+    }
+    out->code = g.out;
+    out->nCode = g.nOut;
+    out->map = g.map;
+    out->num = g.num;
+    out->nNum = g.nNum;
+    return 1;
+}
+
+/**
+ @brief release a specialized code
+
+ @param pc specialized code
+ */
+void pev_free(struct PEV_CODE *pc) {
+    free(pc->code);
+    free(pc->map);
+    free(pc->num);
+    pc->code = NULL;
+    pc->map = NULL;
+    pc->num = NULL;
+    pc->nCode = pc->nNum = 0;
+}
@@ -40,6 +40,8 @@
 #define MAXCMD 1005
 /* maximum nesting level of conditional statements */
 #define MAXLEVEL 16
+/* number of points evaluated side by side in a batch */
+#define LANES 32
 /* maximum name length */
 #define MAXNAME 32
 /* maximum unit length */
@@ -50,7 +52,7 @@
 #define NUMDECVALUES 5
 
 typedef enum { /* operands */
-    VAR, AUX, PAR, CON, FLG, RES, TMP, DRES, DTMP
+    VAR, AUX, PAR, CON, FLG, RES, TMP, DRES, DTMP, DJAC
 } TYP;
 
 typedef enum { /* operators */
@@ -58,8 +60,8 @@ typedef enum { /* operators */
     NEG, ADD, SUB, MUL, DIV, POW, REV, SQR, INC, DEC, EQU,
     SIN, COS, TAN, ASIN, ACOS, ATAN, SINH, COSH, TANH, ERF,
     EXP, LOG, LG, SQRT, ABS, SGN, RET, CHKL, CHKG,
-    OPD, NUM, DOPD, LDF, ASS, NASS, CLR,
-    JMP, IF, ELSE, FI, EOD, SOK, STOP
+    OPD, NUM, DOPD, LDF, ASS, NASS, CLR, GCLR, GADD, GSEED,
+    JMP, IF, ELSE, FI, EOD, SOK, SOP, SOD, STOP
 } OPR;
 
 /* the parse tree */
@@ -94,12 +96,40 @@ struct PRX_OPD_S {
 };
 typedef struct PRX_OPD_S PRX_OPD;
 
+/* node by the operator and operands it was created with */
+struct PRX_CONS_S {
+    OPR opr;
+    PRX_NODE *o1;
+    PRX_NODE *o2;
+    PRX_NODE *node;
+};
+typedef struct PRX_CONS_S PRX_CONS;
+
+/* subexpression in the code of the derivatives */
+struct PRX_SHARE_S {
+    PRX_NODE *node;
+    int count;   /* number of times its code is generated */
+    int primal;  /* depends on primal values only */
+    int stage;   /* depends on parameters, constants and flags only */
+    int ind;     /* temporary that holds its value, -1 for none */
+    struct PRX_SHARE_S *next; /* in order of creation */
+};
+typedef struct PRX_SHARE_S PRX_SHARE;
+
+/* derivative rewritten by equality saturation */
+struct PRX_SATURATE_S {
+    PRX_NODE *node;   /* derivative, simplified node by node */
+    PRX_NODE *result; /* equal expression of the lowest cost */
+};
+typedef struct PRX_SATURATE_S PRX_SATURATE;
+
 /* code stack element */
 union PRX_CODE_U {
     OPR o;
     int i;
     TYP t;
     union PRX_CODE_U *c;
+    const void *h; /* handler address in threaded code */
 };
 typedef union PRX_CODE_U CODE;
 
@@ -0,0 +1,93 @@
+//
+// vec_def.h
+// ParXModelCompiler
+//
+// Header file for lane kernels of the batched interpreter
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef _VEC_DEF_H
+#define _VEC_DEF_H
+
+/*
+ * All kernels operate in place on a lane vector x of n values:
+ * x[l] = op(x[l]) or x[l] = op(x[l], y[l]).
+ * The vectors must not overlap partially.
+ *
+ * The arithmetic, logic, exp, log, log10, pow, erf and sqrt kernels are
+ * written with explicit vectors and compiled for SSE2 or NEON, AVX2 and
+ * AVX-512F. The widest set the processor and operating system support is
+ * selected once when the library is loaded. All sets give identical results,
+ * products are never fused with additions.
+ *
+ * Maximum error against glibc, measured on 10^6 random arguments per range
+ * and on zero, subnormal, infinite and NaN arguments, which agree with libm:
+ *   vec_exp, vec_log   1 ulp, including the subnormal range
+ *   vec_log10          2 ulp, log times log10(e) with an exact product
+ *   vec_pow            1 ulp for a positive finite base and |b| < 2^900,
+ *                      also for |b log(a)| close to 709; other lanes call
+ *                      libm pow
+ *   vec_erf            1 ulp
+ * The trigonometric and hyperbolic kernels call libm per lane.
+ */
+
+extern void vec_and(double *x, const double *y, int n);
+extern void vec_or(double *x, const double *y, int n);
+extern void vec_not(double *x, int n);
+extern void vec_lt(double *x, const double *y, int n);
+extern void vec_gt(double *x, const double *y, int n);
+extern void vec_le(double *x, const double *y, int n);
+extern void vec_ge(double *x, const double *y, int n);
+extern void vec_eq(double *x, const double *y, int n);
+extern void vec_ne(double *x, const double *y, int n);
+
+extern void vec_add(double *x, const double *y, int n);
+extern void vec_sub(double *x, const double *y, int n);
+extern void vec_mul(double *x, const double *y, int n);
+extern void vec_div(double *x, const double *y, int n);
+extern void vec_pow(double *x, const double *y, int n);
+
+extern void vec_neg(double *x, int n);
+extern void vec_rev(double *x, int n);
+extern void vec_sqr(double *x, int n);
+extern void vec_inc(double *x, int n);
+extern void vec_dec(double *x, int n);
+extern void vec_sgn(double *x, int n);
+extern void vec_abs(double *x, int n);
+extern void vec_sqrt(double *x, int n);
+
+extern void vec_exp(double *x, int n);
+extern void vec_log(double *x, int n);
+extern void vec_log10(double *x, int n);
+extern void vec_erf(double *x, int n);
+
+extern void vec_sin(double *x, int n);
+extern void vec_cos(double *x, int n);
+extern void vec_tan(double *x, int n);
+extern void vec_asin(double *x, int n);
+extern void vec_acos(double *x, int n);
+extern void vec_atan(double *x, int n);
+extern void vec_sinh(double *x, int n);
+extern void vec_cosh(double *x, int n);
+extern void vec_tanh(double *x, int n);
+
+extern void vec_set(double *x, double val, int n);
+extern void vec_copy(double *x, const double *y, int n);
+extern void vec_axpy(double *x, double a, const double *y, int n);
+
+#endif
@@ -0,0 +1,384 @@
+//
+// vec_func.c
+// ParXModelCompiler
+//
+// Lane kernels of the batched interpreter
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "vec_def.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define VEC_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+/* products are rounded before they are added, on every instruction set */
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+/* ========================================================================== */
+
+/* exponential and logarithm after fdlibm, rewritten without branches */
+
+static const double ln2_hi = 6.93147180369123816490e-01;
+static const double ln2_lo = 1.90821492927058770002e-10;
+static const double inv_ln2 = 1.44269504088896338700e+00;
+static const double round_shift = 0x1.8p52; /* rounds to integer on add */
+
+static const double exp_max = 7.09782712893383973096e+02; /* exp overflows */
+static const double exp_min = -7.45133219101941108420e+02; /* exp is 0 */
+
+static const double P1 = 1.66666666666666019037e-01;
+static const double P2 = -2.77777777770155933842e-03;
+static const double P3 = 6.61375632143793436117e-05;
+static const double P4 = -1.65339022054652515390e-06;
+static const double P5 = 4.13813679705723846039e-08;
+
+static const double two54 = 1.80143985094819840000e+16;
+static const double Lg1 = 6.666666666666735130e-01;
+static const double Lg2 = 3.999999999940941908e-01;
+static const double Lg3 = 2.857142874366239149e-01;
+static const double Lg4 = 2.222219843214978396e-01;
+static const double Lg5 = 1.818357216161805012e-01;
+static const double Lg6 = 1.531383769920937332e-01;
+static const double Lg7 = 1.479819860511658591e-01;
+
+static const double log10_e_hi = 4.34294481903251816668e-01;
+static const double log10_e_lo = 1.09831965021676507274e-17;
+
+/* Dekker split of a double in two halves of 26 bits */
+static const double split = 134217729.0;
+
+/* log(m) of pow in double-double, T(z) fitted on [0, 0.0295] within 2e-18 */
+static const double two_thirds_hi = 6.66666666666666629659e-01;
+static const double two_thirds_lo = 3.70074341541718826657e-17;
+static const double T1 = 0.4;
+static const double T2 = 0.2857142857142938;
+static const double T3 = 0.2222222222164882;
+static const double T4 = 0.1818181833699257;
+static const double T5 = 0.15384594791762352;
+static const double T6 = 0.13334813971292003;
+static const double T7 = 0.11705988156500907;
+static const double T8 = 0.11725771221811145;
+
+/* erf(x) / x in x^2 on [0, 1], absolute error 1.3e-19 */
+static const double erf_small[13] = {
+    5.957176147748911e-11,
+    -1.1372848856791674e-09,
+    1.4659775274047436e-08,
+    -1.6350312701054695e-07,
+    1.6461000484121368e-06,
+    -1.4925595266831182e-05,
+    0.0001205533111164271,
+    -0.000854832698083379,
+    0.0052239776248180145,
+    -0.026866170645076792,
+    0.11283791670954879,
+    -0.3761263890318375,
+    1.1283791670955126,
+};
+
+/* erfc(x) exp(x^2) in x - c on [1, 2], [2, 3.5] and [3.5, 6],
+   relative error 2.8e-17, 2.1e-16 and 2.4e-15 */
+static const double erfc_tail[3][16] = {
+    {
+        -4.932844202000261e-08,
+        1.8038197652346406e-07,
+        -5.946998373950516e-07,
+        2.061689065129881e-06,
+        -6.975285854904505e-06,
+        2.286543658874603e-05,
+        -7.265888759557882e-05,
+        0.00022330981211640024,
+        -0.0006619300686179933,
+        0.0018861348854630824,
+        -0.005145957547915988,
+        0.013377340952802835,
+        -0.03293090529956347,
+        0.07615103985548055,
+        -0.16362291773256007,
+        0.3215854164543175,
+    },
+    {
+        -4.029989243785423e-10,
+        1.819371994210045e-09,
+        -7.162110554563578e-09,
+        3.103266553704028e-08,
+        -1.3264363071840677e-07,
+        5.520607070345556e-07,
+        -2.247368610883161e-06,
+        8.940133543917338e-06,
+        -3.4698610270387155e-05,
+        0.0001311818037632169,
+        -0.0004821950849322654,
+        0.001719581885061462,
+        -0.005934337896999284,
+        0.01975859298732897,
+        -0.06323763756063483,
+        0.19366209627906866,
+    },
+    {
+        -1.0171709689071707e-12,
+        6.183166565869695e-12,
+        -3.081317881965821e-11,
+        1.8226396585714537e-10,
+        -1.0813100185433638e-09,
+        6.24584245950732e-09,
+        -3.559534170211966e-08,
+        2.002894521341176e-07,
+        -1.1115678822071087e-06,
+        6.081115557021995e-06,
+        -3.277578110287109e-05,
+        0.00017392830384343463,
+        -0.0009080988970320573,
+        0.0046613263689870375,
+        -0.023503448598163123,
+        0.11630270721024713,
+    }
+};
+
+/* ========================================================================== */
+
+/* kernels of one instruction set */
+struct vec_table {
+    void (*and_)(double *restrict x, const double *restrict y, int n);
+    void (*or_)(double *restrict x, const double *restrict y, int n);
+    void (*not_)(double *restrict x, int n);
+    void (*lt)(double *restrict x, const double *restrict y, int n);
+    void (*gt)(double *restrict x, const double *restrict y, int n);
+    void (*le)(double *restrict x, const double *restrict y, int n);
+    void (*ge)(double *restrict x, const double *restrict y, int n);
+    void (*eq)(double *restrict x, const double *restrict y, int n);
+    void (*ne)(double *restrict x, const double *restrict y, int n);
+    void (*add)(double *restrict x, const double *restrict y, int n);
+    void (*sub)(double *restrict x, const double *restrict y, int n);
+    void (*mul)(double *restrict x, const double *restrict y, int n);
+    void (*div)(double *restrict x, const double *restrict y, int n);
+    void (*pow)(double *restrict x, const double *restrict y, int n);
+    void (*neg)(double *restrict x, int n);
+    void (*rev)(double *restrict x, int n);
+    void (*sqr)(double *restrict x, int n);
+    void (*inc)(double *restrict x, int n);
+    void (*dec)(double *restrict x, int n);
+    void (*sgn)(double *restrict x, int n);
+    void (*abs)(double *restrict x, int n);
+    void (*sqrt)(double *restrict x, int n);
+    void (*exp)(double *restrict x, int n);
+    void (*log)(double *restrict x, int n);
+    void (*log10)(double *restrict x, int n);
+    void (*erf)(double *restrict x, int n);
+    void (*set)(double *restrict x, double val, int n);
+    void (*copy)(double *restrict x, const double *restrict y, int n);
+    void (*axpy)(double *restrict x, double a, const double *restrict y, int n);
+};
+
+/* baseline: SSE2 on x86-64, NEON on arm64 */
+#define W 2
+#define VATTR
+#define VNAME(f) vec2_##f
+#if defined(VEC_X86)
+#define VSQRT(a) ((VD)_mm_sqrt_pd((__m128d)(a)))
+#elif defined(__aarch64__)
+#define VSQRT(a) ((VD)vsqrtq_f64((float64x2_t)(a)))
+#else
+#define VSQRT(a) VNAME(lane_sqrt)(a)
+#endif
+#include "vec_kern.h"
+#undef W
+#undef VATTR
+#undef VNAME
+#undef VSQRT
+
+#if defined(VEC_X86)
+#define W 4
+#define VATTR __attribute__((target("avx2")))
+#define VNAME(f) vec4_##f
+#define VSQRT(a) ((VD)_mm256_sqrt_pd((__m256d)(a)))
+#include "vec_kern.h"
+#undef W
+#undef VATTR
+#undef VNAME
+#undef VSQRT
+
+#define W 8
+#define VATTR __attribute__((target("avx512f")))
+#define VNAME(f) vec8_##f
+#define VSQRT(a) ((VD)_mm512_sqrt_pd((__m512d)(a)))
+#include "vec_kern.h"
+#undef W
+#undef VATTR
+#undef VNAME
+#undef VSQRT
+#endif
+
+static const struct vec_table *vec_kernels = &vec2_table;
+
+/**
+ @brief select the kernels of the widest instruction set of the processor
+
+ @discussion    Runs once when the library is loaded. AVX needs the support of
+ the operating system as well, read from XCR0. macOS enables the AVX-512
+ state on first use, there the kernel reports it through sysctl.
+ */
+__attribute__((constructor)) static void vec_select(void) {
+#if defined(VEC_X86)
+    unsigned int a, b, c, d;
+    unsigned int lo, hi;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return;
+    }
+    if (!(c & (1u << 27)) || !(c & (1u << 28))) { /* OSXSAVE, AVX */
+        return;
+    }
+    __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    if ((lo & 0x06) != 0x06) { /* XMM and YMM state */
+        return;
+    }
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return;
+    }
+    if (b & (1u << 5)) { /* AVX2 */
+        vec_kernels = &vec4_table;
+    }
+    if (b & (1u << 16)) { /* AVX512F */
+#if defined(__APPLE__)
+        int avx512 = 0;
+        size_t len = sizeof(avx512);
+        if (sysctlbyname("hw.optional.avx512f", &avx512, &len, NULL, 0) == 0 && avx512) {
+            vec_kernels = &vec8_table;
+        }
+#else
+        if ((lo & 0xe6) == 0xe6) { /* opmask, ZMM and high ZMM state */
+            vec_kernels = &vec8_table;
+        }
+#endif
+    }
+#endif
+}
+
+/* ========================================================================== */
+
+#define VEC_DISPATCH_OPERATOR(name, kernel)                                    \
+    void name(double *restrict x, const double *restrict y, int n) {           \
+        vec_kernels->kernel(x, y, n);                                                  \
+    }
+
+#define VEC_DISPATCH_FUNCTION(name, kernel)                                    \
+    void name(double *restrict x, int n) {                                     \
+        vec_kernels->kernel(x, n);                                                     \
+    }
+
+VEC_DISPATCH_OPERATOR(vec_and, and_)
+VEC_DISPATCH_OPERATOR(vec_or, or_)
+VEC_DISPATCH_FUNCTION(vec_not, not_)
+VEC_DISPATCH_OPERATOR(vec_lt, lt)
+VEC_DISPATCH_OPERATOR(vec_gt, gt)
+VEC_DISPATCH_OPERATOR(vec_le, le)
+VEC_DISPATCH_OPERATOR(vec_ge, ge)
+VEC_DISPATCH_OPERATOR(vec_eq, eq)
+VEC_DISPATCH_OPERATOR(vec_ne, ne)
+
+VEC_DISPATCH_OPERATOR(vec_add, add)
+VEC_DISPATCH_OPERATOR(vec_sub, sub)
+VEC_DISPATCH_OPERATOR(vec_mul, mul)
+VEC_DISPATCH_OPERATOR(vec_div, div)
+VEC_DISPATCH_OPERATOR(vec_pow, pow)
+
+VEC_DISPATCH_FUNCTION(vec_neg, neg)
+VEC_DISPATCH_FUNCTION(vec_rev, rev)
+VEC_DISPATCH_FUNCTION(vec_sqr, sqr)
+VEC_DISPATCH_FUNCTION(vec_inc, inc)
+VEC_DISPATCH_FUNCTION(vec_dec, dec)
+VEC_DISPATCH_FUNCTION(vec_sgn, sgn)
+VEC_DISPATCH_FUNCTION(vec_abs, abs)
+VEC_DISPATCH_FUNCTION(vec_sqrt, sqrt)
+
+VEC_DISPATCH_FUNCTION(vec_exp, exp)
+VEC_DISPATCH_FUNCTION(vec_log, log)
+VEC_DISPATCH_FUNCTION(vec_log10, log10)
+VEC_DISPATCH_FUNCTION(vec_erf, erf)
+
+#define VEC_FUNCTION(name, expr)                                               \
+    void name(double *restrict x, int n) {                                     \
+        for (int l = 0; l < n; l++) {                                          \
+            double a = x[l];                                                   \
+            x[l] = (expr);                                                     \
+        }                                                                      \
+    }
+
+VEC_FUNCTION(vec_sin, sin(a))
+VEC_FUNCTION(vec_cos, cos(a))
+VEC_FUNCTION(vec_tan, tan(a))
+VEC_FUNCTION(vec_asin, asin(a))
+VEC_FUNCTION(vec_acos, acos(a))
+VEC_FUNCTION(vec_atan, atan(a))
+VEC_FUNCTION(vec_sinh, sinh(a))
+VEC_FUNCTION(vec_cosh, cosh(a))
+VEC_FUNCTION(vec_tanh, tanh(a))
+
+/**
+ @brief set all lanes to a value
+
+ @param x lane vector
+ @param val value
+ @param n number of lanes
+ */
+void vec_set(double *restrict x, double val, int n) {
+    vec_kernels->set(x, val, n);
+}
+
+/**
+ @brief copy lanes
+
+ @param x destination lane vector
+ @param y source lane vector
+ @param n number of lanes
+ */
+void vec_copy(double *restrict x, const double *restrict y, int n) {
+    vec_kernels->copy(x, y, n);
+}
+
+/**
+ @brief add a multiple of a vector
+
+ @discussion    x[l] = x[l] + a * y[l], not fused, as the interpreter code
+ that multiplies and adds in two operators.
+
+ @param x lane vector
+ @param a factor
+ @param y lane vector
+ @param n number of lanes
+ */
+void vec_axpy(double *restrict x, double a, const double *restrict y, int n) {
+    vec_kernels->axpy(x, a, y, n);
+}
@@ -0,0 +1,403 @@
+//
+// vec_kern.h
+// ParXModelCompiler
+//
+// Lane kernels for one instruction set, included by vec_func.c per target
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/*
+ * The includer defines
+ *   W          number of doubles in a vector register
+ *   VATTR      function attribute selecting the instruction set
+ *   VNAME(f)   name of kernel f for this instruction set
+ *   VSQRT(a)   lane wise square root of a vector
+ * and gets the kernel table VNAME(table).
+ * The kernels use the vector extensions of gcc and clang, comparisons give
+ * lane masks of all ones or all zeros. Shifts are logical and integers are
+ * compared as doubles, the instructions SSE2 and AVX2 have for 64 bit lanes.
+ */
+
+typedef double VNAME(vd) __attribute__((vector_size(8 * W)));
+typedef int64_t VNAME(vi) __attribute__((vector_size(8 * W)));
+typedef uint64_t VNAME(vu) __attribute__((vector_size(8 * W)));
+
+#define VD VNAME(vd)
+#define VI VNAME(vi)
+#define VU VNAME(vu)
+
+static VATTR inline VD VNAME(load)(const double *p) {
+    VD v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static VATTR inline void VNAME(store)(double *p, VD v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static VATTR inline VD VNAME(set)(double c) {
+    VD v = { 0 };
+    return c - v; /* keeps the sign of -0 */
+}
+
+static VATTR inline VD VNAME(sel)(VI m, VD a, VD b) {
+    return (VD)(((VI)a & m) | ((VI)b & ~m));
+}
+
+static VATTR inline VD VNAME(bool)(VI m) {
+    return (VD)(m & (VI)VNAME(set)(1.0));
+}
+
+/* ========================================================================== */
+
+/* double-double arithmetic, exact as long as nothing overflows */
+
+static VATTR inline VD VNAME(two_sum)(VD a, VD b, VD *e) {
+    VD s = a + b;
+    VD bb = s - a;
+    *e = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+static VATTR inline VD VNAME(two_prod)(VD a, VD b, VD *e) {
+    VD p = a * b;
+    VD c = a * split;
+    VD ah = c - (c - a);
+    VD al = a - ah;
+    c = b * split;
+    VD bh = c - (c - b);
+    VD bl = b - bh;
+    *e = (((ah * bh - p) + ah * bl) + al * bh) + al * bl;
+    return p;
+}
+
+/* ========================================================================== */
+
+/* exp(a) (1 + c): a = k ln2 + r, |r| <= ln2/2, exp(r) from a rational
+   approximation, scaled by 2^k in two steps to reach the subnormal range */
+static VATTR inline VD VNAME(expk)(VD a, VD c) {
+    VD v = VNAME(sel)((VI)(a < exp_min), VNAME(set)(exp_min), a);
+    v = VNAME(sel)((VI)(v > exp_max), VNAME(set)(exp_max), v);
+    v = VNAME(sel)((VI)(v != v), VNAME(set)(0.0), v);
+
+    VD t = v * inv_ln2 + round_shift;
+    VI k = (VI)t - (VI)VNAME(set)(round_shift);
+    VD kd = t - round_shift;
+
+    VD hi = v - kd * ln2_hi;
+    VD lo = kd * ln2_lo;
+    VD r = hi - lo;
+    VD z = r * r;
+    VD p = r - z * (P1 + z * (P2 + z * (P3 + z * (P4 + z * P5))));
+    VD y = 1.0 - ((lo - (r * p) / (2.0 - p)) - hi);
+    y = y + y * c;
+
+    VI k1 = (VI)((VU)(k + 2048) >> 1) - 1024; /* k >= -1075 */
+    VI k2 = k - k1;
+    y *= (VD)((k1 + 1023) << 52);
+    y *= (VD)((k2 + 1023) << 52);
+
+    y = VNAME(sel)((VI)(a > exp_max), VNAME(set)(HUGE_VAL), y);
+    y = VNAME(sel)((VI)(a < exp_min), VNAME(set)(0.0), y);
+    return VNAME(sel)((VI)(a != a), a, y);
+}
+
+/* a = 2^k m, sqrt(2)/2 <= m < sqrt(2), for positive a; returns m */
+static VATTR inline VD VNAME(logr)(VD a, VD *dk, VI *hm) {
+    VI sub = (VI)(a < 0x1p-1022); /* subnormal, scale to normal range */
+    VD v = VNAME(sel)(sub, a * two54, a);
+
+    VI u = (VI)v;
+    VI hx = (VI)((VU)u >> 32) & 0x7fffffff;
+    VI k = (VI)((VU)hx >> 20) - 1023 - (sub & 54);
+    hx &= 0x000fffff;
+    VI i = (hx + 0x95f64) & 0x100000;
+    k += (VI)((VU)i >> 20);
+    u = ((hx | (i ^ 0x3ff00000)) << 32) | (u & 0xffffffff);
+
+    /* |k| < 1100, converted by adding to the rounding shift */
+    *dk = (VD)(k + (VI)VNAME(set)(round_shift)) - round_shift;
+    *hm = hx;
+    return (VD)u;
+}
+
+/* log(a) = k ln2 + log(m), log(m) from a polynomial in s = (m - 1) / (m + 1) */
+static VATTR inline VD VNAME(vlog)(VD a) {
+    VD dk;
+    VI hx;
+    VD f = VNAME(logr)(a, &dk, &hx) - 1.0;
+
+    VD s = f / (2.0 + f);
+    VD z = s * s;
+    VD w = z * z;
+    VD t1 = w * (Lg2 + w * (Lg4 + w * Lg6));
+    VD t2 = z * (Lg1 + w * (Lg3 + w * (Lg5 + w * Lg7)));
+    VD R = t2 + t1;
+    VD hfsq = 0.5 * f * f;
+    VI j = (hx - 0x6147a) | (0x6b851 - hx);
+
+    VD y1 = dk * ln2_hi - ((hfsq - (s * (hfsq + R) + dk * ln2_lo)) - f);
+    VD y2 = dk * ln2_hi - ((s * (f - R) - dk * ln2_lo) - f);
+    VD dj = (VD)(j + (VI)VNAME(set)(round_shift)) - round_shift; /* |j| < 2^21 */
+    VD y = VNAME(sel)((VI)(dj > 0.0), y1, y2);
+
+    y = VNAME(sel)((VI)(a == HUGE_VAL), a, y);
+    y = VNAME(sel)((VI)(a == 0.0), VNAME(set)(-HUGE_VAL), y);
+    y = VNAME(sel)((VI)(a < 0.0), VNAME(set)(NAN), y);
+    return VNAME(sel)((VI)(a != a), a, y);
+}
+
+/* log(a) = h + l in double-double for positive normal or subnormal a */
+static VATTR inline VD VNAME(logk)(VD a, VD *l) {
+    VD dk, e1, e2;
+    VI hx;
+    VD m = VNAME(logr)(a, &dk, &hx);
+
+    /* x = (m - 1) / (m + 1), log(m) = 2 x + x^3 (2/3 + x^2 T(x^2)) */
+    VD n = m - 1.0;
+    VD dl;
+    VD dh = VNAME(two_sum)(m, VNAME(set)(1.0), &dl);
+    VD xh = n / dh;
+    VD pe;
+    VD p = VNAME(two_prod)(xh, dh, &pe);
+    VD xl = (((n - p) - pe) - xh * dl) / dh;
+
+    VD zl;
+    VD zh = VNAME(two_prod)(xh, xh, &zl);
+    zl += 2.0 * xh * xl;
+
+    VD t = T1 + zh * (T2 + zh * (T3 + zh * (T4 + zh * (T5 + zh * (T6 + zh * (T7 + zh * T8))))));
+    VD th = zh * t;
+    VD sh = two_thirds_hi + th; /* |th| < 2/3 / 50 */
+    VD sl = (th - (sh - two_thirds_hi)) + two_thirds_lo + zl * t;
+
+    VD yl;
+    VD yh = VNAME(two_prod)(zh, xh, &yl);
+    yl += zh * xl + zl * xh;
+
+    VD rl;
+    VD rh = VNAME(two_prod)(yh, sh, &rl);
+    rl += yh * sl + yl * sh;
+
+    VD h = VNAME(two_sum)(dk * ln2_hi, 2.0 * xh, &e1);
+    h = VNAME(two_sum)(h, rh, &e2);
+    *l = e1 + e2 + 2.0 * xl + rl + dk * ln2_lo;
+    return h;
+}
+
+static VATTR inline VD VNAME(verf)(VD a) {
+    VD x = (VD)((VI)a & ~(VI)VNAME(set)(-0.0));
+
+    /* |a| < 1: a + a (P(a^2) - 1), P - 1 is small and the last add rounds */
+    VD t = x * x;
+    VD ps = VNAME(set)(erf_small[0]);
+    for (int i = 1; i < 12; i++) {
+        ps = ps * t + erf_small[i];
+    }
+    ps = ps * t + (erf_small[12] - 1.0);
+    ps = a + a * ps;
+
+    /* |a| >= 1: 1 - exp(-a^2) Q(|a| - c), coefficients chosen per lane */
+    VI m1 = (VI)(x < 2.0);
+    VI m2 = (VI)(x < 3.5);
+    VD v = VNAME(sel)((VI)(x < 6.0), x, VNAME(set)(6.0)); /* erf(6) rounds to 1 */
+    VD u = v - VNAME(sel)(m1, VNAME(set)(1.5), VNAME(sel)(m2, VNAME(set)(2.75), VNAME(set)(4.75)));
+    VD c = VNAME(set)(0.0);
+    for (int i = 0; i < 16; i++) {
+        VD q = VNAME(sel)(m1, VNAME(set)(erfc_tail[0][i]),
+                          VNAME(sel)(m2, VNAME(set)(erfc_tail[1][i]), VNAME(set)(erfc_tail[2][i])));
+        c = c * u + q;
+    }
+    VD pl = 1.0 - VNAME(expk)(-(v * v), VNAME(set)(0.0)) * c;
+    pl = (VD)((VI)pl | ((VI)a & (VI)VNAME(set)(-0.0)));
+
+    VD y = VNAME(sel)((VI)(x < 1.0), ps, pl);
+    return VNAME(sel)((VI)(a != a), a, y);
+}
+
+/* lane wise square root, for instruction sets without a vector square root */
+static VATTR inline VD VNAME(lane_sqrt)(VD a) {
+    for (int i = 0; i < W; i++) {
+        a[i] = sqrt(a[i]);
+    }
+    return a;
+}
+
+/* ========================================================================== */
+
+/* full vectors in place, the remaining lanes through a padded copy */
+
+#define VEC_KERNEL_OPERATOR(name, expr)                                        \
+    static VATTR void VNAME(name)(double *restrict x, const double *restrict y, \
+                                  int n) {                                     \
+        int l;                                                                 \
+        for (l = 0; l + W <= n; l += W) {                                      \
+            VD a = VNAME(load)(x + l), b = VNAME(load)(y + l);                 \
+            VNAME(store)(x + l, (expr));                                       \
+        }                                                                      \
+        if (l < n) {                                                           \
+            double ta[W], tb[W];                                               \
+            for (int i = 0; i < W; i++) {                                      \
+                ta[i] = (l + i < n) ? x[l + i] : 1.0;                          \
+                tb[i] = (l + i < n) ? y[l + i] : 1.0;                          \
+            }                                                                  \
+            VD a = VNAME(load)(ta), b = VNAME(load)(tb);                       \
+            VNAME(store)(ta, (expr));                                          \
+            memcpy(x + l, ta, (size_t)(n - l) * sizeof(double));               \
+        }                                                                      \
+    }
+
+#define VEC_KERNEL_FUNCTION(name, expr)                                        \
+    static VATTR void VNAME(name)(double *restrict x, int n) {                 \
+        int l;                                                                 \
+        for (l = 0; l + W <= n; l += W) {                                      \
+            VD a = VNAME(load)(x + l);                                         \
+            VNAME(store)(x + l, (expr));                                       \
+        }                                                                      \
+        if (l < n) {                                                           \
+            double ta[W];                                                      \
+            for (int i = 0; i < W; i++) {                                      \
+                ta[i] = (l + i < n) ? x[l + i] : 1.0;                          \
+            }                                                                  \
+            VD a = VNAME(load)(ta);                                            \
+            VNAME(store)(ta, (expr));                                          \
+            memcpy(x + l, ta, (size_t)(n - l) * sizeof(double));               \
+        }                                                                      \
+    }
+
+VEC_KERNEL_OPERATOR(and, VNAME(bool)((VI)(a != 0.0) & (VI)(b != 0.0)))
+VEC_KERNEL_OPERATOR(or, VNAME(bool)((VI)(a != 0.0) | (VI)(b != 0.0)))
+VEC_KERNEL_FUNCTION(not, VNAME(bool)((VI)(a == 0.0)))
+VEC_KERNEL_OPERATOR(lt, VNAME(bool)((VI)(a < b)))
+VEC_KERNEL_OPERATOR(gt, VNAME(bool)((VI)(a > b)))
+VEC_KERNEL_OPERATOR(le, VNAME(bool)((VI)(a <= b)))
+VEC_KERNEL_OPERATOR(ge, VNAME(bool)((VI)(a >= b)))
+VEC_KERNEL_OPERATOR(eq, VNAME(bool)((VI)(a == b)))
+VEC_KERNEL_OPERATOR(ne, VNAME(bool)((VI)(a != b)))
+
+VEC_KERNEL_OPERATOR(add, a + b)
+VEC_KERNEL_OPERATOR(sub, a - b)
+VEC_KERNEL_OPERATOR(mul, a * b)
+VEC_KERNEL_OPERATOR(div, a / b)
+
+VEC_KERNEL_FUNCTION(neg, -a)
+VEC_KERNEL_FUNCTION(rev, 1.0 / a)
+VEC_KERNEL_FUNCTION(sqr, a * a)
+VEC_KERNEL_FUNCTION(inc, a + 1.0)
+VEC_KERNEL_FUNCTION(dec, a - 1.0)
+VEC_KERNEL_FUNCTION(sgn, VNAME(sel)((VI)(a >= 0.0), VNAME(set)(1.0), VNAME(set)(-1.0)))
+VEC_KERNEL_FUNCTION(abs, (VD)((VI)a & ~(VI)VNAME(set)(-0.0)))
+VEC_KERNEL_FUNCTION(sqrt, VSQRT(a))
+
+VEC_KERNEL_FUNCTION(exp, VNAME(expk)(a, VNAME(set)(0.0)))
+VEC_KERNEL_FUNCTION(log, VNAME(vlog)(a))
+VEC_KERNEL_FUNCTION(erf, VNAME(verf)(a))
+
+/* log10(a) = log(a) log10(e), the product rounded once */
+static VATTR inline VD VNAME(vlog10)(VD a) {
+    VD y = VNAME(vlog)(a);
+    VD e;
+    VD p = VNAME(two_prod)(y, VNAME(set)(log10_e_hi), &e);
+    VD r = p + (e + y * log10_e_lo);
+    return VNAME(sel)((VI)(y - y == 0.0), r, y * log10_e_hi);
+}
+
+VEC_KERNEL_FUNCTION(log10, VNAME(vlog10)(a))
+
+/* a^b = exp(b log(a)) in double-double, libm for the lanes it does not cover */
+static VATTR void VNAME(pow)(double *restrict x, const double *restrict y, int n) {
+    for (int l = 0; l < n; l += W) {
+        double ta[W], tb[W], tr[W];
+        for (int i = 0; i < W; i++) {
+            ta[i] = (l + i < n) ? x[l + i] : 1.0;
+            tb[i] = (l + i < n) ? y[l + i] : 1.0;
+        }
+        VD a = VNAME(load)(ta), b = VNAME(load)(tb);
+
+        /* positive finite base, exponent small enough to split */
+        VI reg = (VI)(a > 0.0) & (VI)(a < HUGE_VAL) & (VI)(b < 0x1p900) & (VI)(b > -0x1p900);
+        VD s = VNAME(sel)(reg, a, VNAME(set)(1.0));
+        VD t = VNAME(sel)(reg, b, VNAME(set)(1.0));
+
+        VD ll, wl, e;
+        VD lh = VNAME(logk)(s, &ll);
+        VD wh = VNAME(two_prod)(t, lh, &wl);
+        wl += t * ll;
+        VD w = wh + wl;
+        e = wl - (w - wh);
+        VNAME(store)(tr, VNAME(expk)(w, e));
+
+        for (int i = 0; i < W && l + i < n; i++) {
+            x[l + i] = reg[i] ? tr[i] : pow(ta[i], tb[i]);
+        }
+    }
+}
+
+/* ========================================================================== */
+
+static VATTR void VNAME(set_all)(double *restrict x, double val, int n) {
+    int l;
+    VD v = VNAME(set)(val);
+
+    for (l = 0; l + W <= n; l += W) {
+        VNAME(store)(x + l, v);
+    }
+    for (; l < n; l++) {
+        x[l] = val;
+    }
+}
+
+static VATTR void VNAME(copy)(double *restrict x, const double *restrict y, int n) {
+    int l;
+
+    for (l = 0; l + W <= n; l += W) {
+        VNAME(store)(x + l, VNAME(load)(y + l));
+    }
+    for (; l < n; l++) {
+        x[l] = y[l];
+    }
+}
+
+static VATTR void VNAME(axpy)(double *restrict x, double a, const double *restrict y, int n) {
+    int l;
+    double t;
+
+    for (l = 0; l + W <= n; l += W) {
+        VD v = a * VNAME(load)(y + l);
+        VNAME(store)(x + l, VNAME(load)(x + l) + v);
+    }
+    for (; l < n; l++) {
+        t = a * y[l];
+        x[l] = x[l] + t;
+    }
+}
+
+static const struct vec_table VNAME(table) = {
+    VNAME(and), VNAME(or), VNAME(not), VNAME(lt), VNAME(gt), VNAME(le),
+    VNAME(ge), VNAME(eq), VNAME(ne), VNAME(add), VNAME(sub), VNAME(mul),
+    VNAME(div), VNAME(pow), VNAME(neg), VNAME(rev), VNAME(sqr), VNAME(inc),
+    VNAME(dec), VNAME(sgn), VNAME(abs), VNAME(sqrt), VNAME(exp), VNAME(log),
+    VNAME(log10), VNAME(erf), VNAME(set_all), VNAME(copy), VNAME(axpy)
+};
+
+#undef VEC_KERNEL_OPERATOR
+#undef VEC_KERNEL_FUNCTION
+#undef VD
+#undef VI
+#undef VU
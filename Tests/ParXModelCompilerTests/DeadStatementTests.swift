@@ -0,0 +1,69 @@
+//
+// DeadStatementTests.swift
+// ParXModelCompilerTests
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+import XCTest
+import ParXModelCompiler
+
+final class DeadStatementTests: XCTestCase {
+
+    /// A comparison of numbers folds, and the branch not taken is removed.
+    func testFoldedComparison() throws {
+        let folded = try compileModel(equations: """
+            if (2 * 3 > 5)
+                t = k * 2 * x
+            else
+                t = k * 3 * x
+            fi
+            r = y - t
+            """)
+        let plain = try compileModel(equations: """
+            t = k * 2 * x
+            r = y - t
+            """)
+
+        let dead = try XCTUnwrap(folded.getRewriteCounts()["dead"])
+        XCTAssertGreaterThan(dead.intValue, 0)
+
+        let foldedCode = try XCTUnwrap(folded.getModelCode())
+        let plainCode = try XCTUnwrap(plain.getModelCode())
+        XCTAssertEqual(foldedCode.getLengthCode(), plainCode.getLengthCode())
+
+        let r = try XCTUnwrap(residual(of: foldedCode, x: [1.5, 4.0],
+                                       p: [1.0], f: [0.0]))
+        XCTAssertEqual(r, 1.0)
+    }
+
+    /// A logical combination of comparisons folds as well.
+    func testFoldedLogic() throws {
+        let compiler = try compileModel(equations: """
+            if (!(1 < 0) & 2 >= 2)
+                t = k * x
+            else
+                t = k * y
+            fi
+            r = y - t
+            """)
+        let code = try XCTUnwrap(compiler.getModelCode())
+        let r = try XCTUnwrap(residual(of: code, x: [1.5, 4.0],
+                                       p: [2.0], f: [0.0]))
+        XCTAssertEqual(r, 1.0)
+    }
+}
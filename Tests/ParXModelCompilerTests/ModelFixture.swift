@@ -0,0 +1,80 @@
+//
+// ModelFixture.swift
+// ParXModelCompilerTests
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+import Foundation
+import ParXModelCompiler
+
+/// Compiles a model given as the equations of a model file, with one
+/// variables x, y, one parameter k, one constant w, one flag s and one
+/// residual r.
+func compileModel(equations: String) throws -> PXModelCompiler {
+    let text = """
+        model:   "Test model"
+        author:  "ParXModelCompilerTests"
+        ident:   "test"
+        date:    "2025-01-01"
+        version: "1.0.0"
+
+        var: x = {1u} V
+        var: y = {1u} V
+
+        par: k = {1, 0, 5} V
+
+        const: w = {1} m
+
+        flag: s
+
+        res: r
+
+        equations:
+
+        \(equations)
+        """
+    let url = FileManager.default.temporaryDirectory
+        .appendingPathComponent("ParXTest-\(UUID().uuidString)")
+        .appendingPathExtension("parx")
+    try text.write(to: url, atomically: true, encoding: .utf8)
+    defer { try? FileManager.default.removeItem(at: url) }
+    return try PXModelCompiler(path: url.path)
+}
+
+/// Residual of a model at a point, with all Jacobians left out.
+func residual(of code: PXModelCode, x: [Double], p: [Double],
+              c: [Double] = [1.0], f: [Double]) -> Double? {
+    guard let interpreter = PXModelInterpreter(code: code) else {
+        return nil
+    }
+    return residual(of: interpreter, x: x, p: p, c: c, f: f)
+}
+
+/// Residual of a model at a point by an interpreter.
+func residual(of interpreter: PXModelInterpreter, x: [Double], p: [Double],
+              c: [Double] = [1.0], f: [Double]) -> Double? {
+    var x = x, a = [0.0], p = p, c = c, f = f, r = [0.0]
+    guard interpreter.evaluate(forVar: &x, aux: &a, par: &p, con: &c,
+                               flag: &f, res: &r, jacXFlag: false,
+                               varFlags: nil, JacX: nil, JacA: nil,
+                               jacPFlag: false, parFlags: nil, JacP: nil)
+    else {
+        return nil
+    }
+    return r[0]
+}
@@ -0,0 +1,65 @@
+//
+// ProfileTests.swift
+// ParXModelCompilerTests
+//
+// Copyright (c) 2015-2025 Martin G. Middelhoek <martin@middelhoek.com>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+import XCTest
+import ParXModelCompiler
+
+final class ProfileTests: XCTestCase {
+
+    private let equations = """
+        if (s)
+            t = k * w * x
+        else
+            t = k * x
+        fi
+        r = y - t
+        """
+
+    /// Lines of the model file executed in a profile.
+    private func profiledLines(of code: PXModelCode, c: [Double],
+                               f: [Double]) throws -> Set<Int> {
+        let interpreter = try XCTUnwrap(PXModelInterpreter(code: code))
+        interpreter.profiling = true
+        for _ in 0..<10 {
+            let r = try XCTUnwrap(residual(of: interpreter, x: [1.5, 4.0],
+                                           p: [1.0], c: c, f: f))
+            XCTAssertEqual(r, 1.0)
+        }
+        return Set(interpreter.profileLines().compactMap {
+            $0["count"]!.doubleValue > 0 ? $0["line"]!.intValue : nil
+        })
+    }
+
+    /// A specialized code keeps the lines of the statements it executes.
+    func testSpecializedCodeProfile() throws {
+        let compiler = try compileModel(equations: equations)
+        let code = try XCTUnwrap(compiler.getModelCode())
+        var c = [2.0], f = [1.0]
+        let special = try XCTUnwrap(code.specializedCode(forCon: &c, flag: &f))
+
+        XCTAssertGreaterThan(special.getLengthSource(), 0)
+
+        let lines = try profiledLines(of: code, c: c, f: f)
+        let specialLines = try profiledLines(of: special, c: c, f: f)
+        XCTAssertTrue(specialLines.contains { $0 > 0 })
+        XCTAssertTrue(specialLines.isSubset(of: lines))
+    }
+}